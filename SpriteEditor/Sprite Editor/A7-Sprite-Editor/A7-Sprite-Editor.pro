@@ -1,4 +1,4 @@
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -8,16 +8,28 @@ CONFIG += c++17
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+include(spriteio.pri)
+
 SOURCES += \
     canvas.cpp \
+    framescheduler.cpp \
+    latencyhistogram.cpp \
     main.cpp \
     mainwindow.cpp \
-    preview.cpp
+    pixelscaler.cpp \
+    preview.cpp \
+    stampengine.cpp \
+    viewport.cpp
 
 HEADERS += \
     canvas.h \
+    framescheduler.h \
+    latencyhistogram.h \
     mainwindow.h \
-    preview.h
+    pixelscaler.h \
+    preview.h \
+    stampengine.h \
+    viewport.h
 
 FORMS += \
     mainwindow.ui
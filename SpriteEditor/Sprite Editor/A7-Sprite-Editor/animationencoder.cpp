@@ -0,0 +1,121 @@
+#include "animationencoder.h"
+
+///
+/// \brief Creates an encoder writing to an open device.
+/// \param device = Device to write to
+///
+AnimationEncoder::AnimationEncoder(QIODevice &device)
+    : m_device(device)
+{
+}
+
+AnimationEncoder::~AnimationEncoder()
+{
+}
+
+///
+/// \brief Writes the start of the file.
+/// \param size = Size of every frame
+/// \param framesPerSecond = Playback rate
+///
+bool AnimationEncoder::begin(const QSize &size, int framesPerSecond)
+{
+    if (size.isEmpty() || size.width() > 65535 || size.height() > 65535) {
+        return fail("The sprite is too large for an animated image.");
+    }
+    m_size = size;
+    m_framesPerSecond = qMax(1, framesPerSecond);
+    m_pending = QImage();
+    m_pendingDuration = 0;
+    return writeHeader();
+}
+
+///
+/// \brief Adds the next frame, writing the frame before it.
+/// \param frame = Frame of the size given to begin()
+///
+bool AnimationEncoder::addFrame(const Frame &frame)
+{
+    QImage pixels = framePixels(frame);
+    if (m_pendingDuration > 0 && pixels == m_pending) {
+        m_pendingDuration++;
+        return true;
+    }
+    if (m_pendingDuration > 0 && !writeFrame(m_pending, m_pendingDuration, pixels)) {
+        return false;
+    }
+    m_pending = pixels;
+    m_pendingDuration = 1;
+    return true;
+}
+
+///
+/// \brief Writes the last frame and the end of the file.
+///
+bool AnimationEncoder::finish()
+{
+    if (m_pendingDuration > 0 && !writeFrame(m_pending, m_pendingDuration, QImage())) {
+        return false;
+    }
+    m_pending = QImage();
+    m_pendingDuration = 0;
+    return writeTrailer();
+}
+
+QString AnimationEncoder::errorString() const
+{
+    return m_errorString;
+}
+
+///
+/// \brief Returns the pixels of a frame as the format will show them.
+///
+QImage AnimationEncoder::framePixels(const Frame &frame) const
+{
+    return frame.toImage();
+}
+
+///
+/// \brief Writes bytes to the device, recording the device error if that fails.
+///
+bool AnimationEncoder::write(const QByteArray &bytes)
+{
+    if (m_device.write(bytes) != bytes.size()) {
+        return fail(m_device.errorString());
+    }
+    return true;
+}
+
+///
+/// \brief Records an error message and returns false.
+///
+bool AnimationEncoder::fail(const QString &message)
+{
+    m_errorString = message;
+    return false;
+}
+
+///
+/// \brief Returns the bounds of the pixels that differ between two images of the same size.
+///
+QRect AnimationEncoder::changedRect(const QImage &image, const QImage &other)
+{
+    QRect bounds;
+    for (int y = 0; y < image.height(); y++) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        const QRgb *otherLine = reinterpret_cast<const QRgb *>(other.constScanLine(y));
+        int left = 0;
+        while (left < image.width() && line[left] == otherLine[left]) {
+            left++;
+        }
+        if (left == image.width()) {
+            continue;
+        }
+        int right = image.width() - 1;
+        while (line[right] == otherLine[right]) {
+            right--;
+        }
+        bounds |= QRect(left, y, right - left + 1, 1);
+    }
+    return bounds;
+}
@@ -0,0 +1,103 @@
+#ifndef ANIMATIONENCODER_H
+#define ANIMATIONENCODER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QImage>
+#include <QRect>
+#include <QSize>
+#include <QString>
+#include "frame.h"
+
+///
+/// \brief The AnimationEncoder class is the base of the animated image writers. Frames
+/// are streamed in one at a time and written as soon as the frame after them is known,
+/// so only two frames are ever held no matter how long the animation is. Runs of
+/// identical frames are written once with a longer duration. Subclasses write the
+/// file format; the frame after the one being written is passed along so a format can
+/// prepare for it.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class AnimationEncoder
+{
+public:
+    ///
+    /// \brief Creates an encoder writing to an open device.
+    /// \param device = Device to write to
+    ///
+    explicit AnimationEncoder(QIODevice &device);
+
+    virtual ~AnimationEncoder();
+
+    ///
+    /// \brief Writes the start of the file.
+    /// \param size = Size of every frame
+    /// \param framesPerSecond = Playback rate
+    ///
+    bool begin(const QSize &size, int framesPerSecond);
+
+    ///
+    /// \brief Adds the next frame, writing the frame before it.
+    /// \param frame = Frame of the size given to begin()
+    ///
+    bool addFrame(const Frame &frame);
+
+    ///
+    /// \brief Writes the last frame and the end of the file.
+    ///
+    bool finish();
+
+    QString errorString() const; ///Returns a description of the last error
+
+protected:
+    ///
+    /// \brief Returns the pixels of a frame as the format will show them.
+    ///
+    virtual QImage framePixels(const Frame &frame) const;
+
+    ///
+    /// \brief Writes everything that comes before the first frame.
+    ///
+    virtual bool writeHeader() = 0;
+
+    ///
+    /// \brief Writes one frame.
+    /// \param frame = Pixels from framePixels()
+    /// \param duration = Number of frames it is shown for
+    /// \param next = Pixels of the frame after it, or a null image for the last frame
+    ///
+    virtual bool writeFrame(const QImage &frame, int duration, const QImage &next) = 0;
+
+    ///
+    /// \brief Writes everything that comes after the last frame.
+    ///
+    virtual bool writeTrailer() = 0;
+
+    ///
+    /// \brief Writes bytes to the device, recording the device error if that fails.
+    ///
+    bool write(const QByteArray &bytes);
+
+    ///
+    /// \brief Records an error message and returns false.
+    ///
+    bool fail(const QString &message);
+
+    ///
+    /// \brief Returns the bounds of the pixels that differ between two images of the same size.
+    ///
+    static QRect changedRect(const QImage &image, const QImage &other);
+
+    QIODevice &m_device; ///Device the file is written to
+    QSize m_size; ///Stores the size of every frame
+    int m_framesPerSecond = 1; ///Stores the playback rate
+
+private:
+    QImage m_pending; ///Stores the frame waiting for the one after it
+    int m_pendingDuration = 0; ///Stores how many identical frames the pending frame stands for
+    QString m_errorString; ///Stores the description of the last error
+};
+
+#endif // ANIMATIONENCODER_H
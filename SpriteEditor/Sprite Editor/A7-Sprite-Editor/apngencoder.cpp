@@ -0,0 +1,249 @@
+#include "apngencoder.h"
+#include <array>
+#include <cstdlib>
+#include <utility>
+
+///
+/// \brief Appends a 32 bit big endian number.
+///
+static void appendLong(QByteArray &bytes, quint32 value)
+{
+    bytes.append(char((value >> 24) & 0xff));
+    bytes.append(char((value >> 16) & 0xff));
+    bytes.append(char((value >> 8) & 0xff));
+    bytes.append(char(value & 0xff));
+}
+
+///
+/// \brief Appends a 16 bit big endian number.
+///
+static void appendShort(QByteArray &bytes, quint16 value)
+{
+    bytes.append(char((value >> 8) & 0xff));
+    bytes.append(char(value & 0xff));
+}
+
+///
+/// \brief Returns the CRC-32 that closes every PNG chunk.
+///
+static quint32 chunkChecksum(const QByteArray &bytes)
+{
+    static const auto table = [] {
+        std::array<quint32, 256> entries;
+        for (quint32 index = 0; index < 256; index++) {
+            quint32 value = index;
+            for (int bit = 0; bit < 8; bit++) {
+                value = (value & 1) ? 0xedb88320u ^ (value >> 1) : value >> 1;
+            }
+            entries[index] = value;
+        }
+        return entries;
+    }();
+    quint32 checksum = 0xffffffffu;
+    for (char byte : bytes) {
+        checksum = table[(checksum ^ quint8(byte)) & 0xff] ^ (checksum >> 8);
+    }
+    return checksum ^ 0xffffffffu;
+}
+
+///
+/// \brief Creates an encoder writing to an open device.
+/// \param device = Seekable device to write to
+///
+ApngEncoder::ApngEncoder(QIODevice &device)
+    : AnimationEncoder(device)
+{
+}
+
+///
+/// \brief Predicts a byte from its left, upper and upper left neighbours, as the
+/// Paeth filter of PNG rows does.
+///
+int ApngEncoder::paethPredictor(int left, int up, int upLeft)
+{
+    const int estimate = left + up - upLeft;
+    const int toLeft = std::abs(estimate - left);
+    const int toUp = std::abs(estimate - up);
+    const int toUpLeft = std::abs(estimate - upLeft);
+    if (toLeft <= toUp && toLeft <= toUpLeft) {
+        return left;
+    }
+    return toUp <= toUpLeft ? up : upLeft;
+}
+
+///
+/// \brief Writes the PNG signature, the image header and the animation control chunk.
+///
+bool ApngEncoder::writeHeader()
+{
+    if (m_device.isSequential()) {
+        return fail("Animated PNG files can only be written to a file.");
+    }
+    m_shown = QImage();
+    m_frameCount = 0;
+    m_sequence = 0;
+
+    QByteArray header("\x89PNG\r\n\x1a\n", 8);
+    QByteArray imageHeader;
+    appendLong(imageHeader, m_size.width());
+    appendLong(imageHeader, m_size.height());
+    // 8 bits per channel RGBA, deflate, adaptive filtering, no interlacing
+    imageHeader.append("\x08\x06\x00\x00\x00", 5);
+    header.append(chunk("IHDR", imageHeader));
+    if (!write(header)) {
+        return false;
+    }
+    m_animationControlPosition = m_device.pos();
+    return write(animationControl());
+}
+
+///
+/// \brief Writes one frame as the rectangle that changed.
+///
+bool ApngEncoder::writeFrame(const QImage &frame, int duration, const QImage &next)
+{
+    Q_UNUSED(next);
+    // The first frame is also the default image, which has to cover the whole canvas
+    QRect area = frame.rect();
+    if (m_frameCount > 0) {
+        area = changedRect(frame, m_shown);
+        if (area.isNull()) {
+            area = QRect(0, 0, 1, 1);
+        }
+    }
+    QByteArray control;
+    appendLong(control, m_sequence++);
+    appendLong(control, area.width());
+    appendLong(control, area.height());
+    appendLong(control, area.x());
+    appendLong(control, area.y());
+    // The delay is the duration in frames over the frame rate, in seconds
+    appendShort(control, quint16(qMin(duration, 65535)));
+    appendShort(control, quint16(qMin(m_framesPerSecond, 65535)));
+    // Leave the frame in place and replace the pixels under it, transparent ones included
+    control.append(char(0));
+    control.append(char(0));
+    QByteArray bytes = chunk("fcTL", control);
+    const QByteArray pixels = compressArea(frame, area);
+    if (m_frameCount == 0) {
+        bytes.append(chunk("IDAT", pixels));
+    } else {
+        QByteArray frameData;
+        appendLong(frameData, m_sequence++);
+        frameData.append(pixels);
+        bytes.append(chunk("fdAT", frameData));
+    }
+    if (!write(bytes)) {
+        return false;
+    }
+    m_shown = frame;
+    m_frameCount++;
+    return true;
+}
+
+///
+/// \brief Fills in the frame count and writes the end of the PNG.
+///
+bool ApngEncoder::writeTrailer()
+{
+    if (m_frameCount == 0) {
+        return fail("There are no frames to export.");
+    }
+    const qint64 end = m_device.pos();
+    if (!m_device.seek(m_animationControlPosition) || !write(animationControl()) || !m_device.seek(end)) {
+        return fail(m_device.errorString());
+    }
+    return write(chunk("IEND", QByteArray()));
+}
+
+///
+/// \brief Returns a PNG chunk with its length and checksum.
+/// \param type = Four letter chunk type
+/// \param data = Chunk contents
+///
+QByteArray ApngEncoder::chunk(const char *type, const QByteArray &data)
+{
+    QByteArray bytes;
+    appendLong(bytes, data.size());
+    const QByteArray checked = QByteArray(type, 4) + data;
+    bytes.append(checked);
+    appendLong(bytes, chunkChecksum(checked));
+    return bytes;
+}
+
+///
+/// \brief Returns the animation control chunk.
+///
+QByteArray ApngEncoder::animationControl() const
+{
+    QByteArray control;
+    appendLong(control, m_frameCount);
+    // Loop forever
+    appendLong(control, 0);
+    return chunk("acTL", control);
+}
+
+///
+/// \brief Returns the compressed, filtered RGBA rows of part of an image.
+///
+QByteArray ApngEncoder::compressArea(const QImage &image, const QRect &area)
+{
+    const int bytesPerPixel = 4;
+    const int rowSize = area.width() * bytesPerPixel;
+    QByteArray previous(rowSize, char(0));
+    QByteArray row(rowSize, char(0));
+    QByteArray filtered[5];
+    for (QByteArray &candidate : filtered) {
+        candidate.resize(rowSize);
+    }
+    QByteArray raw;
+    raw.reserve((rowSize + 1) * area.height());
+    for (int y = area.top(); y <= area.bottom(); y++) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y)) + area.left();
+        for (int x = 0; x < area.width(); x++) {
+            row[x * 4] = char(qRed(line[x]));
+            row[x * 4 + 1] = char(qGreen(line[x]));
+            row[x * 4 + 2] = char(qBlue(line[x]));
+            row[x * 4 + 3] = char(qAlpha(line[x]));
+        }
+        // Try None, Sub, Up, Average and Paeth, keeping the one with the smallest sum
+        int best = 0;
+        qint64 bestSum = -1;
+        for (int filter = 0; filter < 5; filter++) {
+            qint64 sum = 0;
+            for (int index = 0; index < rowSize; index++) {
+                const int value = quint8(row.at(index));
+                const int left = index >= bytesPerPixel ? quint8(row.at(index - bytesPerPixel)) : 0;
+                const int up = quint8(previous.at(index));
+                const int upLeft = index >= bytesPerPixel ? quint8(previous.at(index - bytesPerPixel)) : 0;
+                int predicted = 0;
+                switch (filter) {
+                case 1:
+                    predicted = left;
+                    break;
+                case 2:
+                    predicted = up;
+                    break;
+                case 3:
+                    predicted = (left + up) / 2;
+                    break;
+                case 4:
+                    predicted = paethPredictor(left, up, upLeft);
+                    break;
+                }
+                const qint8 residual = qint8(quint8(value - predicted));
+                filtered[filter][index] = char(residual);
+                sum += std::abs(int(residual));
+            }
+            if (bestSum < 0 || sum < bestSum) {
+                best = filter;
+                bestSum = sum;
+            }
+        }
+        raw.append(char(best));
+        raw.append(filtered[best]);
+        std::swap(previous, row);
+    }
+    // qCompress puts the uncompressed size in front of the zlib stream PNG expects
+    return qCompress(raw).mid(4);
+}
@@ -0,0 +1,73 @@
+#ifndef APNGENCODER_H
+#define APNGENCODER_H
+
+#include "animationencoder.h"
+
+///
+/// \brief The ApngEncoder class streams frames into a looping animated PNG. The first
+/// frame is stored whole as the default image, so viewers without animation support
+/// still show it, and every later frame only stores the rectangle that changed, which
+/// replaces those pixels outright so erased pixels stay transparent. Every row is
+/// stored with whichever PNG filter makes it smallest before compression.
+///
+/// The frame count is only known at the end, so the device must be seekable.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class ApngEncoder : public AnimationEncoder
+{
+public:
+    ///
+    /// \brief Creates an encoder writing to an open device.
+    /// \param device = Seekable device to write to
+    ///
+    explicit ApngEncoder(QIODevice &device);
+
+    ///
+    /// \brief Predicts a byte from its left, upper and upper left neighbours, as the
+    /// Paeth filter of PNG rows does.
+    ///
+    static int paethPredictor(int left, int up, int upLeft);
+
+protected:
+    ///
+    /// \brief Writes the PNG signature, the image header and the animation control chunk.
+    ///
+    bool writeHeader() override;
+
+    ///
+    /// \brief Writes one frame as the rectangle that changed.
+    ///
+    bool writeFrame(const QImage &frame, int duration, const QImage &next) override;
+
+    ///
+    /// \brief Fills in the frame count and writes the end of the PNG.
+    ///
+    bool writeTrailer() override;
+
+private:
+    ///
+    /// \brief Returns a PNG chunk with its length and checksum.
+    /// \param type = Four letter chunk type
+    /// \param data = Chunk contents
+    ///
+    static QByteArray chunk(const char *type, const QByteArray &data);
+
+    ///
+    /// \brief Returns the animation control chunk.
+    ///
+    QByteArray animationControl() const;
+
+    ///
+    /// \brief Returns the compressed, filtered RGBA rows of part of an image.
+    ///
+    static QByteArray compressArea(const QImage &image, const QRect &area);
+
+    QImage m_shown; ///Stores the frame a viewer shows before the next frame is drawn
+    int m_frameCount = 0; ///Stores how many frames were written
+    quint32 m_sequence = 0; ///Stores the next animation chunk sequence number
+    qint64 m_animationControlPosition = 0; ///Stores where the animation control chunk starts
+};
+
+#endif // APNGENCODER_H
@@ -0,0 +1,262 @@
+#include "atlasexporter.h"
+#include "atlaspacker.h"
+#include <QFileInfo>
+#include <QImageWriter>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMultiHash>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+///
+/// \brief Returns a rectangle as the x, y, w, h object used by atlas metadata.
+///
+static QJsonObject rectObject(const QRect &rect)
+{
+    return QJsonObject{{"x", rect.x()}, {"y", rect.y()}, {"w", rect.width()}, {"h", rect.height()}};
+}
+
+///
+/// \brief Returns a size as the w, h object used by atlas metadata.
+///
+static QJsonObject sizeObject(const QSize &size)
+{
+    return QJsonObject{{"w", size.width()}, {"h", size.height()}};
+}
+
+///
+/// \brief Creates an exporter writing the metadata to the given path. The pages are
+/// written next to it, named after it with the page number appended.
+/// \param fileName = Path of the .json metadata file
+///
+AtlasExporter::AtlasExporter(const QString &fileName)
+    : m_fileName(fileName)
+{
+}
+
+///
+/// \brief Trims, packs and writes the frames.
+/// \param spriteSize = Size of every frame
+/// \param frames = Frames to export
+/// \return If the atlas was written; errorString() describes the failure otherwise
+///
+bool AtlasExporter::write(const QSize &spriteSize, const FrameList &frames)
+{
+    if (frames.isEmpty()) {
+        return fail("There are no frames to export.");
+    }
+    QVector<int> indices(frames.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    QVector<Sprite> sprites = QtConcurrent::blockingMapped<QVector<Sprite>>(indices, [&frames](int index) {
+        return trim(frames.at(index));
+    });
+    // Frames with the same pixels, such as held poses, are stored once
+    QMultiHash<size_t, int> uniqueByHash;
+    for (int index = 0; index < sprites.size(); index++) {
+        Sprite &sprite = sprites[index];
+        for (auto other = uniqueByHash.constFind(sprite.hash); other != uniqueByHash.constEnd() && other.key() == sprite.hash; ++other) {
+            const QRect &otherArea = sprites.at(other.value()).trimmed;
+            if (otherArea.size() == sprite.trimmed.size()
+                && samePixels(frames.at(index), sprite.trimmed, frames.at(other.value()), otherArea)) {
+                sprite.alias = other.value();
+                break;
+            }
+        }
+        if (sprite.alias < 0) {
+            uniqueByHash.insert(sprite.hash, index);
+        }
+    }
+    const QVector<QSize> pageSizes = pack(sprites);
+    QVector<QVector<int>> pageSprites(pageSizes.size());
+    for (int index = 0; index < sprites.size(); index++) {
+        if (sprites.at(index).alias < 0) {
+            pageSprites[sprites.at(index).page].append(index);
+        }
+    }
+    // Each page is composed and compressed by its own task
+    QVector<int> pages(pageSizes.size());
+    std::iota(pages.begin(), pages.end(), 0);
+    const QVector<QString> errors = QtConcurrent::blockingMapped<QVector<QString>>(pages, [&](int page) {
+        QImage image(pageSizes.at(page), QImage::Format_ARGB32);
+        image.fill(0);
+        for (int index : pageSprites.at(page)) {
+            const Sprite &sprite = sprites.at(index);
+            const Frame frame = frames.at(index);
+            for (int y = 0; y < sprite.trimmed.height(); y++) {
+                QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(sprite.position.y() + y)) + sprite.position.x();
+                frame.copySpan(sprite.trimmed.x(), sprite.trimmed.y() + y, sprite.trimmed.width(), line);
+            }
+        }
+        QImageWriter writer(pageFileName(page), "png");
+        return writer.write(image) ? QString() : writer.errorString();
+    });
+    for (const QString &error : errors) {
+        if (!error.isEmpty()) {
+            return fail(error);
+        }
+    }
+    return writeMetadata(spriteSize, sprites, pageSizes);
+}
+
+///
+/// \brief Returns the path of a page image.
+/// \param page = Page number
+///
+QString AtlasExporter::pageFileName(int page) const
+{
+    const QFileInfo info(m_fileName);
+    return info.path() + "/" + info.completeBaseName() + "_" + QString::number(page) + ".png";
+}
+
+QString AtlasExporter::errorString() const
+{
+    return m_errorString;
+}
+
+///
+/// \brief Finds a frame's opaque bounds and hashes the pixels inside them. Frames
+/// with no opaque pixels keep their top left pixel, so every frame has an area.
+///
+AtlasExporter::Sprite AtlasExporter::trim(const Frame &frame)
+{
+    Sprite sprite;
+    sprite.trimmed = frame.opaqueBounds();
+    if (sprite.trimmed.isNull()) {
+        sprite.trimmed = QRect(0, 0, 1, 1);
+    }
+    QVector<QRgb> line(sprite.trimmed.width());
+    size_t hash = qHashMulti(0, sprite.trimmed.width(), sprite.trimmed.height());
+    for (int y = sprite.trimmed.top(); y <= sprite.trimmed.bottom(); y++) {
+        frame.copySpan(sprite.trimmed.x(), y, line.size(), line.data());
+        hash = qHashBits(line.constData(), line.size() * sizeof(QRgb), hash);
+    }
+    sprite.hash = hash;
+    return sprite;
+}
+
+///
+/// \brief Returns if two trimmed frames hold the same pixels.
+///
+bool AtlasExporter::samePixels(const Frame &frame, const QRect &area, const Frame &other, const QRect &otherArea)
+{
+    QVector<QRgb> line(area.width());
+    QVector<QRgb> otherLine(area.width());
+    for (int y = 0; y < area.height(); y++) {
+        frame.copySpan(area.x(), area.y() + y, line.size(), line.data());
+        other.copySpan(otherArea.x(), otherArea.y() + y, otherLine.size(), otherLine.data());
+        if (std::memcmp(line.constData(), otherLine.constData(), line.size() * sizeof(QRgb)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+///
+/// \brief Places every frame that is not an alias on a page, biggest first, opening
+/// a new page when none of the open ones has room.
+/// \return The size of every page
+///
+QVector<QSize> AtlasExporter::pack(QVector<Sprite> &sprites)
+{
+    QVector<int> order;
+    for (int index = 0; index < sprites.size(); index++) {
+        if (sprites.at(index).alias < 0) {
+            order.append(index);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&sprites](int first, int second) {
+        const QSize firstSize = sprites.at(first).trimmed.size();
+        const QSize secondSize = sprites.at(second).trimmed.size();
+        if (firstSize.height() != secondSize.height()) {
+            return firstSize.height() > secondSize.height();
+        }
+        return firstSize.width() > secondSize.width();
+    });
+    QVector<AtlasPacker> pages;
+    for (int index : order) {
+        Sprite &sprite = sprites[index];
+        // The padding goes to the right and below, so it is trimmed off the page edges
+        const QSize paddedSize = sprite.trimmed.size() + QSize(Padding, Padding);
+        sprite.page = -1;
+        for (int page = 0; page < pages.size(); page++) {
+            if (pages[page].insert(paddedSize, sprite.position)) {
+                sprite.page = page;
+                break;
+            }
+        }
+        if (sprite.page < 0) {
+            // A frame larger than a page gets a page of its own size
+            pages.append(AtlasPacker(QSize(MaximumPageSide + Padding, MaximumPageSide + Padding).expandedTo(paddedSize)));
+            pages.last().insert(paddedSize, sprite.position);
+            sprite.page = pages.size() - 1;
+        }
+    }
+    for (Sprite &sprite : sprites) {
+        if (sprite.alias >= 0) {
+            sprite.page = sprites.at(sprite.alias).page;
+            sprite.position = sprites.at(sprite.alias).position;
+        }
+    }
+    QVector<QSize> pageSizes;
+    for (const AtlasPacker &page : pages) {
+        pageSizes.append(page.usedSize() - QSize(Padding, Padding));
+    }
+    return pageSizes;
+}
+
+///
+/// \brief Writes the JSON metadata, replacing the file only once it is complete.
+///
+bool AtlasExporter::writeMetadata(const QSize &spriteSize, const QVector<Sprite> &sprites, const QVector<QSize> &pageSizes)
+{
+    QJsonArray frames;
+    for (int index = 0; index < sprites.size(); index++) {
+        const Sprite &sprite = sprites.at(index);
+        QJsonObject frame;
+        frame["filename"] = QString("frame_%1").arg(index, 4, 10, QChar('0'));
+        frame["page"] = sprite.page;
+        frame["frame"] = rectObject(QRect(sprite.position, sprite.trimmed.size()));
+        frame["rotated"] = false;
+        frame["trimmed"] = sprite.trimmed != QRect(QPoint(0, 0), spriteSize);
+        frame["spriteSourceSize"] = rectObject(sprite.trimmed);
+        frame["sourceSize"] = sizeObject(spriteSize);
+        frames.append(frame);
+    }
+    QJsonArray pages;
+    for (int page = 0; page < pageSizes.size(); page++) {
+        pages.append(QJsonObject{{"image", QFileInfo(pageFileName(page)).fileName()}, {"size", sizeObject(pageSizes.at(page))}});
+    }
+    QJsonObject meta;
+    meta["app"] = "Sprite Editor";
+    meta["format"] = "RGBA8888";
+    meta["scale"] = "1";
+    // Readers that only know single page atlases use the first page
+    meta["image"] = pages.first().toObject().value("image");
+    meta["size"] = sizeObject(pageSizes.first());
+    meta["pages"] = pages;
+    QJsonObject root;
+    root["frames"] = frames;
+    root["meta"] = meta;
+    QSaveFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return fail(file.errorString());
+    }
+    const QByteArray json = QJsonDocument(root).toJson();
+    if (file.write(json) != json.size() || !file.commit()) {
+        return fail(file.errorString());
+    }
+    return true;
+}
+
+///
+/// \brief Records an error message and returns false.
+///
+bool AtlasExporter::fail(const QString &message)
+{
+    m_errorString = message;
+    return false;
+}
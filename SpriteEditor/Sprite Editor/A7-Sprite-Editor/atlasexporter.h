@@ -0,0 +1,97 @@
+#ifndef ATLASEXPORTER_H
+#define ATLASEXPORTER_H
+
+#include <QPoint>
+#include <QRect>
+#include <QString>
+#include <QVector>
+#include "framelist.h"
+
+///
+/// \brief The AtlasExporter class writes the frames of a sprite as a texture atlas: one
+/// or more PNG pages and a JSON file describing where every frame is. Each frame is
+/// trimmed to its opaque bounds, frames with the same trimmed pixels share one place
+/// on the atlas, and the rest are packed with an AtlasPacker. The metadata uses the JSON
+/// array layout that texture packers commonly write and game engines read, with a page
+/// number added to every frame and the list of pages added to meta.
+///
+/// Trimming and page encoding are spread over the thread pool, one frame or one page
+/// per task; only the packing itself runs on one thread.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class AtlasExporter
+{
+public:
+    static constexpr int MaximumPageSide = 2048; ///Largest page width or height, unless one frame is larger
+    static constexpr int Padding = 1; ///Transparent pixels kept between neighbouring frames
+
+    ///
+    /// \brief Creates an exporter writing the metadata to the given path. The pages are
+    /// written next to it, named after it with the page number appended.
+    /// \param fileName = Path of the .json metadata file
+    ///
+    explicit AtlasExporter(const QString &fileName);
+
+    ///
+    /// \brief Trims, packs and writes the frames.
+    /// \param spriteSize = Size of every frame
+    /// \param frames = Frames to export
+    /// \return If the atlas was written; errorString() describes the failure otherwise
+    ///
+    bool write(const QSize &spriteSize, const FrameList &frames);
+
+    ///
+    /// \brief Returns the path of a page image.
+    /// \param page = Page number
+    ///
+    QString pageFileName(int page) const;
+
+    QString errorString() const; ///Returns a description of the last error
+
+private:
+    ///
+    /// \brief Where one frame ends up on the atlas.
+    ///
+    struct Sprite {
+        QRect trimmed; ///Opaque part of the frame, in frame coordinates
+        size_t hash = 0; ///Hash of the trimmed pixels
+        int alias = -1; ///Earlier frame with the same pixels, or -1
+        int page = 0; ///Page holding the pixels
+        QPoint position; ///Top left of the pixels on the page
+    };
+
+    ///
+    /// \brief Finds a frame's opaque bounds and hashes the pixels inside them. Frames
+    /// with no opaque pixels keep their top left pixel, so every frame has an area.
+    ///
+    static Sprite trim(const Frame &frame);
+
+    ///
+    /// \brief Returns if two trimmed frames hold the same pixels.
+    ///
+    static bool samePixels(const Frame &frame, const QRect &area, const Frame &other, const QRect &otherArea);
+
+    ///
+    /// \brief Places every frame that is not an alias on a page, biggest first, opening
+    /// a new page when none of the open ones has room.
+    /// \return The size of every page
+    ///
+    QVector<QSize> pack(QVector<Sprite> &sprites);
+
+    ///
+    /// \brief Writes the JSON metadata, replacing the file only once it is complete.
+    ///
+    bool writeMetadata(const QSize &spriteSize, const QVector<Sprite> &sprites, const QVector<QSize> &pageSizes);
+
+    ///
+    /// \brief Records an error message and returns false.
+    ///
+    bool fail(const QString &message);
+
+    QString m_fileName; ///Stores the path of the metadata file
+    QString m_errorString; ///Stores the description of the last error
+};
+
+#endif // ATLASEXPORTER_H
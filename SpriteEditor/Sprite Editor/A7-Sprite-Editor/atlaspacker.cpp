@@ -0,0 +1,114 @@
+#include "atlaspacker.h"
+#include <limits>
+
+///
+/// \brief Creates an empty page.
+/// \param pageSize = Largest size the page can grow to
+///
+AtlasPacker::AtlasPacker(const QSize &pageSize)
+    : m_usedSize(0, 0)
+{
+    m_freeRects.append(QRect(QPoint(0, 0), pageSize));
+}
+
+///
+/// \brief Places a rectangle on the page.
+/// \param size = Size of the rectangle
+/// \param position = Receives the top left of the placed rectangle
+/// \return If the rectangle fit on the page
+///
+bool AtlasPacker::insert(const QSize &size, QPoint &position)
+{
+    int bestShortSide = std::numeric_limits<int>::max();
+    int bestLongSide = std::numeric_limits<int>::max();
+    int bestIndex = -1;
+    for (int index = 0; index < m_freeRects.size(); index++) {
+        const QRect &free = m_freeRects.at(index);
+        if (size.width() > free.width() || size.height() > free.height()) {
+            continue;
+        }
+        const int leftoverWidth = free.width() - size.width();
+        const int leftoverHeight = free.height() - size.height();
+        const int shortSide = qMin(leftoverWidth, leftoverHeight);
+        const int longSide = qMax(leftoverWidth, leftoverHeight);
+        if (shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide)) {
+            bestShortSide = shortSide;
+            bestLongSide = longSide;
+            bestIndex = index;
+        }
+    }
+    if (bestIndex < 0) {
+        return false;
+    }
+    position = m_freeRects.at(bestIndex).topLeft();
+    const QRect used(position, size);
+    splitFreeRects(used);
+    pruneFreeRects();
+    m_usedSize = m_usedSize.expandedTo(QSize(used.x() + used.width(), used.y() + used.height()));
+    return true;
+}
+
+///
+/// \brief Returns the size of the area covered by the placed rectangles, measured
+/// from the top left of the page.
+///
+QSize AtlasPacker::usedSize() const
+{
+    return m_usedSize;
+}
+
+///
+/// \brief Replaces every free rectangle that overlaps a placed one by the parts of it
+/// left, right, above and below the placed rectangle.
+///
+void AtlasPacker::splitFreeRects(const QRect &used)
+{
+    const int usedRight = used.x() + used.width();
+    const int usedBottom = used.y() + used.height();
+    QVector<QRect> split;
+    for (int index = 0; index < m_freeRects.size();) {
+        const QRect free = m_freeRects.at(index);
+        if (!free.intersects(used)) {
+            index++;
+            continue;
+        }
+        const int freeRight = free.x() + free.width();
+        const int freeBottom = free.y() + free.height();
+        if (used.x() > free.x()) {
+            split.append(QRect(free.x(), free.y(), used.x() - free.x(), free.height()));
+        }
+        if (usedRight < freeRight) {
+            split.append(QRect(usedRight, free.y(), freeRight - usedRight, free.height()));
+        }
+        if (used.y() > free.y()) {
+            split.append(QRect(free.x(), free.y(), free.width(), used.y() - free.y()));
+        }
+        if (usedBottom < freeBottom) {
+            split.append(QRect(free.x(), usedBottom, free.width(), freeBottom - usedBottom));
+        }
+        // Order does not matter, so the last rectangle fills the gap
+        m_freeRects[index] = m_freeRects.last();
+        m_freeRects.removeLast();
+    }
+    m_freeRects.append(split);
+}
+
+///
+/// \brief Removes the free rectangles that lie inside another free rectangle.
+///
+void AtlasPacker::pruneFreeRects()
+{
+    for (int index = 0; index < m_freeRects.size(); index++) {
+        for (int other = index + 1; other < m_freeRects.size();) {
+            if (m_freeRects.at(index).contains(m_freeRects.at(other))) {
+                m_freeRects.removeAt(other);
+            } else if (m_freeRects.at(other).contains(m_freeRects.at(index))) {
+                m_freeRects.removeAt(index);
+                index--;
+                break;
+            } else {
+                other++;
+            }
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef ATLASPACKER_H
+#define ATLASPACKER_H
+
+#include <QPoint>
+#include <QRect>
+#include <QSize>
+#include <QVector>
+
+///
+/// \brief The AtlasPacker class places rectangles on one atlas page with the MaxRects
+/// algorithm. It keeps every maximal free rectangle of the page, places each new
+/// rectangle in the free rectangle that leaves the shortest leftover side, and then
+/// splits the free rectangles it overlaps and drops the ones another one contains.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class AtlasPacker
+{
+public:
+    ///
+    /// \brief Creates an empty page.
+    /// \param pageSize = Largest size the page can grow to
+    ///
+    explicit AtlasPacker(const QSize &pageSize);
+
+    ///
+    /// \brief Places a rectangle on the page.
+    /// \param size = Size of the rectangle
+    /// \param position = Receives the top left of the placed rectangle
+    /// \return If the rectangle fit on the page
+    ///
+    bool insert(const QSize &size, QPoint &position);
+
+    ///
+    /// \brief Returns the size of the area covered by the placed rectangles, measured
+    /// from the top left of the page.
+    ///
+    QSize usedSize() const;
+
+private:
+    ///
+    /// \brief Replaces every free rectangle that overlaps a placed one by the parts of it
+    /// left, right, above and below the placed rectangle.
+    ///
+    void splitFreeRects(const QRect &used);
+
+    ///
+    /// \brief Removes the free rectangles that lie inside another free rectangle.
+    ///
+    void pruneFreeRects();
+
+    QVector<QRect> m_freeRects; ///Stores the maximal free rectangles of the page
+    QSize m_usedSize; ///Stores the extent of the placed rectangles
+};
+
+#endif // ATLASPACKER_H
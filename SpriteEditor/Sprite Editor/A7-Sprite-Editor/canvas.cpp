@@ -1,305 +1,745 @@
 #include "canvas.h"
 
+///
+/// \brief Stroke timing and input latency, logged after every stroke. Off unless enabled
+/// with QT_LOGGING_RULES="spriteeditor.stroke.debug=true".
+///
+Q_LOGGING_CATEGORY(strokeLog, "spriteeditor.stroke", QtWarningMsg)
+
 ///
 /// \brief Constructor for Canvas. Takes in a QWidget as its parent.
 /// \param parent
 ///
 Canvas::Canvas(QWidget *parent)
-    : QWidget(parent), m_spriteSize(QSize(16, 16)), m_currentColor(Qt::black), m_unsaved(false)
-    , m_isDrawing(false), m_brushAndEraserSize(1), m_currentFrameIndex(0)
+    : QWidget(parent), m_spriteSize(QSize(16, 16)), m_journal(journalFileName()), m_currentColor(Qt::black), m_unsaved(false)
+    , m_isDrawing(false), m_brushAndEraserSize(1), m_frameRate(1), m_currentFrameIndex(0)
 {
+    m_frameScheduler = new FrameScheduler(this);
+    connect(m_frameScheduler, &FrameScheduler::frameStarted, this, &Canvas::processPendingInput);
+    m_inputClock.start();
+    m_autosaveWatcher = new QFutureWatcher<QString>(this);
+    connect(m_autosaveWatcher, &QFutureWatcher<QString>::finished, this, &Canvas::autosaveFinished);
+    m_autosaveTimer = new QTimer(this);
+    connect(m_autosaveTimer, &QTimer::timeout, this, &Canvas::autosave);
+    m_autosaveTimer->start(AutosaveInterval);
     m_currentTool = "Pen";
-    setDefaultBackground();
-    m_spriteImage = QImage(m_spriteSize, QImage::Format_ARGB32);
-    m_spriteImage.fill(QColorConstants::Transparent);
-    m_frames.append(m_spriteImage);
-    m_scaledDefaultBackground = m_defaultImage.copy();
-    m_scaledImage = m_spriteImage.copy();
-    m_imageScale = 512 / m_spriteSize.width();
-    m_zoomScale = m_imageScale;
-    m_scaledDefaultBackground = m_scaledDefaultBackground.scaled(512, 512, Qt::IgnoreAspectRatio, Qt::FastTransformation);
-    m_scaledImage = m_scaledImage.scaled(512, 512, Qt::IgnoreAspectRatio, Qt::FastTransformation);
-    update();
+    // The journal is only started by recoverFromJournal(), so the last session's is kept until then
+    m_frames.append(Frame(m_spriteSize));
+    m_viewport.setSpriteSize(m_spriteSize);
+    m_frameScheduler->requestFullRepaint();
+}
+
+///
+/// \brief Returns the scheduler that coalesces the canvas repaints. Its counters
+/// show how many repaints were requested and how many were actually delivered.
+///
+const FrameScheduler *Canvas::frameScheduler() const
+{
+    return m_frameScheduler;
 }
 
 ///
-/// \brief Prompts the draw method on the point that was pressed.
+/// \brief Returns the histogram of the time between an input event arriving and
+/// its stroke being written into the frame.
+///
+const LatencyHistogram &Canvas::inputLatency() const
+{
+    return m_inputLatency;
+}
+
+///
+/// \brief Returns the path of one of the binary projects the canvas autosaves to.
+/// Autosaves and imports take turns between them, so neither the one the journal
+/// starts from nor the one an autosave is still writing is ever the one replaced.
+/// \param slot = 0 to AutosaveSlots - 1
+///
+QString Canvas::autosaveFileName(int slot)
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QString("/autosave-%1.ssp").arg(slot);
+}
+
+///
+/// \brief Returns the path of the journal that records every change to the frames.
+///
+QString Canvas::journalFileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/journal.ssj";
+}
+
+///
+/// \brief Starts a stroke at the point that was pressed, or starts panning the
+/// view if the middle button was pressed.
 /// \param event = Mouse button pressed
 ///
 void Canvas::mousePressEvent(QMouseEvent *event)
 {
-    if (event->button() == Qt::LeftButton) {
-        m_lastMousePoint = event->position().toPoint();
-        draw(m_lastMousePoint);
+    if (event->button() == Qt::MiddleButton) {
+        m_panAnchor = event->position();
+        m_isPanning = true;
+    } else if (event->button() == Qt::LeftButton) {
+        beginStroke();
+        queueStrokeSample(event->position(), 1.0, true);
         m_isDrawing = true;
     }
 }
 
 ///
-/// \brief Prompts the draw method when the mouse moves if
-///  the left mouse button is held down.
+/// \brief Queues the mouse position for drawing if
+///  the left mouse button is held down, or pans the view with the middle button.
 /// \param event = Mouse moving
 ///
 void Canvas::mouseMoveEvent(QMouseEvent *event)
 {
-    if ((event->buttons() & Qt::LeftButton) && m_isDrawing)
-        draw(event->position().toPoint());
+    if (m_isPanning) {
+        m_viewport.panBy(event->position() - m_panAnchor);
+        m_panAnchor = event->position();
+        m_frameScheduler->requestFullRepaint();
+    } else if ((event->buttons() & Qt::LeftButton) && m_isDrawing)
+        queueStrokeSample(event->position(), 1.0, false);
 }
 
 ///
-/// \brief Prompts the draw method at the point where
-/// the user released the mouse button and stops drawing.
+/// \brief Draws up to the point where
+/// the user released the mouse button and stops drawing or panning.
 /// \param event = Mouse released
 ///
 void Canvas::mouseReleaseEvent(QMouseEvent *event)
 {
-    if (event->button() == Qt::LeftButton && m_isDrawing) {
-        draw(event->position().toPoint());
-        m_isDrawing = false;
+    if (event->button() == Qt::MiddleButton) {
+        m_isPanning = false;
+    } else if (event->button() == Qt::LeftButton && m_isDrawing) {
+        queueStrokeSample(event->position(), 1.0, false);
+        finishStroke();
+    }
+}
+
+///
+/// \brief Handles pen input the same way as mouse input, with the pen pressure
+/// scaling the brush size. Accepting the event stops Qt from also sending the
+/// matching mouse events.
+/// \param event = Tablet pen event
+///
+void Canvas::tabletEvent(QTabletEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::TabletPress:
+        if (event->button() == Qt::LeftButton) {
+            beginStroke();
+            queueStrokeSample(event->position(), event->pressure(), true);
+            m_isDrawing = true;
+        }
+        break;
+    case QEvent::TabletMove:
+        if (m_isDrawing) {
+            queueStrokeSample(event->position(), event->pressure(), false);
+        }
+        break;
+    case QEvent::TabletRelease:
+        if (event->button() == Qt::LeftButton && m_isDrawing) {
+            queueStrokeSample(event->position(), event->pressure(), false);
+            finishStroke();
+        }
+        break;
+    default:
+        break;
+    }
+    event->accept();
+}
+
+///
+/// \brief Zooms the view around the cursor. One wheel notch zooms by a quarter.
+/// \param event = Mouse wheel turned
+///
+void Canvas::wheelEvent(QWheelEvent *event)
+{
+    qreal notches = event->angleDelta().y() / 120.0;
+    if (notches != 0) {
+        m_viewport.zoomBy(qPow(1.25, notches), event->position());
+        m_frameScheduler->requestFullRepaint();
+    }
+    event->accept();
+}
+
+///
+/// \brief Keeps the view centered when the canvas is resized. The first resize
+/// fits the sprite to the canvas.
+/// \param event = Canvas resized
+///
+void Canvas::resizeEvent(QResizeEvent *event)
+{
+    m_viewport.setWidgetSize(event->size());
+    m_frameScheduler->requestFullRepaint();
+}
+
+///
+/// \brief Adds a raw input position to the queue drawn on the next frame. Any
+/// number of samples can arrive between two frames; they are drawn as one batch.
+/// \param position = Position in widget coordinates
+/// \param pressure = Pen pressure between 0 and 1, 1 for the mouse
+/// \param startsStroke = If the sample begins a new stroke
+///
+void Canvas::queueStrokeSample(const QPointF &position, qreal pressure, bool startsStroke)
+{
+    m_pendingSamples.append({position.toPoint(), pressure, startsStroke, m_inputClock.nsecsElapsed()});
+    m_frameScheduler->requestFrame();
+}
+
+///
+/// \brief Draws every queued sample as one batch, invalidates the result once and
+/// records each sample's latency.
+///
+void Canvas::processPendingInput()
+{
+    if (m_pendingSamples.isEmpty()) {
+        return;
+    }
+    QVector<StrokeSample> samples;
+    samples.swap(m_pendingSamples);
+    if (m_currentTool == "Bucket"){
+        for (const StrokeSample &sample : samples) {
+            QPoint spritePoint = screenToSpritePoint(sample.position);
+            bucketTool(spritePoint.x(), spritePoint.y());
+        }
+    } else {
+        // Stamps are written straight into the frame store
+        m_stampEngine.beginSegment(currentFrameForWriting());
+        for (const StrokeSample &sample : samples) {
+            QPoint spritePoint = screenToSpritePoint(sample.position);
+            QPoint startPoint = sample.startsStroke ? spritePoint : screenToSpritePoint(m_lastMousePoint);
+            int brushSize = qMax(1, qRound(m_brushAndEraserSize * sample.pressure));
+            drawSegment(startPoint, spritePoint, brushSize);
+            m_lastMousePoint = sample.position;
+        }
+        m_stampEngine.endSegment();
+    }
+    m_lastMousePoint = samples.last().position;
+    m_unsaved = true;
+    flushDirtyRegion();
+    qint64 committedAt = m_inputClock.nsecsElapsed();
+    for (const StrokeSample &sample : samples) {
+        m_inputLatency.record(committedAt - sample.receivedAt);
+    }
+}
+
+///
+/// \brief Starts a stroke on the current frame, remembering the frame as it was so
+/// the stroke can be journaled once it ends.
+///
+void Canvas::beginStroke()
+{
+    m_stampEngine.beginStroke();
+    // Copying the frame only shares it; the stroke detaches the tiles it draws on
+    m_strokeBefore = m_frames.at(m_currentFrameIndex);
+}
+
+///
+/// \brief Draws whatever is still queued, ends the current stroke and journals it.
+///
+void Canvas::finishStroke()
+{
+    processPendingInput();
+    m_isDrawing = false;
+    if (!m_strokeBefore.isNull()) {
+        m_journal.recordPixels(m_currentFrameIndex, m_strokeBefore, m_frames.at(m_currentFrameIndex));
+        m_strokeBefore = Frame();
     }
+    qCDebug(strokeLog) << "Stroke:" << m_stampEngine.strokeSegments() << "segments," << m_stampEngine.strokePixels()
+                       << "pixels in" << m_stampEngine.strokeNanoseconds() / 1000 << "us";
+    qCDebug(strokeLog) << "Input latency:" << m_inputLatency.toString();
 }
 
 ///
-/// \brief Paints a 512x512 rectangle scaled by the images width and height.
-/// If zoomed in, the rectangle is scaled by the zoom factor instead of 512x512.
+/// \brief Repaints only the sprite pixels covered by the event's dirty rectangle,
+/// so the cost follows what is on screen rather than the sprite size. At whole
+/// number zooms the pixels are blended over the checkerboard at sprite resolution
+/// and magnified straight into the reusable compose buffer; other zooms draw in
+/// sprite coordinates through the viewport transform.
 /// \param event
 ///
 void Canvas::paintEvent(QPaintEvent *event)
 {
+    QRect spriteArea = m_viewport.screenToSprite(event->rect());
+    if (spriteArea.isEmpty()) {
+        return;
+    }
     QPainter painter(this);
-    QRect oldRect = event->rect();
-    QRect newRect = event->rect();
-    QPoint centeredTopLeftPoint = QPoint(((512 - m_spriteImage.width() * m_zoomScale) / 2), (512 - m_spriteImage.height() * m_zoomScale) / 2);
-    newRect.setTopLeft(centeredTopLeftPoint);
-    newRect.setWidth((m_spriteImage.width() * m_zoomScale) * m_imageScale / m_zoomScale);
-    newRect.setHeight((m_spriteImage.width() * m_zoomScale) * m_imageScale / m_zoomScale);
-    QSize zoomScaledSize = QSize(m_spriteImage.width() * m_zoomScale, m_spriteImage.height() * m_zoomScale);
-    painter.drawImage(newRect, m_defaultImage.scaled(zoomScaledSize, Qt::KeepAspectRatio, Qt::FastTransformation), oldRect);
-    painter.drawImage(newRect, m_spriteImage.scaled(zoomScaledSize, Qt::KeepAspectRatio, Qt::FastTransformation), oldRect);
-    update();
+    const Frame &frame = m_frames.at(m_currentFrameIndex);
+    if (m_viewport.isWholeZoom()) {
+        int factor = qRound(m_viewport.zoom());
+        if (m_composeBuffer.size() != size()) {
+            m_composeBuffer = QImage(size(), QImage::Format_RGB32);
+        }
+        composeOverChecker(frame, spriteArea);
+        QRect targetRect = m_viewport.spriteToScreen(spriteArea) & event->rect();
+        PixelScaler::scale(m_composeSprite, QRect(QPoint(0, 0), spriteArea.size()), factor,
+                           m_composeBuffer, m_viewport.transform().map(spriteArea.topLeft()), targetRect);
+        painter.drawImage(targetRect.topLeft(), m_composeBuffer, targetRect);
+        return;
+    }
+    painter.setTransform(m_viewport.transform());
+    painter.fillRect(spriteArea, checkerBrush());
+    // Tiles that were never painted are transparent and only show the checkerboard
+    for (int row = spriteArea.top() / Frame::TileSize; row <= spriteArea.bottom() / Frame::TileSize; row++) {
+        for (int column = spriteArea.left() / Frame::TileSize; column <= spriteArea.right() / Frame::TileSize; column++) {
+            if (!frame.hasTile(column, row)) {
+                continue;
+            }
+            QRect part = spriteArea & frame.tileRect(column, row);
+            QRect tileSource = part.translated(-column * Frame::TileSize, -row * Frame::TileSize);
+            painter.drawImage(QRectF(part), frame.tile(column, row), QRectF(tileSource));
+        }
+    }
 }
 
 ///
-/// \brief Draws onto the canvas by modifying the image based on mousePoint.
-/// \param mousePoint = Given mouse cursor point.
+/// \brief Blends part of a frame over the transparency checkerboard into the top left
+/// of the sprite compose image, one pixel per sprite pixel. The image only grows.
+/// \param frame = Frame to blend
+/// \param spriteArea = Sprite pixels to blend
 ///
-void Canvas::draw(const QPoint &mousePoint)
+void Canvas::composeOverChecker(const Frame &frame, const QRect &spriteArea)
 {
-    QPoint originPoint = QPoint(((512 - m_spriteImage.width() * m_zoomScale) / 2), ((512 - m_spriteImage.height() * m_zoomScale) / 2));
-    QPoint smallMousePoint;
-    smallMousePoint.setX((mousePoint.x() - originPoint.x()) / (m_zoomScale));
-    smallMousePoint.setY((mousePoint.y() - originPoint.y()) / (m_zoomScale));
-    if(smallMousePoint.x() < 0){
-        smallMousePoint.setX(0);
+    if (m_composeSprite.width() < spriteArea.width() || m_composeSprite.height() < spriteArea.height()) {
+        m_composeSprite = QImage(m_composeSprite.size().expandedTo(spriteArea.size()), QImage::Format_RGB32);
     }
-    if(smallMousePoint.y() < 0){
-        smallMousePoint.setY(0);
-    }
-    if (m_currentTool == "Bucket"){
-        m_colorToReplace = m_spriteImage.pixelColor(smallMousePoint);
-        bucketTool(smallMousePoint.x(), smallMousePoint.y());
-    } else if (m_currentTool == "Tile"){
-        // Keep brush within the drawing area.
-        for(int x = smallMousePoint.x(); x < m_brushAndEraserSize + smallMousePoint.x() && x < m_spriteSize.width(); x++){
-            for(int y = smallMousePoint.y(); y < m_brushAndEraserSize + smallMousePoint.y() && y < m_spriteSize.height(); y++){
-                // Drawing in bottom left quadrant
-                if(x - m_spriteSize.width() * 0.5 >= 0 && y + m_spriteSize.height() * 0.5 < m_spriteSize.height()){
-                    m_spriteImage.setPixelColor(x,y,m_currentColor);
-                    m_spriteImage.setPixelColor(x, y + m_spriteSize.height() * 0.5, m_currentColor);
-                    m_spriteImage.setPixelColor(x - m_spriteSize.width() * 0.5, y, m_currentColor);
-                    m_spriteImage.setPixelColor(x - m_spriteSize.width() * 0.5, y + m_spriteSize.height() * 0.5, m_currentColor);
-                    m_frames.replace(m_currentFrameIndex, m_spriteImage);
-                // Drawing in top left quadrant
-                } else if (x - m_spriteSize.width() * 0.5 >= 0 ){
-                    m_spriteImage.setPixelColor(x - m_spriteSize.width() * 0.5, y, m_currentColor);
-                    m_spriteImage.setPixelColor(x,y,m_currentColor);
-                // Drawing in top right quadrant
-                } else if (y + m_spriteSize.height() * 0.5 < m_spriteSize.height()) {
-                    m_spriteImage.setPixelColor(x,y,m_currentColor);
-                    m_spriteImage.setPixelColor(x, y + m_spriteSize.height() * 0.5, m_currentColor);
-                // Drawing in bottom right quadrant
-                } else {
-                    m_spriteImage.setPixelColor(x,y,m_currentColor);
+    const int darkGray = 192;
+    const int lightGray = 224;
+    for (int row = spriteArea.top() / Frame::TileSize; row <= spriteArea.bottom() / Frame::TileSize; row++) {
+        for (int column = spriteArea.left() / Frame::TileSize; column <= spriteArea.right() / Frame::TileSize; column++) {
+            QRect part = spriteArea & frame.tileRect(column, row);
+            const QImage &tile = frame.tile(column, row);
+            for (int y = part.top(); y <= part.bottom(); y++) {
+                const QRgb *source = reinterpret_cast<const QRgb *>(tile.constScanLine(y - row * Frame::TileSize))
+                        + part.left() - column * Frame::TileSize;
+                QRgb *target = reinterpret_cast<QRgb *>(m_composeSprite.scanLine(y - spriteArea.top()))
+                        + part.left() - spriteArea.left();
+                for (int x = part.left(); x <= part.right(); x++, source++, target++) {
+                    // Dark cells sit where the sprite coordinates add up to an even number
+                    int gray = (x + y) & 1 ? lightGray : darkGray;
+                    int alpha = qAlpha(*source);
+                    if (alpha == 255) {
+                        *target = *source;
+                    } else if (alpha == 0) {
+                        *target = qRgb(gray, gray, gray);
+                    } else {
+                        int background = gray * (255 - alpha);
+                        *target = qRgb((qRed(*source) * alpha + background) / 255,
+                                       (qGreen(*source) * alpha + background) / 255,
+                                       (qBlue(*source) * alpha + background) / 255);
+                    }
                 }
             }
         }
-    } else if (m_currentTool == "Eraser"){
-        for(int x = smallMousePoint.x(); x < m_brushAndEraserSize + smallMousePoint.x() && x < m_spriteSize.width(); x++){
-            for(int y = smallMousePoint.y(); y < m_brushAndEraserSize + smallMousePoint.y() && y < m_spriteSize.height(); y++){
-                m_spriteImage.setPixelColor(x,y,QColorConstants::Transparent);
-                m_frames.replace(m_currentFrameIndex, m_spriteImage);
-            }
+    }
+}
+
+///
+/// \brief Records that the given sprite pixels changed and must be repainted.
+/// \param spriteRect = Rectangle in sprite pixel coordinates
+///
+void Canvas::markSpriteDirty(const QRect &spriteRect)
+{
+    m_dirtySpriteRegion += spriteRect & QRect(QPoint(0, 0), m_spriteSize);
+}
+
+///
+/// \brief Requests a repaint of the screen rectangles covering every sprite
+/// pixel marked dirty since the last flush.
+///
+void Canvas::flushDirtyRegion()
+{
+    for (const QRect &spriteRect : m_dirtySpriteRegion) {
+        m_frameScheduler->requestRepaint(m_viewport.spriteToScreen(spriteRect));
+    }
+    m_dirtySpriteRegion = QRegion();
+}
+
+///
+/// \brief Maps a screen point to the sprite pixel under it. Points off the sprite are
+/// clamped to just past its edge, so strokes dragged far outside stay short.
+/// \param screenPoint = Point in widget coordinates
+///
+QPoint Canvas::screenToSpritePoint(const QPoint &screenPoint) const
+{
+    QPoint spritePoint = m_viewport.screenToSprite(QPointF(screenPoint));
+    spritePoint.setX(qBound(-m_brushAndEraserSize, spritePoint.x(), m_spriteSize.width()));
+    spritePoint.setY(qBound(-m_brushAndEraserSize, spritePoint.y(), m_spriteSize.height()));
+    return spritePoint;
+}
+
+///
+/// \brief Drags the brush along a line with Bresenham's algorithm. The first stamp
+/// is a full brush square; every step after it only adds the row and column the
+/// square moved into, so a segment costs its length times the brush width instead
+/// of times the brush area. The stamp engine segment must already be started, so
+/// many segments can be written as one batch.
+/// \param startPoint = First sprite pixel of the segment
+/// \param endPoint = Last sprite pixel of the segment
+/// \param size = Brush width in sprite pixels
+///
+void Canvas::drawSegment(const QPoint &startPoint, const QPoint &endPoint, int size)
+{
+    const QRgb pixel = m_currentTool == "Eraser" ? qRgba(0, 0, 0, 0) : m_currentColor.rgba();
+    const bool isTile = m_currentTool == "Tile";
+    auto stamp = [this, pixel, isTile](const QRect &rect) {
+        if (isTile) {
+            stampTiled(rect, pixel);
+        } else {
+            m_stampEngine.fillRect(rect, pixel);
         }
-    }else {
-        for(int x = smallMousePoint.x(); x < m_brushAndEraserSize + smallMousePoint.x() && x < m_spriteSize.width(); x++){
-            for(int y = smallMousePoint.y(); y < m_brushAndEraserSize + smallMousePoint.y() && y < m_spriteSize.height(); y++){
-                m_spriteImage.setPixelColor(x,y,m_currentColor);
-                m_frames.replace(m_currentFrameIndex, m_spriteImage);
-            }
+    };
+    stamp(QRect(startPoint, QSize(size, size)));
+    int deltaX = qAbs(endPoint.x() - startPoint.x());
+    int deltaY = -qAbs(endPoint.y() - startPoint.y());
+    int stepX = startPoint.x() < endPoint.x() ? 1 : -1;
+    int stepY = startPoint.y() < endPoint.y() ? 1 : -1;
+    int error = deltaX + deltaY;
+    QPoint point = startPoint;
+    while (point != endPoint) {
+        int doubledError = 2 * error;
+        if (doubledError >= deltaY) {
+            error += deltaY;
+            point.rx() += stepX;
+            stamp(QRect(stepX > 0 ? point.x() + size - 1 : point.x(), point.y(), 1, size));
+        }
+        if (doubledError <= deltaX) {
+            error += deltaX;
+            point.ry() += stepY;
+            stamp(QRect(point.x(), stepY > 0 ? point.y() + size - 1 : point.y(), size, 1));
         }
     }
-    m_scaledImage = m_frames.at(m_currentFrameIndex).scaled(m_spriteImage.width() * m_zoomScale, m_spriteImage.height() * m_zoomScale, Qt::IgnoreAspectRatio, Qt::FastTransformation);
-    m_lastMousePoint = mousePoint;
-    m_unsaved = true;
-    update();
+    QRect segmentBounds = QRect(startPoint, QSize(size, size)) | QRect(endPoint, QSize(size, size));
+    markSpriteDirty(segmentBounds);
+    if (isTile) {
+        markSpriteDirty(segmentBounds.translated(-m_spriteSize.width() / 2, 0));
+        markSpriteDirty(segmentBounds.translated(0, m_spriteSize.height() / 2));
+        markSpriteDirty(segmentBounds.translated(-m_spriteSize.width() / 2, m_spriteSize.height() / 2));
+    }
 }
 
 ///
-/// \brief Helper method for the bucket tool that uses the flood fill algorithm.
+/// \brief Stamps a rectangle with the tile tool. Parts of the stamp in the right half
+/// are repeated one half width to the left, parts in the top half are repeated one
+/// half height down, and parts in both are repeated diagonally.
+/// \param stampRect = Brush rectangle in sprite pixel coordinates
+/// \param pixel = Packed color to stamp
+///
+void Canvas::stampTiled(const QRect &stampRect, QRgb pixel){
+    int halfWidth = m_spriteSize.width() / 2;
+    int halfHeight = m_spriteSize.height() / 2;
+    QRect rightHalf(QPoint(m_spriteSize.width() - halfWidth, 0), QPoint(m_spriteSize.width() - 1, m_spriteSize.height() - 1));
+    QRect topHalf(QPoint(0, 0), QPoint(m_spriteSize.width() - 1, m_spriteSize.height() - halfHeight - 1));
+    QRect inRightHalf = stampRect & rightHalf;
+    QRect inTopHalf = stampRect & topHalf;
+    QRect inBoth = inRightHalf & topHalf;
+    m_stampEngine.fillRect(stampRect, pixel);
+    if (!inRightHalf.isEmpty()) {
+        m_stampEngine.fillRect(inRightHalf.translated(-halfWidth, 0), pixel);
+    }
+    if (!inTopHalf.isEmpty()) {
+        m_stampEngine.fillRect(inTopHalf.translated(0, halfHeight), pixel);
+    }
+    if (!inBoth.isEmpty()) {
+        m_stampEngine.fillRect(inBoth.translated(-halfWidth, halfHeight), pixel);
+    }
+}
+
+///
+/// \brief Returns the current frame in the frame store for writing. Only the tiles
+/// that are written to get detached from other copies of the frame.
+///
+Frame &Canvas::currentFrameForWriting(){
+    return m_frames[m_currentFrameIndex];
+}
+
+///
+/// \brief Helper method for the bucket tool. Fills the region of the clicked color
+/// with the current color using the frame's scanline flood fill, which writes the
+/// tiles directly and reports the filled bounds.
 /// \param x = Mouse point's x position
 /// \param y = Mouse point's y position
 ///
 void Canvas::bucketTool(int x, int y){
-    QPoint newPoint = QPoint(x,y);
-    bool negativeBounds = (newPoint.x() < 0) || (newPoint.y() < 0);
-    bool overFlowBounds = (newPoint.x() > m_spriteSize.width() - 1 || newPoint.y() > m_spriteSize.height() - 1);
-    if(negativeBounds || overFlowBounds || m_spriteImage.pixelColor(newPoint) == m_currentColor){
-        return;
+    markSpriteDirty(currentFrameForWriting().floodFill(QPoint(x, y), m_currentColor.rgba()));
+}
+
+///
+/// \brief Returns a brush that tiles the gray transparency checkerboard with one
+/// cell per sprite pixel. The painter's viewport transform scales it to the zoom,
+/// so the single 2x2 pixel tile is built once.
+///
+const QBrush &Canvas::checkerBrush(){
+    if(m_checkerBrush.style() == Qt::NoBrush){
+        QImage tile(2, 2, QImage::Format_RGB32);
+        tile.fill(QColor(224, 224, 224));
+        tile.setPixelColor(0, 0, QColor(192, 192, 192));
+        tile.setPixelColor(1, 1, QColor(192, 192, 192));
+        m_checkerBrush = QBrush(tile);
     }
-    if(m_spriteImage.pixelColor(newPoint) != m_colorToReplace){
+    return m_checkerBrush;
+}
+
+///
+/// \brief Helper method to save the sprite frames into an .ssp file in the chosen format.
+/// The frame list is copied, which only shares it, and the copy is encoded and written
+/// on the thread pool, so drawing can go on while the project is saved. Once it is
+/// saved, unchanged frames are read from the new file, so saving to it again only
+/// appends what changed, and the journal is compacted to it. Saves run one at a time:
+/// one asked for while another is being written waits for it, as two appends to the
+/// same file would overwrite each other.
+/// \param fileName = Path of the .ssp file
+/// \param format = Binary container or legacy JSON
+/// \param encoding = Frame encoding used by the binary container
+///
+void Canvas::saveProject(const QString &fileName, ProjectFile::Format format, FrameCodec::Encoding encoding) {
+    if (m_isSaving) {
+        // The frames are taken when the queued save starts, so it writes every change up to then
+        m_queuedSaves.append([this, fileName, format, encoding]() { saveProject(fileName, format, encoding); });
         return;
     }
-    m_spriteImage.setPixelColor(newPoint, m_currentColor);
-    m_frames.replace(m_currentFrameIndex, m_spriteImage);
-    bucketTool(x + 1, y);
-    bucketTool(x - 1, y);
-    bucketTool(x, y + 1);
-    bucketTool(x, y - 1);
+    m_isSaving = true;
+    FrameList frames = m_frames;
+    QSize spriteSize = m_spriteSize;
+    Journal::Mark mark = m_journal.mark();
+    auto project = std::make_shared<ProjectFile>(fileName);
+    runInBackground("Unable to save project", [project, spriteSize, frames, format, encoding]() {
+        if (!project->write(spriteSize, frames, format, encoding)) {
+            return project->errorString();
+        }
+        // Reading the new index back lets the next save only append the frames changed since
+        if (format == ProjectFile::Format::Binary && !project->read()) {
+            return project->errorString();
+        }
+        return QString();
+    }, [this, project, spriteSize, frames, mark, fileName]() {
+        if (project->frames().size() == frames.size()) {
+            m_frames.rebase(frames, project->frames());
+        }
+        m_journal.compact(mark, Journal::Base{spriteSize, QFileInfo(fileName).absoluteFilePath(), project->generation()});
+    }, [this]() {
+        m_isSaving = false;
+        if (!m_queuedSaves.isEmpty()) {
+            m_queuedSaves.takeFirst()();
+        }
+    });
 }
 
 ///
-/// \brief Creates a default gray checkered background when a new frame
-/// is added.
+/// \brief Runs a task on the thread pool and shows a warning if it returns an error.
+/// \param errorTitle = Title of the warning
+/// \param task = Work to run, returning an empty string or a description of the error
+/// \param onSuccess = Called on the GUI thread once the task finished without an error
+/// \param onFinished = Called on the GUI thread once the task finished, after the warning or onSuccess
 ///
-void Canvas::setDefaultBackground(){
-    m_defaultImage = QImage(m_spriteSize, QImage::Format_ARGB32);
-    QColor darkGray(192, 192, 192);
-    QColor lightGray(224, 224, 224);
-    for(int i = 0; i < m_spriteSize.width(); i++){
-        for(int j = 0; j < m_spriteSize.height(); j++){
-            if(i % 2 == 0){
-                if(j % 2 == 0){
-                    m_defaultImage.setPixelColor(i, j, darkGray);
-                }
-                else{
-                    m_defaultImage.setPixelColor(i, j, lightGray);
-                }
-            }
-            else{
-                if(j % 2 == 0){
-                    m_defaultImage.setPixelColor(i, j, lightGray);
-                }
-                else{
-                    m_defaultImage.setPixelColor(i, j, darkGray);
-                }
-            }
+void Canvas::runInBackground(const QString &errorTitle, const std::function<QString()> &task,
+                             const std::function<void()> &onSuccess, const std::function<void()> &onFinished)
+{
+    auto *watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher, errorTitle, onSuccess, onFinished]() {
+        QString error = watcher->result();
+        if (!error.isEmpty()) {
+            QMessageBox::warning(this, errorTitle, error);
+        } else if (onSuccess) {
+            onSuccess();
+        }
+        if (onFinished) {
+            onFinished();
         }
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run(task));
+}
+
+///
+/// \brief Starts the journal over from blank frames of the sprite size.
+/// \param frameCount = Number of blank frames
+///
+void Canvas::startBlankJournal(int frameCount)
+{
+    Journal::Base base{m_spriteSize, QString(), ProjectFile::Generation()};
+    base.generation.frameCount = quint32(frameCount);
+    if (!m_journal.start(base)) {
+        qWarning() << "Unable to start the journal:" << m_journal.errorString();
     }
 }
 
 ///
-/// \brief Helper method to save the current sprite image vector into a JSON formatted
-/// .ssp file. Loops through every row and column of each image and adds the rgba value
-/// of every pixel into a 2D array that makes an image. Adds the frames, height, width,
-/// and number of frames to each file.
-///
-void Canvas::saveProject(QFile &file) {
-    QJsonObject project;
-    // Store frame data
-    QJsonArray jsonFrames;
-    // loop through m_frames
-    for (const QImage &frame : m_frames) {
-        QJsonArray frameRows;
-        // loop through rowPixels in frame
-        for (int rowIndex = 0; rowIndex < frame.height(); ++rowIndex) {
-            QJsonArray rowPixels;
-            // loop through all pixels in that row
-            for (int columnIndex = 0; columnIndex < frame.width(); ++columnIndex) {
-                // Get the color
-                const QColor color(frame.pixelColor(columnIndex, rowIndex));
-                // if the color has transparency
-                bool hasTransparency = color.alpha() != 255;
-                QJsonObject colorInfo{
-                    {"r", color.red()},
-                    {"g", color.green()},
-                    {"b", color.blue()}
-                };
-                // Add the alpha value
-                if (hasTransparency) {
-                    colorInfo["a"] = color.alpha();
-                }
-                rowPixels.append(colorInfo);
-            }
-            // Add the pixels in row
-            frameRows.append(rowPixels);
+/// \brief Starts writing the frames to an autosave file once the journal has grown past
+/// its compaction size, so the journal can start over from the autosave. Every change
+/// is already in the journal, so nothing is written before that. Copying the frame list
+/// only shares it, so the worker thread writes a snapshot that later strokes detach
+/// from instead of pausing them. Nothing is started while the previous autosave is
+/// still being written.
+///
+void Canvas::autosave()
+{
+    // A stroke is journaled as a whole when it ends, so no snapshot is taken halfway through one
+    if (m_autosaveWatcher->isRunning() || m_isDrawing || !m_journal.isOpen() || m_journal.size() < Journal::CompactionSize) {
+        return;
+    }
+    QString fileName = autosaveFileName(m_autosaveSlot);
+    if (!QDir().mkpath(QFileInfo(fileName).absolutePath())) {
+        qWarning() << "Unable to create the autosave folder for" << fileName;
+        return;
+    }
+    m_autosaveMark = m_journal.mark();
+    m_autosaveBase = std::make_shared<Journal::Base>(Journal::Base{m_spriteSize, fileName, ProjectFile::Generation()});
+    std::shared_ptr<Journal::Base> base = m_autosaveBase;
+    FrameList frames = m_frames;
+    m_autosaveWatcher->setFuture(QtConcurrent::run([base, frames]() {
+        // Run length coding keeps the write short without the cost of zlib on every save.
+        ProjectFile project(base->fileName);
+        if (!project.write(base->spriteSize, frames, ProjectFile::Format::Binary, FrameCodec::Encoding::RunLength)) {
+            return project.errorString();
         }
-        // Add the frame
-        jsonFrames.append(frameRows);
+        base->generation = project.generation();
+        return QString();
+    }));
+}
+
+///
+/// \brief Compacts the journal to the autosave that was written, or logs why the
+/// autosave failed so the next check tries again.
+///
+void Canvas::autosaveFinished()
+{
+    QString error = m_autosaveWatcher->result();
+    if (!error.isEmpty()) {
+        qWarning() << "Autosave failed:" << error;
+    } else if (m_journal.compact(m_autosaveMark, *m_autosaveBase)) {
+        m_autosaveSlot = (m_autosaveSlot + 1) % AutosaveSlots;
     }
-    // Add the m_frames data
-    project["m_frames"] = jsonFrames;
-    project["height"] = m_spriteSize.height();
-    project["width"] = m_spriteSize.width();
-    project["numOfm_frames"] = m_frames.size();
-    // Write the JSON data
-    QJsonDocument jsonDoc(project);
-    file.write(jsonDoc.toJson());
+    m_autosaveBase.reset();
 }
 
 ///
-/// \brief Helper method to load a sprite image vector from a JSON formatted array.
+/// \brief Helper method to load a sprite image vector from a binary or legacy JSON .ssp file.
+/// The file is read on the thread pool behind a progress dialog that can cancel it.
 ///
-/// \param file = .ssp file to load onto drawing canvas
+/// \param fileName = .ssp file to load onto drawing canvas
 ///
-void Canvas::loadProject(QFile &file)
+void Canvas::loadProject(const QString &fileName)
 {
-    // Read the JSON data use readAll
-    QByteArray jsonData = file.readAll();
-    QJsonDocument jsonDoc(QJsonDocument::fromJson(jsonData));
-    QJsonObject project = jsonDoc.object();
-    // Get height, width, and numOfm_frames
-    int height = project["height"].toInt();
-    int width = project["width"].toInt();
-    int numOfm_frames = project["numOfm_frames"].toInt();
-    // Set m_spriteSize and clear m_frames
-    m_spriteSize = QSize(width, height);
-    m_frames.clear();
-    // Get the m_frames data
-    QJsonArray jsonFrames = project["m_frames"].toArray();
-    // loop through m_frames
-    for (const QJsonValue &frameValue : jsonFrames) {
-        QJsonArray frameRows = frameValue.toArray();
-        QImage frame(width, height, QImage::Format_ARGB32);
-        // loop through rowPixels in frame
-        int rowIndex = 0;
-        for (const QJsonValue &rowValue : frameRows) {
-            QJsonArray rowPixels = rowValue.toArray();
-            // loop through all pixels in that row
-            int columnIndex = 0;
-            for (const QJsonValue &pixelValue : rowPixels) {
-                QJsonObject colorInfo = pixelValue.toObject();
-                // Get the color value
-                int r = colorInfo["r"].toInt();
-                int g = colorInfo["g"].toInt();
-                int b = colorInfo["b"].toInt();
-                int a = colorInfo.contains("a") ? colorInfo["a"].toInt() : 255;
-                // Set the color
-                frame.setPixelColor(columnIndex, rowIndex, QColor(r, g, b, a));
-                columnIndex++;
+    // Frames are decoded on the thread pool while the dialog reports progress and keeps
+    // the window responsive. Canceling stops the decoding and keeps the current sprite.
+    // The dialog is shown straight away, so no stroke or button press reaches the window
+    // while the loop runs, and no autosave starts either.
+    ProjectFile project(fileName);
+    bool isLoaded = false;
+    QProgressDialog progress("Loading " + QFileInfo(fileName).fileName() + "...", "Cancel", 0, 0, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(0);
+    progress.show();
+    m_autosaveTimer->stop();
+    QFutureWatcher<void> watcher;
+    QEventLoop loop;
+    connect(&watcher, &QFutureWatcher<void>::progressRangeChanged, &progress, &QProgressDialog::setRange);
+    connect(&watcher, &QFutureWatcher<void>::progressValueChanged, &progress, &QProgressDialog::setValue);
+    connect(&watcher, &QFutureWatcher<void>::finished, &loop, &QEventLoop::quit);
+    connect(&progress, &QProgressDialog::canceled, &watcher, &QFutureWatcher<void>::cancel);
+    watcher.setFuture(QtConcurrent::run([&project, &isLoaded](QPromise<void> &promise) {
+        isLoaded = project.read([&promise](int decoded, int total) {
+            if (decoded == 0) {
+                promise.setProgressRange(0, total);
             }
-            rowIndex++;
-        }
-        // Add the frame
-        m_frames.append(frame);
+            promise.setProgressValue(decoded);
+            return !promise.isCanceled();
+        });
+    }));
+    loop.exec();
+    watcher.waitForFinished();
+    progress.reset();
+    m_autosaveTimer->start(AutosaveInterval);
+    if (watcher.isCanceled()) {
+        return;
+    }
+    if (!isLoaded) {
+        QMessageBox::warning(this, "Unable to load!", project.errorString());
+        return;
+    }
+    setLoadedFrames(project.spriteSize(), project.frames());
+    // The project is already on disk, so the journal starts from it rather than its frames
+    if (!m_journal.start(Journal::Base{m_spriteSize, QFileInfo(fileName).absoluteFilePath(), project.generation()})) {
+        qWarning() << "Unable to start the journal:" << m_journal.errorString();
+    }
+}
+
+///
+/// \brief Helper method to import a sprite sheet or an animated image as the frames
+/// of a new sprite. The image is read on the thread pool behind a progress dialog,
+/// and the frames are written to an autosave there too, so the journal starts from
+/// that file instead of recording every imported frame.
+///
+/// \param fileName = Image to import
+/// \param isAnimation = If the image is an animation rather than a sheet
+/// \param cellSize = Size of a sheet cell, or an empty size to slice along transparent gutters
+///
+void Canvas::importFrames(const QString &fileName, bool isAnimation, const QSize &cellSize)
+{
+    // The next slot is never the journal's base; it is skipped while an autosave writes it,
+    // which lasts until autosaveFinished() has compacted the journal to it
+    const int slot = m_autosaveBase ? (m_autosaveSlot + 1) % AutosaveSlots : m_autosaveSlot;
+    const QString autosaveName = autosaveFileName(slot);
+    if (!QDir().mkpath(QFileInfo(autosaveName).absolutePath())) {
+        qWarning() << "Unable to create the autosave folder for" << autosaveName;
+    }
+    FrameImporter importer(fileName);
+    ProjectFile autosave(autosaveName);
+    bool isImported = false;
+    bool isAutosaved = false;
+    // Shown straight away, so no stroke or button press reaches the window while the loop runs
+    QProgressDialog progress("Importing " + QFileInfo(fileName).fileName() + "...", QString(), 0, 0, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(0);
+    progress.show();
+    QFutureWatcher<void> watcher;
+    QEventLoop loop;
+    connect(&watcher, &QFutureWatcher<void>::finished, &loop, &QEventLoop::quit);
+    // No autosave may start on the slot the import writes while the dialog is shown
+    m_autosaveTimer->stop();
+    watcher.setFuture(QtConcurrent::run([&importer, &autosave, &isImported, &isAutosaved, isAnimation, cellSize]() {
+        isImported = isAnimation ? importer.readAnimation() : importer.readSheet(cellSize);
+        // Run length coding, as for every autosave
+        isAutosaved = isImported && autosave.write(importer.spriteSize(), importer.frames(), ProjectFile::Format::Binary,
+                                                   FrameCodec::Encoding::RunLength);
+    }));
+    loop.exec();
+    watcher.waitForFinished();
+    progress.reset();
+    m_autosaveTimer->start(AutosaveInterval);
+    if (!isImported) {
+        QMessageBox::warning(this, "Unable to import!", importer.errorString());
+        return;
     }
+    setLoadedFrames(importer.spriteSize(), importer.frames());
+    if (isAutosaved && m_journal.start(Journal::Base{m_spriteSize, autosaveName, autosave.generation()})) {
+        m_autosaveSlot = (slot + 1) % AutosaveSlots;
+        return;
+    }
+    qWarning() << "Unable to journal the imported frames from an autosave:"
+               << (isAutosaved ? m_journal.errorString() : autosave.errorString());
+    // Without the autosave, the journal records the frames drawn on blank frames
+    startBlankJournal(m_frames.size());
+    const Frame blank(m_spriteSize);
+    for (int index = 0; index < m_frames.size(); index++) {
+        m_journal.recordPixels(index, blank, m_frames.at(index));
+    }
+}
+
+///
+/// \brief Replaces the sprite with loaded frames and updates the canvas and the
+/// frame buttons to show the last of them.
+///
+void Canvas::setLoadedFrames(const QSize &spriteSize, const FrameList &frames)
+{
+    m_spriteSize = spriteSize;
+    m_frames = frames;
+    int numOfm_frames = m_frames.size();
     // Update the canvas
-    m_imageScale = 512 / m_spriteSize.width();
-    m_zoomScale = m_imageScale;
-    setDefaultBackground();
+    m_viewport.setSpriteSize(m_spriteSize);
+    m_viewport.fitToWidget();
     m_currentFrameIndex = m_frames.size() - 1;
-    m_spriteImage = m_frames.at(m_currentFrameIndex).copy();
-    copyAndScaleImage();
-    update();
+    m_frameScheduler->requestFullRepaint();
     emit updateFrameNumber(numOfm_frames - 1);
     // Check if there are previous m_frames
     if (m_currentFrameIndex > 0) {
@@ -315,41 +755,22 @@ void Canvas::loadProject(QFile &file)
     }
 }
 
-///
-/// \brief Helper method to scale the current image to size.
-///
-void Canvas::copyAndScaleImage(){
-    m_scaledImage = m_spriteImage.copy();
-    m_scaledImage = m_scaledImage.scaled(m_spriteImage.width() * m_zoomScale, m_spriteImage.height() * m_zoomScale, Qt::KeepAspectRatio, Qt::FastTransformation);
-}
-
-///
-/// \brief Helper method to scale the default background image to size.
-///
-void Canvas::copyAndScaleDefaultImage(){
-    m_scaledDefaultBackground = m_defaultImage.copy();
-    m_scaledDefaultBackground = m_scaledDefaultBackground.scaled(m_spriteImage.width() * m_zoomScale, m_spriteImage.height() * m_zoomScale, Qt::KeepAspectRatio, Qt::FastTransformation);
-}
-
 ///
 /// \brief Adds a frame to the sprite image vector. Initializes with a default
 /// background.
 ///
 void Canvas::on_addFrameClicked(){
-    m_spriteImage = QImage(m_spriteSize, QImage::Format_ARGB32);
-    m_spriteImage.fill(QColorConstants::Transparent);
     if(m_currentFrameIndex == m_frames.size() - 1){
-        m_frames.append(m_spriteImage);
+        m_frames.append(Frame(m_spriteSize));
         m_currentFrameIndex++;
         emit disableNextButton();
     }
     else{
         m_currentFrameIndex++;
-        m_frames.insert(m_currentFrameIndex, m_spriteImage);
+        m_frames.insert(m_currentFrameIndex, Frame(m_spriteSize));
     }
-    copyAndScaleImage();
-    copyAndScaleDefaultImage();
-    update();
+    m_journal.recordInsert(m_currentFrameIndex, -1);
+    m_frameScheduler->requestFullRepaint();
     emit enableLastButton();
     emit enableDeleteButton();
     emit updateFrameNumber(m_currentFrameIndex);
@@ -361,6 +782,7 @@ void Canvas::on_addFrameClicked(){
 /// deletion convention.
 ///
 void Canvas::on_deleteCurrentFrameClicked(){
+    m_journal.recordRemove(m_currentFrameIndex);
     if(m_currentFrameIndex == m_frames.size() - 1){
         m_frames.removeAt(m_currentFrameIndex);
         m_currentFrameIndex--;
@@ -384,9 +806,7 @@ void Canvas::on_deleteCurrentFrameClicked(){
     else{
         emit disableLastButton();
     }
-    m_spriteImage = m_frames.at(m_currentFrameIndex).copy();
-    copyAndScaleImage();
-    update();
+    m_frameScheduler->requestFullRepaint();
     emit updateFrameNumber(m_currentFrameIndex);
 }
 
@@ -395,9 +815,7 @@ void Canvas::on_deleteCurrentFrameClicked(){
 ///
 void Canvas::on_lastFrameClicked(){
     m_currentFrameIndex--;
-    m_spriteImage = m_frames.at(m_currentFrameIndex).copy();
-    copyAndScaleImage();
-    update();
+    m_frameScheduler->requestFullRepaint();
     if(m_currentFrameIndex == 0){
         emit disableLastButton();
     }
@@ -410,9 +828,7 @@ void Canvas::on_lastFrameClicked(){
 ///
 void Canvas::on_nextFrameClicked(){
     m_currentFrameIndex++;
-    m_spriteImage = m_frames.at(m_currentFrameIndex).copy();
-    copyAndScaleImage();
-    update();
+    m_frameScheduler->requestFullRepaint();
     emit enableLastButton();
     if(m_currentFrameIndex != m_frames.size() - 1){
         emit enableNextButton();
@@ -427,17 +843,19 @@ void Canvas::on_nextFrameClicked(){
 /// \brief Creates a duplicate frame and adds it to the sprite image vector.
 ///
 void Canvas::on_duplicateFrameClicked(){
+    // Copying a frame only shares its tiles until one of the copies is drawn on
+    Frame duplicate = m_frames.at(m_currentFrameIndex);
     if(m_currentFrameIndex == m_frames.size() - 1){
-        m_frames.append(m_spriteImage);
+        m_frames.append(duplicate);
         m_currentFrameIndex++;
         emit disableNextButton();
     }
     else{
         m_currentFrameIndex++;
-        m_frames.insert(m_currentFrameIndex, m_spriteImage);
+        m_frames.insert(m_currentFrameIndex, duplicate);
     }
-    copyAndScaleImage();
-    update();
+    m_journal.recordInsert(m_currentFrameIndex, m_currentFrameIndex - 1);
+    m_frameScheduler->requestFullRepaint();
     emit enableLastButton();
     emit enableDeleteButton();
     emit updateFrameNumber(m_currentFrameIndex);
@@ -447,8 +865,10 @@ void Canvas::on_duplicateFrameClicked(){
 /// \brief Clears the current sprite image.
 ///
 void Canvas::on_clearFrameClicked(){
-      m_spriteImage.fill(QColorConstants::Transparent);
-      m_frames.replace(m_currentFrameIndex, m_spriteImage);
+      Frame before = m_frames.at(m_currentFrameIndex);
+      currentFrameForWriting().fill(qRgba(0, 0, 0, 0));
+      m_journal.recordPixels(m_currentFrameIndex, before, m_frames.at(m_currentFrameIndex));
+      m_frameScheduler->requestFullRepaint();
 }
 
 ///
@@ -458,22 +878,18 @@ void Canvas::on_clearFrameClicked(){
 void Canvas::on_setSpriteSizeClicked() {
     bool Done;
     int size = QInputDialog::getInt(this,"Sprite size:", "WARNING: any unsaved data will be lost.\nEnter a size and click ok to create a new sprite. Use powers of two for best results",
-                                    m_spriteSize.width(), 2, 128, 1, &Done);
+                                    m_spriteSize.width(), 2, 16384, 1, &Done);
     if (Done) {
         m_frames.clear();
         m_spriteSize = (QSize(size, size));
-        m_spriteImage = QImage(m_spriteSize, QImage::Format_ARGB32);
-        m_spriteImage.fill(QColorConstants::Transparent);
-        m_frames.append(m_spriteImage);
-        setDefaultBackground();
-        m_imageScale = 512 / m_spriteSize.width();
-        m_zoomScale = m_imageScale;
+        m_frames.append(Frame(m_spriteSize));
+        m_viewport.setSpriteSize(m_spriteSize);
+        m_viewport.fitToWidget();
         m_currentColor = Qt::black;
         m_brushAndEraserSize = 1;
         m_currentFrameIndex = 0;
-        copyAndScaleImage();
-        copyAndScaleDefaultImage();
-        update();
+        startBlankJournal(1);
+        m_frameScheduler->requestFullRepaint();
         emit disableNextButton();
         emit disableLastButton();
         emit disableDeleteButton();
@@ -481,38 +897,199 @@ void Canvas::on_setSpriteSizeClicked() {
     }
 }
 
+///
+/// \brief Offers to recover the changes the journal of the last session holds, and
+/// starts a new journal if there are none or the user declines.
+///
+void Canvas::recoverFromJournal() {
+    const QString fileName = journalFileName();
+    if (!QDir().mkpath(QFileInfo(fileName).absolutePath())) {
+        qWarning() << "Unable to create the journal folder for" << fileName;
+        return;
+    }
+    // A journal compacted to an autosave holds work that was never saved either
+    const bool isOpened = m_journal.open();
+    const QString baseFileName = m_journal.base().fileName;
+    int baseSlot = -1;
+    for (int slot = 0; slot < AutosaveSlots; slot++) {
+        if (baseFileName == autosaveFileName(slot)) {
+            baseSlot = slot;
+        }
+    }
+    const bool isAutosaved = baseSlot >= 0;
+    if (isOpened && (m_journal.recordCount() > 0 || isAutosaved)) {
+        QMessageBox::StandardButton answer = QMessageBox::question(this, "Recover unsaved work",
+            "The last session ended with changes that were never saved. Recover them?");
+        if (answer == QMessageBox::Yes) {
+            QSize spriteSize;
+            FrameList frames;
+            // The recovered frames go on being journaled from where the last session stopped
+            if (m_journal.restore(spriteSize, frames)) {
+                setLoadedFrames(spriteSize, frames);
+                // The autosave the journal starts from must not be the next one replaced
+                if (isAutosaved) {
+                    m_autosaveSlot = (baseSlot + 1) % AutosaveSlots;
+                }
+                return;
+            }
+            QMessageBox::warning(this, "Unable to recover!", m_journal.errorString());
+        }
+    }
+    startBlankJournal(m_frames.size());
+}
+
 ///
 /// \brief Cues the file to be saved in an .ssp format to whatever
-/// file path the user chooses.
+/// file path the user chooses. The file type picks binary or legacy JSON, and binary
+/// projects ask which compression to use for the frames.
 ///
 void Canvas::on_SaveClicked() {
-    QString fileName = QFileDialog::getSaveFileName(this, "Save Project", "", "Sprite Sheet Project (*.ssp)");
-    if (!fileName.isEmpty()) {
-        QFile file(fileName);
-        if (file.open(QIODevice::WriteOnly)) {
-            saveProject(file);
-            file.close();
-        } else {
-            QMessageBox::warning(this, "Unable to save project", file.errorString());
+    const QString binaryFilter = "Sprite Sheet Project (*.ssp)";
+    const QString legacyFilter = "Legacy JSON Sprite Sheet Project (*.ssp)";
+    QString selectedFilter;
+    QString fileName = QFileDialog::getSaveFileName(this, "Save Project", "", binaryFilter + ";;" + legacyFilter, &selectedFilter);
+    if (fileName.isEmpty()) {
+        return;
+    }
+    if (selectedFilter == legacyFilter) {
+        saveProject(fileName, ProjectFile::Format::LegacyJson, FrameCodec::Encoding::Raw);
+        return;
+    }
+    const QStringList compressions = {"None", "Zlib", "Run-length", "Palette", "Animation deltas"};
+    const QVector<FrameCodec::Encoding> encodings = {FrameCodec::Encoding::Raw, FrameCodec::Encoding::Zlib,
+                                                    FrameCodec::Encoding::RunLength, FrameCodec::Encoding::Palette8,
+                                                    FrameCodec::Encoding::Delta};
+    bool chosen;
+    QString compression = QInputDialog::getItem(this, "Frame compression", "Compress frames with:", compressions, 0, false, &chosen);
+    if (chosen) {
+        saveProject(fileName, ProjectFile::Format::Binary, encodings.at(compressions.indexOf(compression)));
+    }
+}
+
+///
+/// \brief Asks where to export a texture atlas and writes the frames as trimmed, packed
+/// PNG pages and JSON metadata on the thread pool.
+///
+void Canvas::on_ExportAtlasClicked() {
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Atlas", "", "Texture Atlas (*.json)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+    if (!fileName.endsWith(".json", Qt::CaseInsensitive)) {
+        fileName += ".json";
+    }
+    FrameList frames = m_frames;
+    QSize spriteSize = m_spriteSize;
+    runInBackground("Unable to export atlas", [fileName, spriteSize, frames]() {
+        AtlasExporter exporter(fileName);
+        if (!exporter.write(spriteSize, frames)) {
+            return exporter.errorString();
         }
+        return QString();
+    });
+}
+
+///
+/// \brief Asks where to export an animated GIF or PNG and streams the frames into it
+/// on the thread pool, timed at the preview's frame rate.
+///
+void Canvas::on_ExportAnimationClicked() {
+    QString selectedFilter;
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Animation", "",
+                                                    "Animated GIF (*.gif);;Animated PNG (*.png)", &selectedFilter);
+    if (fileName.isEmpty()) {
+        return;
+    }
+    const bool gif = fileName.endsWith(".gif", Qt::CaseInsensitive)
+                     || (!fileName.endsWith(".png", Qt::CaseInsensitive) && selectedFilter.contains("*.gif"));
+    if (!fileName.endsWith(gif ? ".gif" : ".png", Qt::CaseInsensitive)) {
+        fileName += gif ? ".gif" : ".png";
     }
+    FrameList frames = m_frames;
+    QSize spriteSize = m_spriteSize;
+    int frameRate = m_frameRate;
+    runInBackground("Unable to export animation", [fileName, spriteSize, frames, frameRate, gif]() {
+        QSaveFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly)) {
+            return file.errorString();
+        }
+        std::unique_ptr<AnimationEncoder> encoder;
+        if (gif) {
+            encoder = std::make_unique<GifEncoder>(file);
+        } else {
+            encoder = std::make_unique<ApngEncoder>(file);
+        }
+        // Frames are decoded one at a time, so only the two the encoder holds stay in memory
+        if (!encoder->begin(spriteSize, frameRate)) {
+            return encoder->errorString();
+        }
+        for (int index = 0; index < frames.size(); index++) {
+            if (!encoder->addFrame(frames.at(index))) {
+                return encoder->errorString();
+            }
+        }
+        if (!encoder->finish()) {
+            return encoder->errorString();
+        }
+        if (!file.commit()) {
+            return file.errorString();
+        }
+        return QString();
+    });
+}
+
+///
+/// \brief Sets the frame rate used when exporting animations.
+/// \param framesPerSecond = Rate the preview plays at
+///
+void Canvas::setFrameRate(int framesPerSecond) {
+    m_frameRate = framesPerSecond;
 }
 
 ///
 /// \brief Cues the file to be loaded from an .ssp file into a modifiable
-/// sprite vector that appears on the drawing canvas.
+/// sprite vector that appears on the drawing canvas. Sprite sheet images and
+/// animated GIF or PNG files are imported into a new sprite instead.
 ///
 void Canvas::on_LoadClicked() {
-    QString fileName = QFileDialog::getOpenFileName(this, "Loading", "", "Sprite Sheet Project (*.ssp)");
-    if (!fileName.isEmpty()) {
-        QFile file(fileName);
-        if (file.open(QIODevice::ReadOnly)) {
-            loadProject(file);
-            file.close();
-        } else {
-            QMessageBox::warning(this, "Unable to load!", file.errorString());
+    const QString projectFilter = "Sprite Sheet Project (*.ssp)";
+    const QString sheetFilter = "Sprite Sheet Image (*.png *.bmp *.jpg *.jpeg)";
+    const QString animationFilter = "Animated Image (*.gif *.png)";
+    QString selectedFilter;
+    QString fileName = QFileDialog::getOpenFileName(this, "Loading", "", projectFilter + ";;" + sheetFilter + ";;" + animationFilter,
+                                                    &selectedFilter);
+    if (fileName.isEmpty()) {
+        return;
+    }
+    if (fileName.endsWith(".ssp", Qt::CaseInsensitive)) {
+        loadProject(fileName);
+        return;
+    }
+    if (selectedFilter == animationFilter || fileName.endsWith(".gif", Qt::CaseInsensitive)) {
+        importFrames(fileName, true, QSize());
+        return;
+    }
+    const QStringList slicings = {"Transparent gutters", "Grid"};
+    bool chosen;
+    QString slicing = QInputDialog::getItem(this, "Import sprite sheet", "Slice frames along:", slicings, 0, false, &chosen);
+    if (!chosen) {
+        return;
+    }
+    QSize cellSize;
+    if (slicing == "Grid") {
+        int width = QInputDialog::getInt(this, "Import sprite sheet", "Cell width:", m_spriteSize.width(), 1,
+                                         FrameImporter::MaximumSpriteSide, 1, &chosen);
+        if (!chosen) {
+            return;
         }
+        int height = QInputDialog::getInt(this, "Import sprite sheet", "Cell height:", width, 1,
+                                          FrameImporter::MaximumSpriteSide, 1, &chosen);
+        if (!chosen) {
+            return;
+        }
+        cellSize = QSize(width, height);
     }
+    importFrames(fileName, false, cellSize);
 }
 
 ///
@@ -598,23 +1175,17 @@ void Canvas::setColor(){
 }
 
 ///
-/// \brief Zooms the drawing canvas in.
+/// \brief Zooms the drawing canvas in around its center.
 ///
 void Canvas::zoomIn(){
-    int overFlowCheck = m_zoomScale * 2;
-    if(!(overFlowCheck > m_imageScale)){
-        m_zoomScale *= 2;
-    }
-    update();
+    m_viewport.zoomBy(2, QRectF(rect()).center());
+    m_frameScheduler->requestFullRepaint();
 }
 
 ///
-/// \brief Zooms the drawing canvas out.
+/// \brief Zooms the drawing canvas out around its center.
 ///
 void Canvas::zoomOut(){
-    int underFlowCheck = m_zoomScale / 2;
-    if(!(underFlowCheck < 1)){
-        m_zoomScale /= 2;
-    }
-    update();
+    m_viewport.zoomBy(0.5, QRectF(rect()).center());
+    m_frameScheduler->requestFullRepaint();
 }
@@ -6,16 +6,48 @@
 #include <QColorDialog>
 #include <QInputDialog>
 #include <QPaintEvent>
+#include <QTabletEvent>
+#include <QWheelEvent>
+#include <QResizeEvent>
+#include <QtMath>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QFutureWatcher>
+#include <QEventLoop>
+#include <QProgressDialog>
+#include <QtConcurrent>
+#include <QStandardPaths>
+#include <QDir>
+#include <QFileInfo>
+#include <QRegion>
 #include <QWidget>
 #include <QDebug>
+#include <QLoggingCategory>
 #include <QFile>
 #include <QFileDialog>
+#include <QSaveFile>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QMessageBox>
 #include <string>
 #include <queue>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include "apngencoder.h"
+#include "atlasexporter.h"
+#include "frame.h"
+#include "frameimporter.h"
+#include "framelist.h"
+#include "framescheduler.h"
+#include "gifencoder.h"
+#include "journal.h"
+#include "latencyhistogram.h"
+#include "pixelscaler.h"
+#include "projectfile.h"
+#include "stampengine.h"
+#include "viewport.h"
 
 ///
 /// \brief The canvas class is a promoted QWidget that stores all data and methods necessary for
@@ -38,95 +70,305 @@ public:
     ///
     explicit Canvas(QWidget *parent = nullptr);
 
+    ///
+    /// \brief Returns the scheduler that coalesces the canvas repaints. Its counters
+    /// show how many repaints were requested and how many were actually delivered.
+    ///
+    const FrameScheduler *frameScheduler() const;
+
+    ///
+    /// \brief Returns the histogram of the time between an input event arriving and
+    /// its stroke being written into the frame.
+    ///
+    const LatencyHistogram &inputLatency() const;
+
+    ///
+    /// \brief Returns the path of one of the binary projects the canvas autosaves to.
+    /// Autosaves and imports take turns between them, so neither the one the journal
+    /// starts from nor the one an autosave is still writing is ever the one replaced.
+    /// \param slot = 0 to AutosaveSlots - 1
+    ///
+    static QString autosaveFileName(int slot);
+
+    ///
+    /// \brief Returns the path of the journal that records every change to the frames.
+    ///
+    static QString journalFileName();
+
+    ///
+    /// \brief Milliseconds between autosave checks.
+    ///
+    static constexpr int AutosaveInterval = 5000;
+
+    ///
+    /// \brief Number of autosave files: the journal's base, the one an autosave is writing,
+    /// and one for an import started meanwhile.
+    ///
+    static constexpr int AutosaveSlots = 3;
+
 protected:
     ///
-    /// \brief Prompts the draw method on the point that was pressed.
+    /// \brief Starts a stroke at the point that was pressed, or starts panning the
+    /// view if the middle button was pressed.
     /// \param event = Mouse button pressed
     ///
     void mousePressEvent(QMouseEvent *event) override;
 
     ///
-    /// \brief Prompts the draw method when the mouse moves if
-    ///  the left mouse button is held down.
+    /// \brief Queues the mouse position for drawing if
+    ///  the left mouse button is held down, or pans the view with the middle button.
     /// \param event = Mouse moving
     ///
     void mouseMoveEvent(QMouseEvent *event) override;
 
     ///
-    /// \brief Prompts the draw method at the point where
-    /// the user released the mouse button and stops drawing.
+    /// \brief Draws up to the point where
+    /// the user released the mouse button and stops drawing or panning.
     /// \param event = Mouse released
     ///
     void mouseReleaseEvent(QMouseEvent *event) override;
 
     ///
-    /// \brief Paints a 512x512 rectangle scaled by the images width and height.
-    /// If zoomed in, the rectangle is scaled by the zoom factor instead of 512x512.
+    /// \brief Handles pen input the same way as mouse input, with the pen pressure
+    /// scaling the brush size. Accepting the event stops Qt from also sending the
+    /// matching mouse events.
+    /// \param event = Tablet pen event
+    ///
+    void tabletEvent(QTabletEvent *event) override;
+
+    ///
+    /// \brief Zooms the view around the cursor. One wheel notch zooms by a quarter.
+    /// \param event = Mouse wheel turned
+    ///
+    void wheelEvent(QWheelEvent *event) override;
+
+    ///
+    /// \brief Keeps the view centered when the canvas is resized. The first resize
+    /// fits the sprite to the canvas.
+    /// \param event = Canvas resized
+    ///
+    void resizeEvent(QResizeEvent *event) override;
+
+    ///
+    /// \brief Adds a raw input position to the queue drawn on the next frame. Any
+    /// number of samples can arrive between two frames; they are drawn as one batch.
+    /// \param position = Position in widget coordinates
+    /// \param pressure = Pen pressure between 0 and 1, 1 for the mouse
+    /// \param startsStroke = If the sample begins a new stroke
+    ///
+    void queueStrokeSample(const QPointF &position, qreal pressure, bool startsStroke);
+
+    ///
+    /// \brief Draws every queued sample as one batch, invalidates the result once and
+    /// records each sample's latency.
+    ///
+    void processPendingInput();
+
+    ///
+    /// \brief Starts a stroke on the current frame, remembering the frame as it was so
+    /// the stroke can be journaled once it ends.
+    ///
+    void beginStroke();
+
+    ///
+    /// \brief Draws whatever is still queued, ends the current stroke and journals it.
+    ///
+    void finishStroke();
+
+    ///
+    /// \brief Repaints only the sprite pixels covered by the event's dirty rectangle,
+    /// so the cost follows what is on screen rather than the sprite size. At whole
+    /// number zooms the pixels are blended over the checkerboard at sprite resolution
+    /// and magnified straight into the reusable compose buffer; other zooms draw in
+    /// sprite coordinates through the viewport transform.
     /// \param event
     ///
     void paintEvent(QPaintEvent *event) override;
 
     ///
-    /// \brief Draws onto the canvas by modifying the image based on mousePoint.
-    /// \param mousePoint = Given mouse cursor point.
+    /// \brief Blends part of a frame over the transparency checkerboard into the top left
+    /// of the sprite compose image, one pixel per sprite pixel. The image only grows.
+    /// \param frame = Frame to blend
+    /// \param spriteArea = Sprite pixels to blend
     ///
-    void draw(const QPoint &endPoint);
+    void composeOverChecker(const Frame &frame, const QRect &spriteArea);
 
     ///
-    /// \brief Helper method for the bucket tool that uses the flood fill algorithm.
+    /// \brief Records that the given sprite pixels changed and must be repainted.
+    /// \param spriteRect = Rectangle in sprite pixel coordinates
+    ///
+    void markSpriteDirty(const QRect &spriteRect);
+
+    ///
+    /// \brief Requests a repaint of the screen rectangles covering every sprite
+    /// pixel marked dirty since the last flush.
+    ///
+    void flushDirtyRegion();
+
+    ///
+    /// \brief Maps a screen point to the sprite pixel under it. Points off the sprite are
+    /// clamped to just past its edge, so strokes dragged far outside stay short.
+    /// \param screenPoint = Point in widget coordinates
+    ///
+    QPoint screenToSpritePoint(const QPoint &screenPoint) const;
+
+    ///
+    /// \brief Drags the brush along a line with Bresenham's algorithm. The first stamp
+    /// is a full brush square; every step after it only adds the row and column the
+    /// square moved into, so a segment costs its length times the brush width instead
+    /// of times the brush area. The stamp engine segment must already be started, so
+    /// many segments can be written as one batch.
+    /// \param startPoint = First sprite pixel of the segment
+    /// \param endPoint = Last sprite pixel of the segment
+    /// \param size = Brush width in sprite pixels
+    ///
+    void drawSegment(const QPoint &startPoint, const QPoint &endPoint, int size);
+
+    ///
+    /// \brief Stamps a rectangle with the tile tool. Parts of the stamp in the right half
+    /// are repeated one half width to the left, parts in the top half are repeated one
+    /// half height down, and parts in both are repeated diagonally.
+    /// \param stampRect = Brush rectangle in sprite pixel coordinates
+    /// \param pixel = Packed color to stamp
+    ///
+    void stampTiled(const QRect &stampRect, QRgb pixel);
+
+    ///
+    /// \brief Returns the current frame in the frame store for writing. Only the tiles
+    /// that are written to get detached from other copies of the frame.
+    ///
+    Frame &currentFrameForWriting();
+
+    ///
+    /// \brief Helper method for the bucket tool. Fills the region of the clicked color
+    /// with the current color using the frame's scanline flood fill, which writes the
+    /// tiles directly and reports the filled bounds.
     /// \param x = Mouse point's x position
     /// \param y = Mouse point's y position
     ///
     void bucketTool(int x, int y);
 
     ///
-    /// \brief Creates a default gray checkered background when a new frame
-    /// is added.
+    /// \brief Returns a brush that tiles the gray transparency checkerboard with one
+    /// cell per sprite pixel. The painter's viewport transform scales it to the zoom,
+    /// so the single 2x2 pixel tile is built once.
+    ///
+    const QBrush &checkerBrush();
+
+    ///
+    /// \brief Helper method to save the sprite frames into an .ssp file in the chosen format.
+    /// The frame list is copied, which only shares it, and the copy is encoded and written
+    /// on the thread pool, so drawing can go on while the project is saved. Once it is
+    /// saved, unchanged frames are read from the new file, so saving to it again only
+    /// appends what changed, and the journal is compacted to it. Saves run one at a time:
+    /// one asked for while another is being written waits for it, as two appends to the
+    /// same file would overwrite each other.
+    /// \param fileName = Path of the .ssp file
+    /// \param format = Binary container or legacy JSON
+    /// \param encoding = Frame encoding used by the binary container
+    ///
+    void saveProject(const QString &fileName, ProjectFile::Format format, FrameCodec::Encoding encoding);
+
+    ///
+    /// \brief Helper method to load a sprite image vector from a binary or legacy JSON .ssp file.
+    /// The file is read on the thread pool behind a progress dialog that can cancel it.
+    ///
+    /// \param fileName = .ssp file to load onto drawing canvas
+    ///
+    void loadProject(const QString &fileName);
+
+    ///
+    /// \brief Helper method to import a sprite sheet or an animated image as the frames
+    /// of a new sprite. The image is read on the thread pool behind a progress dialog,
+    /// and the frames are written to an autosave there too, so the journal starts from
+    /// that file instead of recording every imported frame.
     ///
-    void setDefaultBackground();
+    /// \param fileName = Image to import
+    /// \param isAnimation = If the image is an animation rather than a sheet
+    /// \param cellSize = Size of a sheet cell, or an empty size to slice along transparent gutters
+    ///
+    void importFrames(const QString &fileName, bool isAnimation, const QSize &cellSize);
 
     ///
-    /// \brief Helper method to save the current sprite image vector into a JSON formatted
-    /// .ssp file. Loops through every row and column of each image and adds the rgba value
-    /// of every pixel into a 2D array that makes an image. Adds the frames, height, width,
-    /// and number of frames to each file.
+    /// \brief Replaces the sprite with loaded frames and updates the canvas and the
+    /// frame buttons to show the last of them.
     ///
-    void saveProject(QFile &file);
+    void setLoadedFrames(const QSize &spriteSize, const FrameList &frames);
 
     ///
-    /// \brief Helper method to load a sprite image vector from a JSON formatted array.
+    /// \brief Runs a task on the thread pool and shows a warning if it returns an error.
+    /// \param errorTitle = Title of the warning
+    /// \param task = Work to run, returning an empty string or a description of the error
+    /// \param onSuccess = Called on the GUI thread once the task finished without an error
+    /// \param onFinished = Called on the GUI thread once the task finished, after the warning or onSuccess
+    ///
+    void runInBackground(const QString &errorTitle, const std::function<QString()> &task,
+                         const std::function<void()> &onSuccess = std::function<void()>(),
+                         const std::function<void()> &onFinished = std::function<void()>());
+
     ///
-    /// \param file = .ssp file to load onto drawing canvas
+    /// \brief Starts the journal over from blank frames of the sprite size.
+    /// \param frameCount = Number of blank frames
     ///
-    void loadProject(QFile &file);
+    void startBlankJournal(int frameCount);
 
     ///
-    /// \brief Helper method to scale the current image to size.
+    /// \brief Starts writing the frames to an autosave file once the journal has grown past
+    /// its compaction size, so the journal can start over from the autosave. Every change
+    /// is already in the journal, so nothing is written before that. Copying the frame list
+    /// only shares it, so the worker thread writes a snapshot that later strokes detach
+    /// from instead of pausing them. Nothing is started while the previous autosave is
+    /// still being written.
     ///
-    void copyAndScaleImage();
+    void autosave();
 
     ///
-    /// \brief Helper method to scale the default background image to size.
+    /// \brief Compacts the journal to the autosave that was written, or logs why the
+    /// autosave failed so the next check tries again.
     ///
-    void copyAndScaleDefaultImage();
+    void autosaveFinished();
 
 private:
-    QVector<QImage> m_frames; ///Vector that stores all the frames
-    QImage m_defaultImage; ///Stores the default background
-    QImage m_spriteImage; ///Stores a version of the current frame image
-    QImage m_scaledImage; ///Stores a scaled version of the current frame image
-    QImage m_scaledDefaultBackground; ///Stores a scaled version of the default bakground
+    ///
+    /// \brief One queued input position waiting to be drawn.
+    ///
+    struct StrokeSample {
+        QPoint position; ///Position in widget coordinates
+        qreal pressure; ///Pen pressure between 0 and 1
+        bool startsStroke; ///If this sample begins a new stroke
+        qint64 receivedAt; ///Time the event arrived on the input clock, in nanoseconds
+    };
+
+    FrameList m_frames; ///Stores all the frames, decoding loaded ones when they are first read
+    QBrush m_checkerBrush; ///Stores the checkerboard tile brush for the transparent background
+    QImage m_composeSprite; ///Stores the visible sprite pixels blended over the checkerboard
+    QImage m_composeBuffer; ///Stores the magnified pixels before they are drawn to the widget
     QSize m_spriteSize; ///Stores the size of the sprite
     QPoint m_lastMousePoint; ///Stores the value where the mouse was last recorded at
+    Viewport m_viewport; ///Maps between sprite and screen coordinates for painting and hit testing
+    QPointF m_panAnchor; ///Stores the last mouse position while panning
+    bool m_isPanning = false; ///Stores if the user is currently dragging the view
+    QRegion m_dirtySpriteRegion; ///Stores the sprite pixels modified since the last repaint request
+    FrameScheduler *m_frameScheduler; ///Coalesces repaint requests to one per display refresh
+    StampEngine m_stampEngine; ///Writes brush stamps into the frame scanlines
+    QVector<StrokeSample> m_pendingSamples; ///Stores input received since the last frame
+    QElapsedTimer m_inputClock; ///Timestamps input samples
+    LatencyHistogram m_inputLatency; ///Stores the time from input arriving to it being drawn
+    QTimer *m_autosaveTimer; ///Triggers the periodic autosave check
+    QFutureWatcher<QString> *m_autosaveWatcher; ///Tracks the autosave being written on the worker thread
+    std::shared_ptr<Journal::Base> m_autosaveBase; ///Stores the project the running autosave writes, filled in by the worker thread
+    Journal::Mark m_autosaveMark; ///Stores where the journal was when the running autosave took its snapshot
+    int m_autosaveSlot = 0; ///Stores which autosave file is written next
+    bool m_isSaving = false; ///Stores if a project is being written on the thread pool
+    QList<std::function<void()>> m_queuedSaves; ///Stores the saves asked for while another one was being written
+    Journal m_journal; ///Records every change to the frames for crash recovery
+    Frame m_strokeBefore; ///Stores the frame being drawn on as it was when the stroke began
     QColor m_currentColor; ///Stores the current color of the brush
-    QColor m_colorToReplace; ///Stores the color that will be replacing the current color
     QString m_currentTool; ///Stores the current tool as a string
     bool m_unsaved = false; ///Stores if the drawing is unsaved or saved
     bool m_isDrawing = false; ///Stores if the user is currently is drawing
     bool m_isModified() const {return m_unsaved;} ///Stores if the drawing has been modified since the last save
     int m_brushAndEraserSize; ///Stores the current brush or eraser size
-    int m_imageScale; ///Stores the current scale of the image
-    int m_zoomScale; ///Stores the current zoom scale of the image
     int m_frameRate; ///Stores the current framerate for the animation
     int m_currentFrameIndex; ///Stores the current index of the current frame of the animation
 
@@ -170,18 +412,44 @@ public slots:
     ///
     void on_setSpriteSizeClicked();
 
+    ///
+    /// \brief Offers to recover the changes the journal of the last session holds, and
+    /// starts a new journal if there are none or the user declines.
+    ///
+    void recoverFromJournal();
+
     ///
     /// \brief Cues the file to be saved in an .ssp format to whatever
-    /// file path the user chooses.
+    /// file path the user chooses. The file type picks binary or legacy JSON, and binary
+    /// projects ask which compression to use for the frames.
     ///
     void on_SaveClicked();
 
     ///
     /// \brief Cues the file to be loaded from an .ssp file into a modifiable
-    /// sprite vector that appears on the drawing canvas.
+    /// sprite vector that appears on the drawing canvas. Sprite sheet images and
+    /// animated GIF or PNG files are imported into a new sprite instead.
     ///
     void on_LoadClicked();
 
+    ///
+    /// \brief Asks where to export a texture atlas and writes the frames as trimmed, packed
+    /// PNG pages and JSON metadata on the thread pool.
+    ///
+    void on_ExportAtlasClicked();
+
+    ///
+    /// \brief Asks where to export an animated GIF or PNG and streams the frames into it
+    /// on the thread pool, timed at the preview's frame rate.
+    ///
+    void on_ExportAnimationClicked();
+
+    ///
+    /// \brief Sets the frame rate used when exporting animations.
+    /// \param framesPerSecond = Rate the preview plays at
+    ///
+    void setFrameRate(int framesPerSecond);
+
     ///
     /// \brief Starts the preview animation.
     ///
@@ -233,17 +501,17 @@ public slots:
     void setColor();
 
     ///
-    /// \brief Zooms the drawing canvas in.
+    /// \brief Zooms the drawing canvas in around its center.
     ///
     void zoomIn();
 
     ///
-    /// \brief Zooms the drawing canvas out.
+    /// \brief Zooms the drawing canvas out around its center.
     ///
     void zoomOut();
 
 signals:
-    void updatePreview(QVector<QImage> frames, int index); ///Sends a signal to update the preview
+    void updatePreview(FrameList frames, int index); ///Sends a signal to update the preview
     void changeColorButton(QString color); ///Sends a signal to update the color button
     void updateFrameNumber(int frameNum); ///Sends a signal to update the frame number
     void enableLastButton(); ///Sends a signal to enable the last frame button
@@ -0,0 +1,560 @@
+#include "frame.h"
+#include <QVector>
+#include <algorithm>
+#include <cstring>
+
+///
+/// \brief Constructs a null frame with no pixels.
+///
+Frame::Frame()
+    : d(new FrameData)
+{
+}
+
+///
+/// \brief Constructs a fully transparent frame.
+/// \param size = Size of the frame in pixels
+///
+Frame::Frame(const QSize &size)
+    : d(new FrameData)
+{
+    d->size = size;
+    d->tileColumns = (size.width() + TileSize - 1) / TileSize;
+    d->tileRows = (size.height() + TileSize - 1) / TileSize;
+}
+
+///
+/// \brief Builds a frame from an image. Tiles that are fully transparent are not allocated.
+/// \param image = Image to copy the pixels from
+///
+Frame Frame::fromImage(const QImage &image)
+{
+    QImage source = image.convertToFormat(QImage::Format_ARGB32);
+    Frame frame(source.size());
+    for (int row = 0; row < frame.tileRows(); row++) {
+        for (int column = 0; column < frame.tileColumns(); column++) {
+            QRect part = frame.tileRect(column, row);
+            bool isEmpty = true;
+            for (int y = part.top(); y <= part.bottom() && isEmpty; y++) {
+                const QRgb *line = reinterpret_cast<const QRgb *>(source.constScanLine(y)) + part.left();
+                isEmpty = std::all_of(line, line + part.width(), [](QRgb pixel) { return pixel == 0; });
+            }
+            if (isEmpty) {
+                continue;
+            }
+            QImage &tile = frame.writableTile(column, row);
+            for (int y = part.top(); y <= part.bottom(); y++) {
+                std::memcpy(tile.scanLine(y - part.top()), source.constScanLine(y) + part.left() * sizeof(QRgb),
+                            part.width() * sizeof(QRgb));
+            }
+        }
+    }
+    return frame;
+}
+
+///
+/// \brief Builds a frame on top of existing ARGB32 pixels without copying them. Every
+/// whole tile reads the pixels in place and keeps a reference to their owner until it
+/// is released or written to; partial tiles at the right and bottom edges are copied.
+/// \param pixels = First pixel of the top row, aligned to 4 bytes
+/// \param size = Size of the frame in pixels
+/// \param bytesPerLine = Distance between rows in bytes
+/// \param owner = Keeps the pixels alive while any tile uses them
+///
+Frame Frame::fromPixels(const uchar *pixels, const QSize &size, qsizetype bytesPerLine,
+                        const std::shared_ptr<const void> &owner)
+{
+    Frame frame(size);
+    for (int row = 0; row < frame.tileRows(); row++) {
+        for (int column = 0; column < frame.tileColumns(); column++) {
+            QRect part = frame.tileRect(column, row);
+            const uchar *first = pixels + part.top() * bytesPerLine + part.left() * sizeof(QRgb);
+            if (part.width() == TileSize && part.height() == TileSize) {
+                // A read only image detaches into its own copy the first time it is written to
+                auto *reference = new std::shared_ptr<const void>(owner);
+                frame.d->tiles.insert(row * frame.d->tileColumns + column,
+                                      QImage(first, TileSize, TileSize, bytesPerLine, QImage::Format_ARGB32,
+                                             [](void *info) { delete static_cast<std::shared_ptr<const void> *>(info); },
+                                             reference));
+                continue;
+            }
+            QImage &tile = frame.writableTile(column, row);
+            for (int y = 0; y < part.height(); y++) {
+                std::memcpy(tile.scanLine(y), first + y * bytesPerLine, part.width() * sizeof(QRgb));
+            }
+        }
+    }
+    return frame;
+}
+
+///
+/// \brief Returns the tile shared by every empty region of every frame.
+///
+const QImage &Frame::transparentTile()
+{
+    static const QImage tile = [] {
+        QImage image(TileSize, TileSize, QImage::Format_ARGB32);
+        image.fill(0);
+        return image;
+    }();
+    return tile;
+}
+
+QSize Frame::size() const
+{
+    return d->size;
+}
+
+int Frame::width() const
+{
+    return d->size.width();
+}
+
+int Frame::height() const
+{
+    return d->size.height();
+}
+
+QRect Frame::rect() const
+{
+    return QRect(QPoint(0, 0), d->size);
+}
+
+bool Frame::isNull() const
+{
+    return d->size.isEmpty();
+}
+
+int Frame::tileColumns() const
+{
+    return d->tileColumns;
+}
+
+int Frame::tileRows() const
+{
+    return d->tileRows;
+}
+
+int Frame::allocatedTileCount() const
+{
+    return d->tiles.size();
+}
+
+///
+/// \brief Returns the part of the frame covered by a tile.
+/// \param column = Tile column
+/// \param row = Tile row
+///
+QRect Frame::tileRect(int column, int row) const
+{
+    return QRect(column * TileSize, row * TileSize, TileSize, TileSize) & rect();
+}
+
+///
+/// \brief Returns if a tile has been allocated.
+/// \param column = Tile column
+/// \param row = Tile row
+///
+bool Frame::hasTile(int column, int row) const
+{
+    return d->tiles.contains(row * d->tileColumns + column);
+}
+
+///
+/// \brief Returns a tile's image, or the shared transparent tile if it was never written.
+/// \param column = Tile column
+/// \param row = Tile row
+///
+QImage Frame::tile(int column, int row) const
+{
+    return d->tiles.value(row * d->tileColumns + column, transparentTile());
+}
+
+///
+/// \brief Returns the packed ARGB value of a pixel.
+/// \param x = Pixel column, must be inside the frame
+/// \param y = Pixel row, must be inside the frame
+///
+QRgb Frame::pixel(int x, int y) const
+{
+    return *constLine(x, y);
+}
+
+///
+/// \brief Copies one whole row of the frame, one tile span at a time.
+/// \param y = Row to copy, must be inside the frame
+/// \param line = Destination with room for width() pixels
+///
+void Frame::copyLine(int y, QRgb *line) const
+{
+    copySpan(0, y, width(), line);
+}
+
+///
+/// \brief Writes one whole row of the frame. Tile spans that stay fully transparent
+/// are skipped, so no tile is allocated for them.
+/// \param y = Row to write, must be inside the frame
+/// \param line = Source with width() pixels
+///
+void Frame::setLine(int y, const QRgb *line)
+{
+    setSpan(0, y, width(), line);
+}
+
+///
+/// \brief Copies part of a row, one tile span at a time.
+/// \param x = First pixel to copy
+/// \param y = Row to copy from
+/// \param count = Number of pixels, which must stay inside the frame
+/// \param pixels = Destination with room for count pixels
+///
+void Frame::copySpan(int x, int y, int count, QRgb *pixels) const
+{
+    const int end = x + count;
+    while (x < end) {
+        int span = qMin(TileSize - x % TileSize, end - x);
+        std::memcpy(pixels, constLine(x, y), span * sizeof(QRgb));
+        pixels += span;
+        x += span;
+    }
+}
+
+///
+/// \brief Writes part of a row. Tile spans that stay fully transparent are skipped,
+/// so no tile is allocated for them, and tiles outside the span are not detached.
+/// \param x = First pixel to write
+/// \param y = Row to write to
+/// \param count = Number of pixels, which must stay inside the frame
+/// \param pixels = Source with count pixels
+///
+void Frame::setSpan(int x, int y, int count, const QRgb *pixels)
+{
+    const int end = x + count;
+    const int row = y / TileSize;
+    while (x < end) {
+        int span = qMin(TileSize - x % TileSize, end - x);
+        int column = x / TileSize;
+        if (hasTile(column, row) || !std::all_of(pixels, pixels + span, [](QRgb pixel) { return pixel == 0; })) {
+            QRgb *line = reinterpret_cast<QRgb *>(writableTile(column, row).scanLine(y % TileSize));
+            std::memcpy(line + x % TileSize, pixels, span * sizeof(QRgb));
+        }
+        pixels += span;
+        x += span;
+    }
+}
+
+///
+/// \brief Returns if this frame and another read a tile from the same storage, so its
+/// pixels are known to match without comparing them. Two unallocated tiles match.
+/// \param other = Frame of the same size to compare with
+/// \param column = Tile column
+/// \param row = Tile row
+///
+bool Frame::sharesTile(const Frame &other, int column, int row) const
+{
+    if (!hasTile(column, row) && !other.hasTile(column, row)) {
+        return true;
+    }
+    return tile(column, row).constBits() == other.tile(column, row).constBits();
+}
+
+///
+/// \brief Returns if this frame and another are copies of the same frame data. Writing
+/// to either copy detaches it, so a shared frame is known to be unchanged since the copy.
+/// \param other = Frame to compare with
+///
+bool Frame::isSharedWith(const Frame &other) const
+{
+    return d == other.d;
+}
+
+///
+/// \brief Fills the whole frame with one color. Filling with transparent releases every tile.
+/// \param pixel = Packed ARGB value
+///
+void Frame::fill(QRgb pixel)
+{
+    if (pixel == 0) {
+        d->tiles.clear();
+        return;
+    }
+    fillRect(rect(), pixel);
+}
+
+///
+/// \brief Fills a rectangle with one color, one tile span at a time.
+/// \param rect = Rectangle in frame coordinates
+/// \param pixel = Packed ARGB value
+/// \return The part of the rectangle that was inside the frame
+///
+QRect Frame::fillRect(const QRect &rect, QRgb pixel)
+{
+    QRect area = rect & this->rect();
+    if (area.isEmpty()) {
+        return QRect();
+    }
+    for (int row = area.top() / TileSize; row <= area.bottom() / TileSize; row++) {
+        for (int column = area.left() / TileSize; column <= area.right() / TileSize; column++) {
+            QRect tileArea(column * TileSize, row * TileSize, TileSize, TileSize);
+            QRect part = area & tileArea;
+            // Erasing a whole tile gives its memory back
+            if (pixel == 0 && part == tileRect(column, row)) {
+                d->tiles.remove(row * d->tileColumns + column);
+                continue;
+            }
+            if (pixel == 0 && !hasTile(column, row)) {
+                continue;
+            }
+            QImage &tile = writableTile(column, row);
+            for (int y = part.top(); y <= part.bottom(); y++) {
+                QRgb *line = reinterpret_cast<QRgb *>(tile.scanLine(y - tileArea.top())) + part.left() - tileArea.left();
+                std::fill_n(line, part.width(), pixel);
+            }
+        }
+    }
+    return area;
+}
+
+///
+/// \brief Replaces the 4-connected region of the seed's color with another color
+/// using an iterative scanline fill.
+/// \param seed = Starting pixel
+/// \param pixel = Packed ARGB value to fill with
+/// \return The bounding rectangle of the filled pixels
+///
+QRect Frame::floodFill(const QPoint &seed, QRgb pixel)
+{
+    if (!rect().contains(seed)) {
+        return QRect();
+    }
+    const QRgb colorToReplace = this->pixel(seed.x(), seed.y());
+    if (colorToReplace == pixel) {
+        return QRect();
+    }
+    QRect filledBounds;
+    QVector<QPoint> seeds;
+    seeds.append(seed);
+    while (!seeds.isEmpty()) {
+        QPoint current = seeds.takeLast();
+        if (this->pixel(current.x(), current.y()) != colorToReplace) {
+            continue;
+        }
+        // Grow the seed into the full span on this row and fill it
+        int left = spanStart(current.x(), current.y(), colorToReplace);
+        int right = spanEnd(current.x(), current.y(), colorToReplace);
+        filledBounds |= fillRect(QRect(left, current.y(), right - left + 1, 1), pixel);
+        // Push one seed for every run of the replaced color touching the span
+        for (int neighbourY : {current.y() - 1, current.y() + 1}) {
+            if (neighbourY < 0 || neighbourY >= height()) {
+                continue;
+            }
+            bool inRun = false;
+            int x = left;
+            while (x <= right) {
+                const QRgb *line = constLine(x, neighbourY);
+                int chunkEnd = qMin(x - x % TileSize + TileSize - 1, right);
+                for (int offset = 0; x <= chunkEnd; x++, offset++) {
+                    bool matches = line[offset] == colorToReplace;
+                    if (matches && !inRun) {
+                        seeds.append(QPoint(x, neighbourY));
+                    }
+                    inRun = matches;
+                }
+            }
+        }
+    }
+    return filledBounds;
+}
+
+///
+/// \brief Returns the smallest rectangle holding every pixel that is not fully
+/// transparent, or a null rectangle if there is none. Unallocated tiles are skipped.
+///
+QRect Frame::opaqueBounds() const
+{
+    QRect bounds;
+    for (auto tile = d->tiles.constBegin(); tile != d->tiles.constEnd(); ++tile) {
+        const int column = tile.key() % d->tileColumns;
+        const int row = tile.key() / d->tileColumns;
+        const QRect area = tileRect(column, row);
+        for (int y = area.top(); y <= area.bottom(); y++) {
+            const QRgb *line = reinterpret_cast<const QRgb *>(tile->constScanLine(y - row * TileSize));
+            int left = 0;
+            while (left < area.width() && qAlpha(line[left]) == 0) {
+                left++;
+            }
+            if (left == area.width()) {
+                continue;
+            }
+            int right = area.width() - 1;
+            while (qAlpha(line[right]) == 0) {
+                right--;
+            }
+            bounds |= QRect(area.left() + left, y, right - left + 1, 1);
+        }
+    }
+    return bounds;
+}
+
+///
+/// \brief Copies the whole frame into one ARGB32 image.
+///
+QImage Frame::toImage() const
+{
+    return toImage(rect());
+}
+
+///
+/// \brief Copies part of the frame into an ARGB32 image.
+/// \param area = Rectangle in frame coordinates, clipped to the frame
+///
+QImage Frame::toImage(const QRect &area) const
+{
+    QImage image;
+    copyTo(area, image);
+    return image;
+}
+
+///
+/// \brief Copies part of the frame into an ARGB32 image, reusing the image's memory
+/// when it already has the right size and format.
+/// \param area = Rectangle in frame coordinates, clipped to the frame
+/// \param image = Image resized to the clipped area and overwritten
+///
+void Frame::copyTo(const QRect &area, QImage &image) const
+{
+    QRect clipped = area & rect();
+    if (image.size() != clipped.size() || image.format() != QImage::Format_ARGB32) {
+        image = QImage(clipped.size(), QImage::Format_ARGB32);
+    }
+    image.fill(0);
+    if (clipped.isEmpty()) {
+        return;
+    }
+    for (int row = clipped.top() / TileSize; row <= clipped.bottom() / TileSize; row++) {
+        for (int column = clipped.left() / TileSize; column <= clipped.right() / TileSize; column++) {
+            auto tile = d->tiles.constFind(row * d->tileColumns + column);
+            if (tile == d->tiles.constEnd()) {
+                continue;
+            }
+            QRect part = clipped & tileRect(column, row);
+            for (int y = part.top(); y <= part.bottom(); y++) {
+                std::memcpy(image.scanLine(y - clipped.top()) + (part.left() - clipped.left()) * sizeof(QRgb),
+                            tile->constScanLine(y - row * TileSize) + (part.left() - column * TileSize) * sizeof(QRgb),
+                            part.width() * sizeof(QRgb));
+            }
+        }
+    }
+}
+
+///
+/// \brief Samples the frame into an image of the given size with nearest
+/// neighbour scaling, without building the full size image first.
+/// \param size = Size of the returned image
+///
+QImage Frame::scaled(const QSize &size) const
+{
+    QImage image(size, QImage::Format_ARGB32);
+    scaleInto(image);
+    return image;
+}
+
+///
+/// \brief Samples the frame into an existing ARGB32 image with nearest neighbour
+/// scaling. The frame is scaled to the image's size and nothing is allocated.
+/// \param image = Image to overwrite
+///
+void Frame::scaleInto(QImage &image) const
+{
+    const int targetWidth = image.width();
+    const int targetHeight = image.height();
+    if (isNull() || image.isNull()) {
+        image.fill(0);
+        return;
+    }
+    for (int y = 0; y < targetHeight; y++) {
+        int sourceY = int(qint64(y) * height() / targetHeight);
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        // Steps through the source columns floor(x * width / targetWidth) without a column table
+        int sourceX = 0;
+        int remainder = 0;
+        for (int x = 0; x < targetWidth; x++) {
+            line[x] = pixel(sourceX, sourceY);
+            remainder += width();
+            while (remainder >= targetWidth) {
+                remainder -= targetWidth;
+                sourceX++;
+            }
+        }
+    }
+}
+
+///
+/// \brief Returns the key of the tile holding a pixel.
+///
+int Frame::tileKey(int x, int y) const
+{
+    return (y / TileSize) * d->tileColumns + x / TileSize;
+}
+
+///
+/// \brief Returns a pointer to a pixel that stays valid up to the end of its tile row.
+///
+const QRgb *Frame::constLine(int x, int y) const
+{
+    auto tile = d->tiles.constFind(tileKey(x, y));
+    const QImage &image = tile == d->tiles.constEnd() ? transparentTile() : *tile;
+    return reinterpret_cast<const QRgb *>(image.constScanLine(y % TileSize)) + x % TileSize;
+}
+
+///
+/// \brief Returns a tile for writing, allocating it or detaching it from other frames first.
+///
+QImage &Frame::writableTile(int column, int row)
+{
+    QImage &tile = d->tiles[row * d->tileColumns + column];
+    if (tile.isNull()) {
+        tile = QImage(TileSize, TileSize, QImage::Format_ARGB32);
+        tile.fill(0);
+    }
+    return tile;
+}
+
+///
+/// \brief Returns the first pixel of the run of the given color that ends at x.
+///
+int Frame::spanStart(int x, int y, QRgb color) const
+{
+    for (;;) {
+        int tileStart = x - x % TileSize;
+        const QRgb *line = constLine(tileStart, y);
+        while (x > tileStart && line[x - 1 - tileStart] == color) {
+            x--;
+        }
+        if (x > tileStart || x == 0 || *constLine(x - 1, y) != color) {
+            return x;
+        }
+        x--;
+    }
+}
+
+///
+/// \brief Returns the last pixel of the run of the given color that starts at x.
+///
+int Frame::spanEnd(int x, int y, QRgb color) const
+{
+    const int lastColumn = width() - 1;
+    for (;;) {
+        int tileEnd = qMin(x - x % TileSize + TileSize - 1, lastColumn);
+        const QRgb *line = constLine(x, y);
+        int offset = 0;
+        while (x + offset < tileEnd && line[offset + 1] == color) {
+            offset++;
+        }
+        x += offset;
+        if (x < tileEnd || x == lastColumn || *constLine(x + 1, y) != color) {
+            return x;
+        }
+        x++;
+    }
+}
@@ -0,0 +1,251 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <QImage>
+#include <QHash>
+#include <QRect>
+#include <QSharedData>
+#include <QSharedDataPointer>
+#include <memory>
+
+///
+/// \brief Shared pixel storage behind a Frame. Only tiles that were written to are
+/// stored; every missing tile reads as fully transparent.
+///
+class FrameData : public QSharedData
+{
+public:
+    QSize size; ///Stores the size of the frame in pixels
+    int tileColumns = 0; ///Stores the number of tile columns covering the frame
+    int tileRows = 0; ///Stores the number of tile rows covering the frame
+    QHash<int, QImage> tiles; ///Stores the allocated tiles keyed by row * tileColumns + column
+};
+
+///
+/// \brief The Frame class stores one animation frame as a sparse grid of fixed size
+/// ARGB32 tiles. A tile is allocated the first time it is written to, and all empty
+/// regions share one transparent tile, so memory follows the painted area instead
+/// of the frame size. Frames are implicitly shared: copying one is O(1), and a
+/// write only copies the tiles it touches.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class Frame
+{
+public:
+    static constexpr int TileSize = 64; ///Width and height of a tile in pixels
+
+    ///
+    /// \brief Constructs a null frame with no pixels.
+    ///
+    Frame();
+
+    ///
+    /// \brief Constructs a fully transparent frame.
+    /// \param size = Size of the frame in pixels
+    ///
+    explicit Frame(const QSize &size);
+
+    ///
+    /// \brief Builds a frame from an image. Tiles that are fully transparent are not allocated.
+    /// \param image = Image to copy the pixels from
+    ///
+    static Frame fromImage(const QImage &image);
+
+    ///
+    /// \brief Builds a frame on top of existing ARGB32 pixels without copying them. Every
+    /// whole tile reads the pixels in place and keeps a reference to their owner until it
+    /// is released or written to; partial tiles at the right and bottom edges are copied.
+    /// \param pixels = First pixel of the top row, aligned to 4 bytes
+    /// \param size = Size of the frame in pixels
+    /// \param bytesPerLine = Distance between rows in bytes
+    /// \param owner = Keeps the pixels alive while any tile uses them
+    ///
+    static Frame fromPixels(const uchar *pixels, const QSize &size, qsizetype bytesPerLine,
+                            const std::shared_ptr<const void> &owner);
+
+    ///
+    /// \brief Returns the tile shared by every empty region of every frame.
+    ///
+    static const QImage &transparentTile();
+
+    QSize size() const; ///Returns the size of the frame
+    int width() const; ///Returns the width of the frame
+    int height() const; ///Returns the height of the frame
+    QRect rect() const; ///Returns the frame rectangle with its top left at the origin
+    bool isNull() const; ///Returns if the frame has no pixels
+    int tileColumns() const; ///Returns the number of tile columns covering the frame
+    int tileRows() const; ///Returns the number of tile rows covering the frame
+    int allocatedTileCount() const; ///Returns the number of tiles that hold pixels
+
+    ///
+    /// \brief Returns the part of the frame covered by a tile.
+    /// \param column = Tile column
+    /// \param row = Tile row
+    ///
+    QRect tileRect(int column, int row) const;
+
+    ///
+    /// \brief Returns if a tile has been allocated.
+    /// \param column = Tile column
+    /// \param row = Tile row
+    ///
+    bool hasTile(int column, int row) const;
+
+    ///
+    /// \brief Returns a tile's image, or the shared transparent tile if it was never written.
+    /// \param column = Tile column
+    /// \param row = Tile row
+    ///
+    QImage tile(int column, int row) const;
+
+    ///
+    /// \brief Returns the packed ARGB value of a pixel.
+    /// \param x = Pixel column, must be inside the frame
+    /// \param y = Pixel row, must be inside the frame
+    ///
+    QRgb pixel(int x, int y) const;
+
+    ///
+    /// \brief Copies one whole row of the frame, one tile span at a time.
+    /// \param y = Row to copy, must be inside the frame
+    /// \param line = Destination with room for width() pixels
+    ///
+    void copyLine(int y, QRgb *line) const;
+
+    ///
+    /// \brief Writes one whole row of the frame. Tile spans that stay fully transparent
+    /// are skipped, so no tile is allocated for them.
+    /// \param y = Row to write, must be inside the frame
+    /// \param line = Source with width() pixels
+    ///
+    void setLine(int y, const QRgb *line);
+
+    ///
+    /// \brief Copies part of a row, one tile span at a time.
+    /// \param x = First pixel to copy
+    /// \param y = Row to copy from
+    /// \param count = Number of pixels, which must stay inside the frame
+    /// \param pixels = Destination with room for count pixels
+    ///
+    void copySpan(int x, int y, int count, QRgb *pixels) const;
+
+    ///
+    /// \brief Writes part of a row. Tile spans that stay fully transparent are skipped,
+    /// so no tile is allocated for them, and tiles outside the span are not detached.
+    /// \param x = First pixel to write
+    /// \param y = Row to write to
+    /// \param count = Number of pixels, which must stay inside the frame
+    /// \param pixels = Source with count pixels
+    ///
+    void setSpan(int x, int y, int count, const QRgb *pixels);
+
+    ///
+    /// \brief Returns if this frame and another read a tile from the same storage, so its
+    /// pixels are known to match without comparing them. Two unallocated tiles match.
+    /// \param other = Frame of the same size to compare with
+    /// \param column = Tile column
+    /// \param row = Tile row
+    ///
+    bool sharesTile(const Frame &other, int column, int row) const;
+
+    ///
+    /// \brief Returns if this frame and another are copies of the same frame data. Writing
+    /// to either copy detaches it, so a shared frame is known to be unchanged since the copy.
+    /// \param other = Frame to compare with
+    ///
+    bool isSharedWith(const Frame &other) const;
+
+    ///
+    /// \brief Fills the whole frame with one color. Filling with transparent releases every tile.
+    /// \param pixel = Packed ARGB value
+    ///
+    void fill(QRgb pixel);
+
+    ///
+    /// \brief Fills a rectangle with one color, one tile span at a time.
+    /// \param rect = Rectangle in frame coordinates
+    /// \param pixel = Packed ARGB value
+    /// \return The part of the rectangle that was inside the frame
+    ///
+    QRect fillRect(const QRect &rect, QRgb pixel);
+
+    ///
+    /// \brief Replaces the 4-connected region of the seed's color with another color
+    /// using an iterative scanline fill.
+    /// \param seed = Starting pixel
+    /// \param pixel = Packed ARGB value to fill with
+    /// \return The bounding rectangle of the filled pixels
+    ///
+    QRect floodFill(const QPoint &seed, QRgb pixel);
+
+    ///
+    /// \brief Returns the smallest rectangle holding every pixel that is not fully
+    /// transparent, or a null rectangle if there is none. Unallocated tiles are skipped.
+    ///
+    QRect opaqueBounds() const;
+
+    ///
+    /// \brief Copies the whole frame into one ARGB32 image.
+    ///
+    QImage toImage() const;
+
+    ///
+    /// \brief Copies part of the frame into an ARGB32 image.
+    /// \param area = Rectangle in frame coordinates, clipped to the frame
+    ///
+    QImage toImage(const QRect &area) const;
+
+    ///
+    /// \brief Copies part of the frame into an ARGB32 image, reusing the image's memory
+    /// when it already has the right size and format.
+    /// \param area = Rectangle in frame coordinates, clipped to the frame
+    /// \param image = Image resized to the clipped area and overwritten
+    ///
+    void copyTo(const QRect &area, QImage &image) const;
+
+    ///
+    /// \brief Samples the frame into an image of the given size with nearest
+    /// neighbour scaling, without building the full size image first.
+    /// \param size = Size of the returned image
+    ///
+    QImage scaled(const QSize &size) const;
+
+    ///
+    /// \brief Samples the frame into an existing ARGB32 image with nearest neighbour
+    /// scaling. The frame is scaled to the image's size and nothing is allocated.
+    /// \param image = Image to overwrite
+    ///
+    void scaleInto(QImage &image) const;
+
+private:
+    ///
+    /// \brief Returns the key of the tile holding a pixel.
+    ///
+    int tileKey(int x, int y) const;
+
+    ///
+    /// \brief Returns a pointer to a pixel that stays valid up to the end of its tile row.
+    ///
+    const QRgb *constLine(int x, int y) const;
+
+    ///
+    /// \brief Returns a tile for writing, allocating it or detaching it from other frames first.
+    ///
+    QImage &writableTile(int column, int row);
+
+    ///
+    /// \brief Returns the first pixel of the run of the given color that ends at x.
+    ///
+    int spanStart(int x, int y, QRgb color) const;
+
+    ///
+    /// \brief Returns the last pixel of the run of the given color that starts at x.
+    ///
+    int spanEnd(int x, int y, QRgb color) const;
+
+    QSharedDataPointer<FrameData> d; ///Stores the shared tile data
+};
+
+#endif // FRAME_H
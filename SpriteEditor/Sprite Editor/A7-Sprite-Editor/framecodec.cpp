@@ -0,0 +1,726 @@
+#include "framecodec.h"
+#include <QVector>
+#include <QtConcurrent>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRAMECODEC_SSE2
+#endif
+
+///
+/// \brief Appends a number in LEB128 form, seven bits per byte with the high bit
+/// set on every byte but the last.
+///
+static void appendVarint(QByteArray &bytes, quint64 value)
+{
+    while (value >= 0x80) {
+        bytes.append(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    bytes.append(char(value));
+}
+
+///
+/// \brief Reads a LEB128 number, advancing the cursor. Returns false if the number
+/// runs past the end or is longer than 64 bits.
+///
+static bool readVarint(const uchar *&cursor, const uchar *end, quint64 &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (cursor == end) {
+            return false;
+        }
+        uchar byte = *cursor++;
+        value |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+///
+/// \brief Appends pixels as little endian words.
+///
+static void appendPixels(QByteArray &bytes, const QRgb *pixels, qsizetype count)
+{
+    qsizetype start = bytes.size();
+    bytes.resize(start + count * qsizetype(sizeof(QRgb)));
+    qToLittleEndian<quint32>(pixels, count, bytes.data() + start);
+}
+
+///
+/// \brief Packs a row of bytes with PackBits. A control byte from 0 to 127 is followed
+/// by that many plus one literal bytes; a control byte from -1 to -127 is followed by
+/// one byte repeated one minus that many times.
+///
+static void appendPackBits(QByteArray &bytes, const uchar *row, int count)
+{
+    int index = 0;
+    while (index < count) {
+        int runEnd = index + 1;
+        while (runEnd < count && runEnd - index < 128 && row[runEnd] == row[index]) {
+            runEnd++;
+        }
+        if (runEnd - index >= 2) {
+            bytes.append(char(1 - (runEnd - index)));
+            bytes.append(char(row[index]));
+            index = runEnd;
+            continue;
+        }
+        // A literal ends where the next repeat of two or more starts
+        int literalEnd = index + 1;
+        while (literalEnd < count && literalEnd - index < 128
+               && !(literalEnd + 1 < count && row[literalEnd] == row[literalEnd + 1])) {
+            literalEnd++;
+        }
+        bytes.append(char(literalEnd - index - 1));
+        bytes.append(reinterpret_cast<const char *>(row + index), literalEnd - index);
+        index = literalEnd;
+    }
+}
+
+///
+/// \brief Unpacks one PackBits row, advancing the cursor. Returns false if the row
+/// runs past the end of the payload or does not fill exactly count bytes.
+///
+static bool readPackBits(const uchar *&cursor, const uchar *end, uchar *row, int count)
+{
+    int index = 0;
+    while (index < count) {
+        if (cursor == end) {
+            return false;
+        }
+        int control = qint8(*cursor++);
+        if (control >= 0) {
+            int length = control + 1;
+            if (length > count - index || length > end - cursor) {
+                return false;
+            }
+            std::memcpy(row + index, cursor, length);
+            cursor += length;
+            index += length;
+        } else if (control != -128) {
+            int length = 1 - control;
+            if (length > count - index || cursor == end) {
+                return false;
+            }
+            std::memset(row + index, *cursor++, length);
+            index += length;
+        }
+    }
+    return true;
+}
+
+///
+/// \brief Expands one byte palette indices into pixels, four at a time.
+///
+static void expandIndices8(const uchar *indices, int count, const QRgb *colors, QRgb *line)
+{
+    int x = 0;
+    for (; x + 4 <= count; x += 4) {
+        line[x] = colors[indices[x]];
+        line[x + 1] = colors[indices[x + 1]];
+        line[x + 2] = colors[indices[x + 2]];
+        line[x + 3] = colors[indices[x + 3]];
+    }
+    for (; x < count; x++) {
+        line[x] = colors[indices[x]];
+    }
+}
+
+///
+/// \brief Expands packed four bit palette indices into pixels. Each packed byte is
+/// looked up in a table of pixel pairs and written with one 8 byte copy.
+///
+static void expandIndices4(const uchar *packed, int count, const QRgb *pairs, QRgb *line)
+{
+    int x = 0;
+    for (; x + 2 <= count; x += 2) {
+        std::memcpy(line + x, pairs + 2 * packed[x / 2], 2 * sizeof(QRgb));
+    }
+    if (x < count) {
+        line[x] = pairs[2 * packed[x / 2]];
+    }
+}
+
+///
+/// \brief XORs one line of pixels into another, sixteen bytes at a time where SSE2 is available.
+///
+static void xorPixels(QRgb *target, const QRgb *source, qsizetype count)
+{
+    qsizetype x = 0;
+#ifdef FRAMECODEC_SSE2
+    for (; x + 4 <= count; x += 4) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(target + x));
+        __m128i delta = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(target + x), _mm_xor_si128(pixels, delta));
+    }
+#endif
+    for (; x < count; x++) {
+        target[x] ^= source[x];
+    }
+}
+
+///
+/// \brief Adds the colors of one frame that a palette does not hold yet.
+/// \return If the palette still holds at most MaximumPaletteSize colors
+///
+static bool collectColors(const Frame &frame, FrameCodec::Palette &palette)
+{
+    QVector<QRgb> line(frame.width());
+    for (int y = 0; y < frame.height(); y++) {
+        frame.copyLine(y, line.data());
+        QRgb previous = line.isEmpty() ? 0 : ~line.first();
+        for (QRgb pixel : line) {
+            // Neighbouring pixels usually match, so most lookups are skipped
+            if (pixel == previous) {
+                continue;
+            }
+            previous = pixel;
+            if (!palette.indices.contains(pixel)) {
+                if (palette.colors.size() == FrameCodec::MaximumPaletteSize) {
+                    return false;
+                }
+                palette.indices.insert(pixel, palette.colors.size());
+                palette.colors.append(pixel);
+            }
+        }
+    }
+    return true;
+}
+
+///
+/// \brief Collects the colors used by a set of frames. Each frame's colors are collected
+/// in parallel and then merged in frame order, so the palette does not depend on timing.
+/// \param frames = Frames to scan
+/// \param palette = Receives the colors when they fit
+/// \return If the frames use at most MaximumPaletteSize colors
+///
+bool FrameCodec::buildPalette(const FrameList &frames, Palette &palette)
+{
+    palette = Palette();
+    QVector<int> indices(frames.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    const QVector<Palette> framePalettes = QtConcurrent::blockingMapped<QVector<Palette>>(indices, [&frames](int frameIndex) {
+        Palette framePalette;
+        if (!collectColors(frames.at(frameIndex), framePalette)) {
+            // One more color than fits marks the frame as too colorful
+            framePalette.colors.append(0);
+        }
+        return framePalette;
+    });
+    for (const Palette &framePalette : framePalettes) {
+        if (framePalette.colors.size() > MaximumPaletteSize) {
+            palette = Palette();
+            return false;
+        }
+        for (QRgb color : framePalette.colors) {
+            if (palette.indices.contains(color)) {
+                continue;
+            }
+            if (palette.colors.size() == MaximumPaletteSize) {
+                palette = Palette();
+                return false;
+            }
+            palette.indices.insert(color, palette.colors.size());
+            palette.colors.append(color);
+        }
+    }
+    return true;
+}
+
+///
+/// \brief Returns if an encoding stores palette indices.
+///
+bool FrameCodec::isPaletteEncoding(Encoding encoding)
+{
+    return encoding == Encoding::Palette8 || encoding == Encoding::Palette4;
+}
+
+///
+/// \brief Returns if a stored encoding number is one this class can decode.
+/// \param encoding = Encoding number from a frame index
+///
+bool FrameCodec::isKnownEncoding(quint32 encoding)
+{
+    return encoding <= quint32(Encoding::Delta);
+}
+
+///
+/// \brief Encodes a frame.
+/// \param frame = Frame to encode
+/// \param encoding = Payload layout to produce
+/// \param palette = Colors of the project, needed by the palette encodings
+/// \param previous = Frame before this one, needed by the delta encoding
+///
+QByteArray FrameCodec::encode(const Frame &frame, Encoding encoding, const Palette &palette, const Frame &previous)
+{
+    switch (encoding) {
+    case Encoding::Delta:
+        return encodeDelta(frame, previous);
+    case Encoding::Palette8:
+        return encodePalette(frame, false, palette);
+    case Encoding::Palette4:
+        return encodePalette(frame, true, palette);
+    case Encoding::Zlib:
+        return qCompress(rawRows(frame));
+    case Encoding::RunLength:
+        return encodeRunLength(frame);
+    case Encoding::Raw:
+        break;
+    }
+    return rawRows(frame);
+}
+
+///
+/// \brief Decodes a payload into a new frame.
+/// \param payload = First byte of the payload
+/// \param size = Payload size in bytes
+/// \param frameSize = Size of the frame the payload holds
+/// \param encoding = Layout of the payload
+/// \param palette = Colors of the project, needed by the palette encodings
+/// \param previous = Decoded frame before this one, needed by the delta encoding
+/// \param ok = Set to whether the payload was valid
+/// \return The frame, or a null frame if the payload was invalid
+///
+Frame FrameCodec::decode(const uchar *payload, qsizetype size, const QSize &frameSize, Encoding encoding,
+                         const QVector<QRgb> &palette, const Frame &previous, bool *ok)
+{
+    const qsizetype rawSize = qsizetype(frameSize.width()) * frameSize.height() * qsizetype(sizeof(QRgb));
+    *ok = false;
+    switch (encoding) {
+    case Encoding::Raw:
+        if (size != rawSize) {
+            return Frame();
+        }
+        *ok = true;
+        return fromRawRows(payload, frameSize);
+    case Encoding::Zlib: {
+        QByteArray rows = qUncompress(payload, size);
+        if (rows.size() != rawSize) {
+            return Frame();
+        }
+        *ok = true;
+        return fromRawRows(reinterpret_cast<const uchar *>(rows.constData()), frameSize);
+    }
+    case Encoding::RunLength:
+        return decodeRunLength(payload, size, frameSize, ok);
+    case Encoding::Palette8:
+        return decodePalette(payload, size, frameSize, false, palette, ok);
+    case Encoding::Palette4:
+        return decodePalette(payload, size, frameSize, true, palette, ok);
+    case Encoding::Delta:
+        if (previous.size() != frameSize) {
+            return Frame();
+        }
+        return decodeDelta(payload, size, previous, ok);
+    }
+    return Frame();
+}
+
+///
+/// \brief Returns the frame's rows as little endian ARGB32 words, back to back.
+///
+QByteArray FrameCodec::rawRows(const Frame &frame)
+{
+    QByteArray rows;
+    rows.reserve(qsizetype(frame.width()) * frame.height() * qsizetype(sizeof(QRgb)));
+    QVector<QRgb> line(frame.width());
+    for (int y = 0; y < frame.height(); y++) {
+        frame.copyLine(y, line.data());
+        appendPixels(rows, line.constData(), line.size());
+    }
+    return rows;
+}
+
+///
+/// \brief Builds a frame from little endian ARGB32 rows stored back to back.
+///
+Frame FrameCodec::fromRawRows(const uchar *rows, const QSize &frameSize)
+{
+    Frame frame(frameSize);
+    QVector<QRgb> line(frameSize.width());
+    const qsizetype lineBytes = qsizetype(line.size()) * qsizetype(sizeof(QRgb));
+    for (int y = 0; y < frameSize.height(); y++) {
+        qFromLittleEndian<quint32>(rows + y * lineBytes, line.size(), line.data());
+        frame.setLine(y, line.constData());
+    }
+    return frame;
+}
+
+///
+/// \brief Encodes a frame as runs. Each run starts with a LEB128 number holding its
+/// length shifted left once, with the low bit set for a repeated pixel. A repeated
+/// run is followed by one pixel, a literal run by all of its pixels.
+///
+QByteArray FrameCodec::encodeRunLength(const Frame &frame)
+{
+    // Runs carry on across rows, so one row is held at a time however large the frame is
+    QByteArray runs;
+    RunWriter writer(runs);
+    QVector<QRgb> line(frame.width());
+    for (int y = 0; y < frame.height(); y++) {
+        frame.copyLine(y, line.data());
+        writer.append(line.constData(), line.size());
+    }
+    writer.finish();
+    return runs;
+}
+
+///
+/// \brief Creates a writer appending to the given bytes.
+///
+FrameCodec::RunWriter::RunWriter(QByteArray &runs)
+    : m_runs(runs)
+{
+}
+
+///
+/// \brief Adds the next pixels of the area.
+///
+void FrameCodec::RunWriter::append(const QRgb *pixels, qsizetype count)
+{
+    qsizetype index = 0;
+    while (index < count) {
+        if (m_runLength > 0 && pixels[index] != m_runPixel) {
+            endRun();
+        }
+        if (m_runLength == 0) {
+            m_runPixel = pixels[index];
+        }
+        qsizetype runEnd = index;
+        while (runEnd < count && pixels[runEnd] == m_runPixel) {
+            runEnd++;
+        }
+        m_runLength += runEnd - index;
+        index = runEnd;
+    }
+}
+
+///
+/// \brief Writes the runs still held. Called once after the last pixels.
+///
+void FrameCodec::RunWriter::finish()
+{
+    if (m_runLength > 0) {
+        endRun();
+    }
+    flushLiteral();
+}
+
+///
+/// \brief Ends the run of equal pixels being counted, writing it on its own or
+/// adding it to the literal.
+///
+void FrameCodec::RunWriter::endRun()
+{
+    // Runs shorter than three pixels are cheaper to store as part of a literal
+    if (m_runLength >= 3) {
+        flushLiteral();
+        appendVarint(m_runs, (quint64(m_runLength) << 1) | 1);
+        appendPixels(m_runs, &m_runPixel, 1);
+    } else {
+        m_literal.insert(m_literal.size(), m_runLength, m_runPixel);
+        if (m_literal.size() >= MaximumLiteral) {
+            flushLiteral();
+        }
+    }
+    m_runLength = 0;
+}
+
+///
+/// \brief Writes the literal being built, if there is one.
+///
+void FrameCodec::RunWriter::flushLiteral()
+{
+    if (!m_literal.isEmpty()) {
+        appendVarint(m_runs, quint64(m_literal.size()) << 1);
+        appendPixels(m_runs, m_literal.constData(), m_literal.size());
+        m_literal.clear();
+    }
+}
+
+///
+/// \brief Decodes runs written by encodeRunLength.
+///
+Frame FrameCodec::decodeRunLength(const uchar *payload, qsizetype size, const QSize &frameSize, bool *ok)
+{
+    *ok = false;
+    Frame frame(frameSize);
+    QVector<QRgb> line(frameSize.width());
+    const uchar *cursor = payload;
+    const uchar *const end = payload + size;
+    quint64 remaining = quint64(frameSize.width()) * frameSize.height();
+    int x = 0;
+    int y = 0;
+    while (remaining > 0) {
+        quint64 header;
+        if (!readVarint(cursor, end, header)) {
+            return Frame();
+        }
+        quint64 length = header >> 1;
+        const bool isRepeat = header & 1;
+        const quint64 pixelBytes = (isRepeat ? 1 : length) * sizeof(QRgb);
+        if (length == 0 || length > remaining || pixelBytes > quint64(end - cursor)) {
+            return Frame();
+        }
+        remaining -= length;
+        const QRgb repeated = isRepeat ? qFromLittleEndian<quint32>(cursor) : 0;
+        while (length > 0) {
+            int span = int(qMin<quint64>(length, quint64(frameSize.width() - x)));
+            if (isRepeat) {
+                std::fill(line.begin() + x, line.begin() + x + span, repeated);
+            } else {
+                qFromLittleEndian<quint32>(cursor, span, line.data() + x);
+                cursor += span * sizeof(QRgb);
+            }
+            x += span;
+            length -= span;
+            if (x == frameSize.width()) {
+                frame.setLine(y++, line.constData());
+                x = 0;
+            }
+        }
+        if (isRepeat) {
+            cursor += sizeof(QRgb);
+        }
+    }
+    *ok = cursor == end;
+    return *ok ? frame : Frame();
+}
+
+///
+/// \brief Encodes a frame as palette indices, one PackBits packed row after another.
+///
+QByteArray FrameCodec::encodePalette(const Frame &frame, bool isPacked, const Palette &palette)
+{
+    QByteArray rows;
+    QVector<QRgb> line(frame.width());
+    QVector<uchar> indices(frame.width());
+    const int rowBytes = isPacked ? (frame.width() + 1) / 2 : frame.width();
+    for (int y = 0; y < frame.height(); y++) {
+        frame.copyLine(y, line.data());
+        if (isPacked) {
+            std::fill(indices.begin(), indices.end(), 0);
+            for (int x = 0; x < line.size(); x++) {
+                indices[x / 2] |= uchar(palette.indices.value(line[x]) << (x % 2 ? 0 : 4));
+            }
+        } else {
+            for (int x = 0; x < line.size(); x++) {
+                indices[x] = uchar(palette.indices.value(line[x]));
+            }
+        }
+        appendPackBits(rows, indices.constData(), rowBytes);
+    }
+    return rows;
+}
+
+///
+/// \brief Decodes rows written by encodePalette, expanding the indices through the palette.
+///
+Frame FrameCodec::decodePalette(const uchar *payload, qsizetype size, const QSize &frameSize, bool isPacked,
+                                const QVector<QRgb> &palette, bool *ok)
+{
+    *ok = false;
+    if (palette.isEmpty() || (isPacked && palette.size() > 16)) {
+        return Frame();
+    }
+    // Indices past the end of the palette read as transparent
+    QVector<QRgb> colors = palette;
+    colors.resize(MaximumPaletteSize);
+    QVector<QRgb> pairs;
+    if (isPacked) {
+        pairs.resize(2 * 256);
+        for (int byte = 0; byte < 256; byte++) {
+            pairs[2 * byte] = colors[byte >> 4];
+            pairs[2 * byte + 1] = colors[byte & 15];
+        }
+    }
+    Frame frame(frameSize);
+    const int rowBytes = isPacked ? (frameSize.width() + 1) / 2 : frameSize.width();
+    QVector<uchar> indices(rowBytes);
+    QVector<QRgb> line(frameSize.width());
+    const uchar *cursor = payload;
+    const uchar *const end = payload + size;
+    for (int y = 0; y < frameSize.height(); y++) {
+        if (!readPackBits(cursor, end, indices.data(), rowBytes)) {
+            return Frame();
+        }
+        if (isPacked) {
+            expandIndices4(indices.constData(), line.size(), pairs.constData(), line.data());
+        } else {
+            expandIndices8(indices.constData(), line.size(), colors.constData(), line.data());
+        }
+        frame.setLine(y, line.constData());
+    }
+    *ok = cursor == end;
+    return *ok ? frame : Frame();
+}
+
+///
+/// \brief Creates a reader for the runs of an area.
+/// \param cursor = First byte of the runs
+/// \param end = End of the payload
+/// \param pixelCount = Number of pixels in the area
+///
+FrameCodec::RunReader::RunReader(const uchar *cursor, const uchar *end, quint64 pixelCount)
+    : m_cursor(cursor), m_end(end), m_unread(pixelCount)
+{
+}
+
+///
+/// \brief Decodes the next pixels of the area.
+/// \return If they were decoded without a run reaching past the area or the payload
+///
+bool FrameCodec::RunReader::read(QRgb *pixels, qsizetype count)
+{
+    while (count > 0) {
+        if (m_runLeft == 0) {
+            quint64 header;
+            if (!readVarint(m_cursor, m_end, header)) {
+                return false;
+            }
+            const quint64 length = header >> 1;
+            m_isRepeat = header & 1;
+            const quint64 pixelBytes = (m_isRepeat ? 1 : length) * sizeof(QRgb);
+            if (length == 0 || length > m_unread || pixelBytes > quint64(m_end - m_cursor)) {
+                return false;
+            }
+            if (m_isRepeat) {
+                m_repeated = qFromLittleEndian<quint32>(m_cursor);
+                m_cursor += sizeof(QRgb);
+            }
+            m_unread -= length;
+            m_runLeft = length;
+        }
+        const qsizetype span = qsizetype(qMin<quint64>(m_runLeft, quint64(count)));
+        if (m_isRepeat) {
+            std::fill(pixels, pixels + span, m_repeated);
+        } else {
+            qFromLittleEndian<quint32>(m_cursor, span, pixels);
+            m_cursor += span * qsizetype(sizeof(QRgb));
+        }
+        pixels += span;
+        count -= span;
+        m_runLeft -= quint64(span);
+    }
+    return true;
+}
+
+///
+/// \brief Returns if the last run was read completely and ended the payload.
+///
+bool FrameCodec::RunReader::isAtEnd() const
+{
+    return m_runLeft == 0 && m_cursor == m_end;
+}
+
+///
+/// \brief Returns the smallest rectangle holding every pixel that differs between two
+/// frames of the same size. Tiles the frames share are skipped without reading them.
+///
+QRect FrameCodec::changedRect(const Frame &frame, const Frame &previous)
+{
+    QRect changed;
+    QVector<QRgb> line(Frame::TileSize);
+    QVector<QRgb> previousLine(Frame::TileSize);
+    for (int row = 0; row < frame.tileRows(); row++) {
+        for (int column = 0; column < frame.tileColumns(); column++) {
+            if (frame.sharesTile(previous, column, row)) {
+                continue;
+            }
+            QRect part = frame.tileRect(column, row);
+            int left = part.right() + 1;
+            int right = part.left() - 1;
+            int top = part.bottom() + 1;
+            int bottom = part.top() - 1;
+            for (int y = part.top(); y <= part.bottom(); y++) {
+                frame.copySpan(part.left(), y, part.width(), line.data());
+                previous.copySpan(part.left(), y, part.width(), previousLine.data());
+                for (int x = 0; x < part.width(); x++) {
+                    if (line[x] != previousLine[x]) {
+                        left = qMin(left, part.left() + x);
+                        right = qMax(right, part.left() + x);
+                        top = qMin(top, y);
+                        bottom = y;
+                    }
+                }
+            }
+            if (left <= right) {
+                changed |= QRect(QPoint(left, top), QPoint(right, bottom));
+            }
+        }
+    }
+    return changed;
+}
+
+///
+/// \brief Encodes the changed rectangle as four 32 bit numbers (x, y, width, height)
+/// followed by the runs of its pixels XORed with the previous frame's.
+///
+QByteArray FrameCodec::encodeDelta(const Frame &frame, const Frame &previous)
+{
+    const QRect changed = changedRect(frame, previous);
+    QByteArray delta(4 * sizeof(quint32), '\0');
+    uchar *bytes = reinterpret_cast<uchar *>(delta.data());
+    qToLittleEndian<quint32>(changed.x(), bytes);
+    qToLittleEndian<quint32>(changed.y(), bytes + 4);
+    qToLittleEndian<quint32>(changed.width(), bytes + 8);
+    qToLittleEndian<quint32>(changed.height(), bytes + 12);
+    if (changed.isEmpty()) {
+        return delta;
+    }
+    // Unchanged pixels XOR to zero, which the runs store almost for free
+    RunWriter writer(delta);
+    QVector<QRgb> line(changed.width());
+    QVector<QRgb> previousLine(changed.width());
+    for (int y = 0; y < changed.height(); y++) {
+        frame.copySpan(changed.x(), changed.y() + y, changed.width(), line.data());
+        previous.copySpan(changed.x(), changed.y() + y, changed.width(), previousLine.data());
+        xorPixels(line.data(), previousLine.constData(), changed.width());
+        writer.append(line.constData(), line.size());
+    }
+    writer.finish();
+    return delta;
+}
+
+///
+/// \brief Rebuilds a frame from the previous frame and a payload written by encodeDelta.
+/// Only the tiles under the changed rectangle are detached from the previous frame.
+///
+Frame FrameCodec::decodeDelta(const uchar *payload, qsizetype size, const Frame &previous, bool *ok)
+{
+    *ok = false;
+    if (size < qsizetype(4 * sizeof(quint32))) {
+        return Frame();
+    }
+    const quint32 x = qFromLittleEndian<quint32>(payload);
+    const quint32 y = qFromLittleEndian<quint32>(payload + 4);
+    const quint32 width = qFromLittleEndian<quint32>(payload + 8);
+    const quint32 height = qFromLittleEndian<quint32>(payload + 12);
+    if (x > quint32(previous.width()) || width > quint32(previous.width()) - x
+        || y > quint32(previous.height()) || height > quint32(previous.height()) - y) {
+        return Frame();
+    }
+    const QRect changed(int(x), int(y), int(width), int(height));
+    Frame frame = previous;
+    // The runs carry on across rows, so one row of the changed rectangle is held at a time
+    RunReader reader(payload + 4 * sizeof(quint32), payload + size, quint64(changed.width()) * changed.height());
+    QVector<QRgb> line(changed.width());
+    QVector<QRgb> previousLine(changed.width());
+    for (int row = 0; row < changed.height(); row++) {
+        if (!reader.read(line.data(), line.size())) {
+            return Frame();
+        }
+        previous.copySpan(changed.x(), changed.y() + row, changed.width(), previousLine.data());
+        xorPixels(line.data(), previousLine.constData(), changed.width());
+        frame.setSpan(changed.x(), changed.y() + row, changed.width(), line.constData());
+    }
+    *ok = reader.isAtEnd();
+    return *ok ? frame : Frame();
+}
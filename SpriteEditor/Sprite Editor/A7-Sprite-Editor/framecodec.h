@@ -0,0 +1,222 @@
+#ifndef FRAMECODEC_H
+#define FRAMECODEC_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QSize>
+#include <QVector>
+#include "frame.h"
+#include "framelist.h"
+
+///
+/// \brief The FrameCodec class turns one frame into the payload stored in a binary
+/// project and back. Every payload but a delta can be decoded on its own, so a
+/// project's frames can be decoded in parallel; a delta also needs the frame before
+/// it. All pixels are stored as little endian ARGB32 words.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class FrameCodec
+{
+public:
+    ///
+    /// \brief The ways a frame payload can be stored.
+    ///
+    enum class Encoding : quint32 {
+        Raw = 0, ///Uncompressed rows
+        Zlib = 1, ///Uncompressed rows packed with qCompress
+        RunLength = 2, ///Runs of equal pixels over the whole frame, read row after row
+        Palette8 = 3, ///One byte palette index per pixel, each row packed with PackBits
+        Palette4 = 4, ///Two palette indices per byte, high nibble first, each row packed with PackBits
+        Delta = 5 ///The rectangle that changed since the previous frame, as run-length coded XOR pixels
+    };
+
+    static constexpr int MaximumPaletteSize = 256; ///Largest number of colors a palette can hold
+
+    ///
+    /// \brief The colors shared by every palette encoded frame of a project.
+    ///
+    struct Palette {
+        QVector<QRgb> colors; ///Stores the colors in index order
+        QHash<QRgb, int> indices; ///Maps every color to its index
+    };
+
+    ///
+    /// \brief Collects the colors used by a set of frames. Each frame's colors are collected
+    /// in parallel and then merged in frame order, so the palette does not depend on timing.
+    /// \param frames = Frames to scan
+    /// \param palette = Receives the colors when they fit
+    /// \return If the frames use at most MaximumPaletteSize colors
+    ///
+    static bool buildPalette(const FrameList &frames, Palette &palette);
+
+    ///
+    /// \brief Returns if an encoding stores palette indices.
+    ///
+    static bool isPaletteEncoding(Encoding encoding);
+
+    ///
+    /// \brief Returns if a stored encoding number is one this class can decode.
+    /// \param encoding = Encoding number from a frame index
+    ///
+    static bool isKnownEncoding(quint32 encoding);
+
+    ///
+    /// \brief Encodes a frame.
+    /// \param frame = Frame to encode
+    /// \param encoding = Payload layout to produce
+    /// \param palette = Colors of the project, needed by the palette encodings
+    /// \param previous = Frame before this one, needed by the delta encoding
+    ///
+    static QByteArray encode(const Frame &frame, Encoding encoding, const Palette &palette = Palette(),
+                             const Frame &previous = Frame());
+
+    ///
+    /// \brief Decodes a payload into a new frame.
+    /// \param payload = First byte of the payload
+    /// \param size = Payload size in bytes
+    /// \param frameSize = Size of the frame the payload holds
+    /// \param encoding = Layout of the payload
+    /// \param palette = Colors of the project, needed by the palette encodings
+    /// \param previous = Decoded frame before this one, needed by the delta encoding
+    /// \param ok = Set to whether the payload was valid
+    /// \return The frame, or a null frame if the payload was invalid
+    ///
+    static Frame decode(const uchar *payload, qsizetype size, const QSize &frameSize, Encoding encoding,
+                        const QVector<QRgb> &palette, const Frame &previous, bool *ok);
+
+private:
+    ///
+    /// \brief Returns the frame's rows as little endian ARGB32 words, back to back.
+    ///
+    static QByteArray rawRows(const Frame &frame);
+
+    ///
+    /// \brief Builds a frame from little endian ARGB32 rows stored back to back.
+    ///
+    static Frame fromRawRows(const uchar *rows, const QSize &frameSize);
+
+    ///
+    /// \brief Encodes a frame as runs. Each run starts with a LEB128 number holding its
+    /// length shifted left once, with the low bit set for a repeated pixel. A repeated
+    /// run is followed by one pixel, a literal run by all of its pixels.
+    ///
+    static QByteArray encodeRunLength(const Frame &frame);
+
+    ///
+    /// \brief Writes runs for pixels handed over a row at a time. A run carries on from
+    /// one row into the next, so the runs are the same as for the whole area laid out as
+    /// one line, but only the pixels of the literal being built are held. Literals are
+    /// written out once they reach MaximumLiteral pixels.
+    ///
+    class RunWriter
+    {
+    public:
+        static constexpr qsizetype MaximumLiteral = 4096; ///Most pixels held before a literal is written
+
+        ///
+        /// \brief Creates a writer appending to the given bytes.
+        ///
+        explicit RunWriter(QByteArray &runs);
+
+        ///
+        /// \brief Adds the next pixels of the area.
+        ///
+        void append(const QRgb *pixels, qsizetype count);
+
+        ///
+        /// \brief Writes the runs still held. Called once after the last pixels.
+        ///
+        void finish();
+
+    private:
+        ///
+        /// \brief Ends the run of equal pixels being counted, writing it on its own or
+        /// adding it to the literal.
+        ///
+        void endRun();
+
+        ///
+        /// \brief Writes the literal being built, if there is one.
+        ///
+        void flushLiteral();
+
+        QByteArray &m_runs; ///Stores the bytes the runs are appended to
+        QVector<QRgb> m_literal; ///Stores the pixels of the literal being built
+        QRgb m_runPixel = 0; ///Stores the pixel of the run being counted
+        qsizetype m_runLength = 0; ///Stores the length of the run being counted
+    };
+
+    ///
+    /// \brief Decodes runs written by encodeRunLength.
+    ///
+    static Frame decodeRunLength(const uchar *payload, qsizetype size, const QSize &frameSize, bool *ok);
+
+    ///
+    /// \brief Reads runs written by a RunWriter a row at a time. A run that carries on
+    /// into the next row is picked up where the last read stopped, so only the row being
+    /// decoded is held.
+    ///
+    class RunReader
+    {
+    public:
+        ///
+        /// \brief Creates a reader for the runs of an area.
+        /// \param cursor = First byte of the runs
+        /// \param end = End of the payload
+        /// \param pixelCount = Number of pixels in the area
+        ///
+        RunReader(const uchar *cursor, const uchar *end, quint64 pixelCount);
+
+        ///
+        /// \brief Decodes the next pixels of the area.
+        /// \return If they were decoded without a run reaching past the area or the payload
+        ///
+        bool read(QRgb *pixels, qsizetype count);
+
+        ///
+        /// \brief Returns if the last run was read completely and ended the payload.
+        ///
+        bool isAtEnd() const;
+
+    private:
+        const uchar *m_cursor; ///Stores the next byte to read
+        const uchar *m_end; ///Stores the end of the payload
+        quint64 m_unread; ///Stores the pixels of the area not covered by a run read so far
+        quint64 m_runLeft = 0; ///Stores the pixels of the current run not decoded yet
+        bool m_isRepeat = false; ///Stores if the current run repeats one pixel
+        QRgb m_repeated = 0; ///Stores the pixel the current run repeats
+    };
+
+    ///
+    /// \brief Returns the smallest rectangle holding every pixel that differs between two
+    /// frames of the same size. Tiles the frames share are skipped without reading them.
+    ///
+    static QRect changedRect(const Frame &frame, const Frame &previous);
+
+    ///
+    /// \brief Encodes the changed rectangle as four 32 bit numbers (x, y, width, height)
+    /// followed by the runs of its pixels XORed with the previous frame's.
+    ///
+    static QByteArray encodeDelta(const Frame &frame, const Frame &previous);
+
+    ///
+    /// \brief Rebuilds a frame from the previous frame and a payload written by encodeDelta.
+    /// Only the tiles under the changed rectangle are detached from the previous frame.
+    ///
+    static Frame decodeDelta(const uchar *payload, qsizetype size, const Frame &previous, bool *ok);
+
+    ///
+    /// \brief Encodes a frame as palette indices, one PackBits packed row after another.
+    ///
+    static QByteArray encodePalette(const Frame &frame, bool isPacked, const Palette &palette);
+
+    ///
+    /// \brief Decodes rows written by encodePalette, expanding the indices through the palette.
+    ///
+    static Frame decodePalette(const uchar *payload, qsizetype size, const QSize &frameSize, bool isPacked,
+                               const QVector<QRgb> &palette, bool *ok);
+};
+
+#endif // FRAMECODEC_H
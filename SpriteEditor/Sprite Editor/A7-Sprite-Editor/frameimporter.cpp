@@ -0,0 +1,526 @@
+#include "frameimporter.h"
+#include "apngencoder.h"
+#include <QCollator>
+#include <QDir>
+#include <QFile>
+#include <QImageReader>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+///
+/// \brief Reads a 32 bit big endian number.
+///
+static quint32 readLong(const char *bytes)
+{
+    return (quint32(quint8(bytes[0])) << 24) | (quint32(quint8(bytes[1])) << 16)
+           | (quint32(quint8(bytes[2])) << 8) | quint32(quint8(bytes[3]));
+}
+
+///
+/// \brief Returns the first index and length of every run of used entries.
+///
+static QVector<std::pair<int, int>> usedSpans(const QVector<char> &used)
+{
+    QVector<std::pair<int, int>> spans;
+    int index = 0;
+    while (index < used.size()) {
+        if (!used.at(index)) {
+            index++;
+            continue;
+        }
+        const int start = index;
+        while (index < used.size() && used.at(index)) {
+            index++;
+        }
+        spans.append({start, index - start});
+    }
+    return spans;
+}
+
+///
+/// \brief Creates an importer reading the given image file or folder.
+/// \param fileName = Path of the sheet, animation or image sequence folder
+///
+FrameImporter::FrameImporter(const QString &fileName)
+    : m_fileName(fileName)
+{
+}
+
+///
+/// \brief Reads a sprite sheet and slices it into frames, left to right and top to
+/// bottom. Empty cells after the last drawn cell are dropped; with gutter detection
+/// every empty cell is.
+/// \param cellSize = Size of one grid cell, or an empty size to slice along the rows
+/// and columns that are fully transparent
+/// \return If the sheet was read; errorString() describes the failure otherwise
+///
+bool FrameImporter::readSheet(const QSize &cellSize)
+{
+    QImageReader reader(m_fileName);
+    const QImage image = reader.read();
+    if (image.isNull()) {
+        return fail(reader.errorString());
+    }
+    const QImage sheet = toArgb32(image);
+    QVector<QRect> cells;
+    if (cellSize.isEmpty()) {
+        cells = findCells(sheet);
+        if (cells.isEmpty()) {
+            return fail("The sheet has no drawn pixels to slice.");
+        }
+        m_spriteSize = QSize(0, 0);
+        for (const QRect &cell : cells) {
+            m_spriteSize = m_spriteSize.expandedTo(cell.size());
+        }
+    } else {
+        const int columns = sheet.width() / cellSize.width();
+        const int rows = sheet.height() / cellSize.height();
+        if (columns == 0 || rows == 0) {
+            return fail("The sheet is smaller than one cell.");
+        }
+        for (int row = 0; row < rows; row++) {
+            for (int column = 0; column < columns; column++) {
+                cells.append(QRect(QPoint(column * cellSize.width(), row * cellSize.height()), cellSize));
+            }
+        }
+        m_spriteSize = cellSize;
+    }
+    if (m_spriteSize.width() > MaximumSpriteSide || m_spriteSize.height() > MaximumSpriteSide) {
+        return fail(QString("Frames can be at most %1 pixels wide and high.").arg(MaximumSpriteSide));
+    }
+    const QSize spriteSize = m_spriteSize;
+    QVector<Frame> frames = QtConcurrent::blockingMapped<QVector<Frame>>(cells, [&sheet, spriteSize](const QRect &cell) {
+        return frameFromArea(sheet, cell, spriteSize);
+    });
+    // Fully transparent pixels are stored as no tile at all, so empty cells hold no tiles
+    auto isEmpty = [](const Frame &frame) { return frame.allocatedTileCount() == 0; };
+    if (cellSize.isEmpty()) {
+        frames.erase(std::remove_if(frames.begin(), frames.end(), isEmpty), frames.end());
+    } else {
+        while (frames.size() > 1 && isEmpty(frames.last())) {
+            frames.removeLast();
+        }
+    }
+    m_frames = FrameList(frames);
+    return true;
+}
+
+///
+/// \brief Reads every frame of an animated GIF or PNG. Images that are not animated
+/// become a single frame.
+/// \return If the animation was read; errorString() describes the failure otherwise
+///
+bool FrameImporter::readAnimation()
+{
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(file.errorString());
+    }
+    const QByteArray signature("\x89PNG\r\n\x1a\n", 8);
+    if (file.peek(signature.size()) == signature) {
+        bool isAnimated = false;
+        const bool isRead = readApng(file.readAll(), isAnimated);
+        if (isAnimated) {
+            return isRead;
+        }
+    }
+    file.close();
+    return readImageFrames();
+}
+
+FrameList FrameImporter::frames() const
+{
+    return m_frames;
+}
+
+QSize FrameImporter::spriteSize() const
+{
+    return m_spriteSize;
+}
+
+QString FrameImporter::errorString() const
+{
+    return m_errorString;
+}
+
+///
+/// \brief Reads every PNG image in a folder as one frame, in natural name order so
+/// that frame_10.png follows frame_9.png. The sprite is as large as the largest image.
+/// \return If the images were read; errorString() describes the failure otherwise
+///
+bool FrameImporter::readSequence()
+{
+    const QDir folder(m_fileName);
+    QStringList names = folder.entryList({"*.png"}, QDir::Files);
+    if (names.isEmpty()) {
+        return fail("The folder holds no PNG images.");
+    }
+    QCollator collator;
+    collator.setNumericMode(true);
+    std::sort(names.begin(), names.end(), collator);
+    // Only the headers are read here, so the sprite size is known before any image is decoded
+    m_spriteSize = QSize(0, 0);
+    QStringList paths;
+    for (const QString &name : names) {
+        paths.append(folder.filePath(name));
+        QImageReader reader(paths.last());
+        const QSize size = reader.size();
+        if (!size.isValid()) {
+            return fail(name + ": " + reader.errorString());
+        }
+        m_spriteSize = m_spriteSize.expandedTo(size);
+    }
+    if (m_spriteSize.width() > MaximumSpriteSide || m_spriteSize.height() > MaximumSpriteSide) {
+        return fail(QString("Frames can be at most %1 pixels wide and high.").arg(MaximumSpriteSide));
+    }
+    // Each image is decoded and placed by one task and dropped straight away, so only
+    // as many images as there are threads are held at once
+    const QSize spriteSize = m_spriteSize;
+    QVector<int> indices(names.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    QVector<QString> errors(names.size());
+    const QVector<Frame> frames = QtConcurrent::blockingMapped<QVector<Frame>>(
+        indices, [&names, &paths, &errors, spriteSize](int index) {
+            QImageReader reader(paths.at(index));
+            const QImage image = reader.read();
+            if (image.isNull()) {
+                errors[index] = names.at(index) + ": " + reader.errorString();
+                return Frame();
+            }
+            QImage pixels = image.convertToFormat(QImage::Format_ARGB32);
+            for (int y = 0; y < pixels.height(); y++) {
+                QRgb *line = reinterpret_cast<QRgb *>(pixels.scanLine(y));
+                std::replace_if(line, line + pixels.width(), [](QRgb pixel) { return qAlpha(pixel) == 0; }, QRgb(0));
+            }
+            return frameFromArea(pixels, pixels.rect(), spriteSize);
+        });
+    for (const QString &error : errors) {
+        if (!error.isEmpty()) {
+            return fail(error);
+        }
+    }
+    m_frames = FrameList(frames);
+    return true;
+}
+
+///
+/// \brief Returns an image as ARGB32, converting bands of rows on the thread pool.
+/// Fully transparent pixels are cleared to 0 as well, so they compare equal and are
+/// never stored in a tile.
+///
+QImage FrameImporter::toArgb32(const QImage &image)
+{
+    QImage converted(image.size(), QImage::Format_ARGB32);
+    // Rows are written through one pointer taken up front, since scanLine() is not
+    // safe to call from several threads at once
+    uchar *const bits = converted.bits();
+    const qsizetype bytesPerLine = converted.bytesPerLine();
+    QVector<int> bands((image.height() + BandHeight - 1) / BandHeight);
+    std::iota(bands.begin(), bands.end(), 0);
+    QtConcurrent::blockingMap(bands, [&image, bits, bytesPerLine](int band) {
+        const int top = band * BandHeight;
+        const int height = qMin(BandHeight, image.height() - top);
+        QImage source(image.constScanLine(top), image.width(), height, image.bytesPerLine(), image.format());
+        source.setColorTable(image.colorTable());
+        const QImage part = source.convertToFormat(QImage::Format_ARGB32);
+        for (int y = 0; y < height; y++) {
+            QRgb *line = reinterpret_cast<QRgb *>(bits + (top + y) * bytesPerLine);
+            std::memcpy(line, part.constScanLine(y), image.width() * sizeof(QRgb));
+            std::replace_if(line, line + image.width(), [](QRgb pixel) { return qAlpha(pixel) == 0; }, QRgb(0));
+        }
+    });
+    return converted;
+}
+
+///
+/// \brief Returns the cells of a sheet bounded by fully transparent rows and columns.
+///
+QVector<QRect> FrameImporter::findCells(const QImage &sheet)
+{
+    QVector<char> usedRows(sheet.height(), 0);
+    char *const rows = usedRows.data();
+    QVector<int> bands((sheet.height() + BandHeight - 1) / BandHeight);
+    std::iota(bands.begin(), bands.end(), 0);
+    // Every band marks its own rows and returns the columns it uses, which are merged after
+    const QVector<QVector<char>> bandColumns = QtConcurrent::blockingMapped<QVector<QVector<char>>>(bands, [&sheet, rows](int band) {
+        QVector<char> columns(sheet.width(), 0);
+        const int top = band * BandHeight;
+        const int bottom = qMin(top + BandHeight, sheet.height());
+        for (int y = top; y < bottom; y++) {
+            const QRgb *line = reinterpret_cast<const QRgb *>(sheet.constScanLine(y));
+            for (int x = 0; x < sheet.width(); x++) {
+                if (line[x] != 0) {
+                    columns[x] = 1;
+                    rows[y] = 1;
+                }
+            }
+        }
+        return columns;
+    });
+    QVector<char> usedColumns(sheet.width(), 0);
+    for (const QVector<char> &columns : bandColumns) {
+        for (int x = 0; x < columns.size(); x++) {
+            usedColumns[x] |= columns.at(x);
+        }
+    }
+    QVector<QRect> cells;
+    const QVector<std::pair<int, int>> columnSpans = usedSpans(usedColumns);
+    for (const std::pair<int, int> &rowSpan : usedSpans(usedRows)) {
+        for (const std::pair<int, int> &columnSpan : columnSpans) {
+            cells.append(QRect(columnSpan.first, rowSpan.first, columnSpan.second, rowSpan.second));
+        }
+    }
+    return cells;
+}
+
+///
+/// \brief Copies part of an ARGB32 image into a frame of the sprite size.
+///
+Frame FrameImporter::frameFromArea(const QImage &image, const QRect &area, const QSize &spriteSize)
+{
+    // A read only view of the area, so only the tiles the frame keeps are copied
+    const QImage view(image.constScanLine(area.y()) + area.x() * sizeof(QRgb), area.width(), area.height(),
+                      image.bytesPerLine(), QImage::Format_ARGB32);
+    if (area.size() == spriteSize) {
+        return Frame::fromImage(view);
+    }
+    QImage placed(spriteSize, QImage::Format_ARGB32);
+    placed.fill(0);
+    const QPoint offset((spriteSize.width() - area.width()) / 2, spriteSize.height() - area.height());
+    for (int y = 0; y < area.height(); y++) {
+        std::memcpy(placed.scanLine(offset.y() + y) + offset.x() * sizeof(QRgb), view.constScanLine(y),
+                    area.width() * sizeof(QRgb));
+    }
+    return Frame::fromImage(placed);
+}
+
+///
+/// \brief Reads an animated PNG held in memory.
+/// \param contents = Whole file
+/// \param isAnimated = Set to false when the file is a PNG this reader does not
+/// animate, so it is read as a plain image instead
+///
+bool FrameImporter::readApng(const QByteArray &contents, bool &isAnimated)
+{
+    isAnimated = false;
+    QSize canvasSize;
+    int channels = 0;
+    bool isSupported = false;
+    QVector<ApngFrame> apngFrames;
+    qsizetype position = 8;
+    while (position + 12 <= contents.size()) {
+        const quint32 length = readLong(contents.constData() + position);
+        if (length > quint32(contents.size() - position - 12)) {
+            return fail("The animated PNG is truncated.");
+        }
+        const QByteArray type = contents.mid(position + 4, 4);
+        const char *data = contents.constData() + position + 8;
+        position += 12 + length;
+        if (type == "IHDR" && length >= 13) {
+            canvasSize = QSize(int(readLong(data)), int(readLong(data + 4)));
+            channels = data[9] == 6 ? 4 : data[9] == 2 ? 3 : 0;
+            // Only 8 bit, non interlaced RGB and RGBA are animated here
+            isSupported = data[8] == 8 && channels > 0 && data[12] == 0;
+        } else if (type == "acTL") {
+            isAnimated = isSupported;
+        } else if (type == "fcTL" && length >= 26) {
+            ApngFrame frame;
+            frame.area = QRect(int(readLong(data + 12)), int(readLong(data + 16)), int(readLong(data + 4)), int(readLong(data + 8)));
+            frame.disposeOp = data[24];
+            frame.blendOp = data[25];
+            apngFrames.append(frame);
+        } else if (type == "IDAT") {
+            // The default image is only part of the animation when a frame control comes first
+            if (!apngFrames.isEmpty()) {
+                apngFrames.last().data.append(data, length);
+            }
+        } else if (type == "fdAT" && length >= 4 && !apngFrames.isEmpty()) {
+            apngFrames.last().data.append(data + 4, length - 4);
+        } else if (type == "IEND") {
+            break;
+        }
+    }
+    if (!isAnimated) {
+        return false;
+    }
+    if (canvasSize.isEmpty() || canvasSize.width() > MaximumSpriteSide || canvasSize.height() > MaximumSpriteSide) {
+        return fail(QString("Frames can be at most %1 pixels wide and high.").arg(MaximumSpriteSide));
+    }
+    if (apngFrames.isEmpty()) {
+        return fail("The animated PNG has no frames.");
+    }
+    for (const ApngFrame &frame : apngFrames) {
+        if (frame.area.isEmpty() || !QRect(QPoint(0, 0), canvasSize).contains(frame.area)) {
+            return fail("The animated PNG has a frame outside of its canvas.");
+        }
+    }
+
+    const QVector<QImage> pixels = QtConcurrent::blockingMapped<QVector<QImage>>(apngFrames, [channels](const ApngFrame &frame) {
+        return decodeApngFrame(frame, channels);
+    });
+    // Each frame is drawn over what the ones before it left, so composing stays in order
+    QImage canvas(canvasSize, QImage::Format_ARGB32);
+    canvas.fill(0);
+    QVector<Frame> frames;
+    for (int index = 0; index < apngFrames.size(); index++) {
+        const ApngFrame &frame = apngFrames.at(index);
+        const QImage &image = pixels.at(index);
+        if (image.isNull()) {
+            return fail("The animated PNG is corrupt.");
+        }
+        // Restoring to before the first frame means clearing
+        const int disposeOp = index == 0 && frame.disposeOp == 2 ? 1 : frame.disposeOp;
+        const QImage previous = disposeOp == 2 ? canvas.copy(frame.area) : QImage();
+        for (int y = 0; y < frame.area.height(); y++) {
+            QRgb *line = reinterpret_cast<QRgb *>(canvas.scanLine(frame.area.y() + y)) + frame.area.x();
+            const QRgb *source = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+            for (int x = 0; x < frame.area.width(); x++) {
+                const int alpha = qAlpha(source[x]);
+                if (frame.blendOp == 0 || alpha == 255 || qAlpha(line[x]) == 0) {
+                    line[x] = source[x];
+                } else if (alpha > 0) {
+                    // Draw the unpremultiplied pixel over the one below it
+                    const int below = qAlpha(line[x]) * (255 - alpha) / 255;
+                    const int total = alpha + below;
+                    line[x] = qRgba((qRed(source[x]) * alpha + qRed(line[x]) * below) / total,
+                                    (qGreen(source[x]) * alpha + qGreen(line[x]) * below) / total,
+                                    (qBlue(source[x]) * alpha + qBlue(line[x]) * below) / total, total);
+                }
+            }
+        }
+        frames.append(Frame::fromImage(canvas));
+        if (disposeOp == 1) {
+            for (int y = frame.area.top(); y <= frame.area.bottom(); y++) {
+                QRgb *line = reinterpret_cast<QRgb *>(canvas.scanLine(y));
+                std::fill(line + frame.area.left(), line + frame.area.right() + 1, QRgb(0));
+            }
+        } else if (disposeOp == 2) {
+            for (int y = 0; y < previous.height(); y++) {
+                std::memcpy(canvas.scanLine(frame.area.y() + y) + frame.area.x() * sizeof(QRgb), previous.constScanLine(y),
+                            previous.width() * sizeof(QRgb));
+            }
+        }
+    }
+    m_spriteSize = canvasSize;
+    m_frames = FrameList(frames);
+    return true;
+}
+
+///
+/// \brief Inflates and unfilters the rows of one animated PNG frame.
+/// \param frame = Frame to decode
+/// \param channels = 3 for RGB, 4 for RGBA
+/// \return The pixels, or a null image if the data is corrupt
+///
+QImage FrameImporter::decodeApngFrame(const ApngFrame &frame, int channels)
+{
+    const int rowSize = frame.area.width() * channels;
+    const qint64 expected = qint64(rowSize + 1) * frame.area.height();
+    if (expected > std::numeric_limits<int>::max()) {
+        return QImage();
+    }
+    // qUncompress expects the zlib stream to follow its uncompressed size
+    QByteArray compressed(4, char(0));
+    compressed[0] = char((expected >> 24) & 0xff);
+    compressed[1] = char((expected >> 16) & 0xff);
+    compressed[2] = char((expected >> 8) & 0xff);
+    compressed[3] = char(expected & 0xff);
+    compressed.append(frame.data);
+    const QByteArray raw = qUncompress(compressed);
+    if (raw.size() != expected) {
+        return QImage();
+    }
+    QImage image(frame.area.size(), QImage::Format_ARGB32);
+    QVector<int> previous(rowSize, 0);
+    QVector<int> row(rowSize, 0);
+    for (int y = 0; y < frame.area.height(); y++) {
+        const uchar *filtered = reinterpret_cast<const uchar *>(raw.constData()) + y * (rowSize + 1);
+        const int filter = filtered[0];
+        for (int index = 0; index < rowSize; index++) {
+            const int left = index >= channels ? row.at(index - channels) : 0;
+            const int up = previous.at(index);
+            const int upLeft = index >= channels ? previous.at(index - channels) : 0;
+            int predicted = 0;
+            switch (filter) {
+            case 0:
+                break;
+            case 1:
+                predicted = left;
+                break;
+            case 2:
+                predicted = up;
+                break;
+            case 3:
+                predicted = (left + up) / 2;
+                break;
+            case 4:
+                predicted = ApngEncoder::paethPredictor(left, up, upLeft);
+                break;
+            default:
+                return QImage();
+            }
+            row[index] = (filtered[index + 1] + predicted) & 0xff;
+        }
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < frame.area.width(); x++) {
+            const int *pixel = row.constData() + x * channels;
+            const int alpha = channels == 4 ? pixel[3] : 255;
+            line[x] = alpha == 0 ? 0 : qRgba(pixel[0], pixel[1], pixel[2], alpha);
+        }
+        std::swap(previous, row);
+    }
+    return image;
+}
+
+///
+/// \brief Reads the frames of an image with QImageReader, one at a time.
+///
+bool FrameImporter::readImageFrames()
+{
+    QImageReader reader(m_fileName);
+    QVector<QImage> images;
+    while (true) {
+        const QImage image = reader.read();
+        if (image.isNull()) {
+            break;
+        }
+        images.append(image);
+        if (!reader.supportsAnimation() || !reader.canRead()) {
+            break;
+        }
+    }
+    if (images.isEmpty()) {
+        return fail(reader.errorString());
+    }
+    m_spriteSize = QSize(0, 0);
+    for (const QImage &image : images) {
+        m_spriteSize = m_spriteSize.expandedTo(image.size());
+    }
+    if (m_spriteSize.width() > MaximumSpriteSide || m_spriteSize.height() > MaximumSpriteSide) {
+        return fail(QString("Frames can be at most %1 pixels wide and high.").arg(MaximumSpriteSide));
+    }
+    const QSize spriteSize = m_spriteSize;
+    const QVector<Frame> frames = QtConcurrent::blockingMapped<QVector<Frame>>(images, [spriteSize](const QImage &image) {
+        QImage pixels = image.convertToFormat(QImage::Format_ARGB32);
+        for (int y = 0; y < pixels.height(); y++) {
+            QRgb *line = reinterpret_cast<QRgb *>(pixels.scanLine(y));
+            std::replace_if(line, line + pixels.width(), [](QRgb pixel) { return qAlpha(pixel) == 0; }, QRgb(0));
+        }
+        return frameFromArea(pixels, pixels.rect(), spriteSize);
+    });
+    m_frames = FrameList(frames);
+    return true;
+}
+
+///
+/// \brief Records an error message and returns false.
+///
+bool FrameImporter::fail(const QString &message)
+{
+    m_errorString = message;
+    return false;
+}
@@ -0,0 +1,126 @@
+#ifndef FRAMEIMPORTER_H
+#define FRAMEIMPORTER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QRect>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include "framelist.h"
+
+///
+/// \brief The FrameImporter class turns existing art into frames: sprite sheets sliced
+/// on a fixed grid or along fully transparent gutters, animated GIF or PNG files
+/// with one frame per animation frame, and folders holding one image per frame. Frames smaller than the sprite are centered
+/// horizontally and rest on its bottom edge.
+///
+/// Format conversion and gutter detection are split into bands of rows and slicing
+/// into cells, all spread over the thread pool. Animated PNG frames are inflated and
+/// unfiltered in parallel and only composed in order; GIF frames have to be decoded in
+/// order, but are converted in parallel. The images of a folder are decoded in parallel.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class FrameImporter
+{
+public:
+    static constexpr int BandHeight = 64; ///Rows of a sheet converted or scanned by one task
+    static constexpr int MaximumSpriteSide = 16384; ///Largest sprite width or height the editor creates
+
+    ///
+    /// \brief Creates an importer reading the given image file or folder.
+    /// \param fileName = Path of the sheet, animation or image sequence folder
+    ///
+    explicit FrameImporter(const QString &fileName);
+
+    ///
+    /// \brief Reads a sprite sheet and slices it into frames, left to right and top to
+    /// bottom. Empty cells after the last drawn cell are dropped; with gutter detection
+    /// every empty cell is.
+    /// \param cellSize = Size of one grid cell, or an empty size to slice along the rows
+    /// and columns that are fully transparent
+    /// \return If the sheet was read; errorString() describes the failure otherwise
+    ///
+    bool readSheet(const QSize &cellSize);
+
+    ///
+    /// \brief Reads every frame of an animated GIF or PNG. Images that are not animated
+    /// become a single frame.
+    /// \return If the animation was read; errorString() describes the failure otherwise
+    ///
+    bool readAnimation();
+
+    ///
+    /// \brief Reads every PNG image in a folder as one frame, in natural name order so
+    /// that frame_10.png follows frame_9.png. The sprite is as large as the largest image.
+    /// \return If the images were read; errorString() describes the failure otherwise
+    ///
+    bool readSequence();
+
+    FrameList frames() const; ///Returns the imported frames
+    QSize spriteSize() const; ///Returns the size of the imported frames
+    QString errorString() const; ///Returns a description of the last error
+
+private:
+    ///
+    /// \brief One frame of an animated PNG as stored in the file.
+    ///
+    struct ApngFrame {
+        QRect area; ///Part of the canvas the frame covers
+        int disposeOp = 0; ///How the area is cleared after the frame is shown
+        int blendOp = 0; ///If the frame replaces or is drawn over the canvas
+        QByteArray data; ///Compressed, filtered rows of the area
+    };
+
+    ///
+    /// \brief Returns an image as ARGB32, converting bands of rows on the thread pool.
+    /// Fully transparent pixels are cleared to 0 as well, so they compare equal and are
+    /// never stored in a tile.
+    ///
+    static QImage toArgb32(const QImage &image);
+
+    ///
+    /// \brief Returns the cells of a sheet bounded by fully transparent rows and columns.
+    ///
+    static QVector<QRect> findCells(const QImage &sheet);
+
+    ///
+    /// \brief Copies part of an ARGB32 image into a frame of the sprite size.
+    ///
+    static Frame frameFromArea(const QImage &image, const QRect &area, const QSize &spriteSize);
+
+    ///
+    /// \brief Reads an animated PNG held in memory.
+    /// \param contents = Whole file
+    /// \param isAnimated = Set to false when the file is a PNG this reader does not
+    /// animate, so it is read as a plain image instead
+    ///
+    bool readApng(const QByteArray &contents, bool &isAnimated);
+
+    ///
+    /// \brief Inflates and unfilters the rows of one animated PNG frame.
+    /// \param frame = Frame to decode
+    /// \param channels = 3 for RGB, 4 for RGBA
+    /// \return The pixels, or a null image if the data is corrupt
+    ///
+    static QImage decodeApngFrame(const ApngFrame &frame, int channels);
+
+    ///
+    /// \brief Reads the frames of an image with QImageReader, one at a time.
+    ///
+    bool readImageFrames();
+
+    ///
+    /// \brief Records an error message and returns false.
+    ///
+    bool fail(const QString &message);
+
+    QString m_fileName; ///Stores the path of the image
+    FrameList m_frames; ///Stores the imported frames
+    QSize m_spriteSize; ///Stores the size of the imported frames
+    QString m_errorString; ///Stores the description of the last error
+};
+
+#endif // FRAMEIMPORTER_H
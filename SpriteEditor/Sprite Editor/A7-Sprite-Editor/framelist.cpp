@@ -0,0 +1,172 @@
+#include "framelist.h"
+
+///
+/// \brief Creates an empty list.
+///
+FrameList::FrameList()
+{
+}
+
+///
+/// \brief Creates a list holding already decoded frames.
+/// \param frames = Frames in order
+///
+FrameList::FrameList(const QVector<Frame> &frames)
+{
+    m_entries.reserve(frames.size());
+    for (const Frame &frame : frames) {
+        m_entries.append(Entry{frame, -1});
+    }
+}
+
+///
+/// \brief Creates a list of every frame in a source, none of them decoded yet.
+/// \param source = Loaded binary project
+///
+FrameList::FrameList(const std::shared_ptr<const FrameSource> &source)
+    : m_source(source)
+{
+    const Frame unloaded;
+    m_entries.reserve(source->frameCount());
+    for (int index = 0; index < source->frameCount(); index++) {
+        m_entries.append(Entry{unloaded, index});
+    }
+}
+
+int FrameList::size() const
+{
+    return m_entries.size();
+}
+
+bool FrameList::isEmpty() const
+{
+    return m_entries.isEmpty();
+}
+
+///
+/// \brief Returns a frame, decoding it first if it is still in the source.
+/// \param index = Frame to read
+///
+Frame FrameList::at(int index) const
+{
+    const Entry &entry = m_entries.at(index);
+    return entry.sourceIndex < 0 ? entry.frame : m_source->frame(entry.sourceIndex);
+}
+
+///
+/// \brief Returns a frame for writing. A frame still in the source is decoded and
+/// kept in the list from then on.
+/// \param index = Frame to write
+///
+Frame &FrameList::operator[](int index)
+{
+    Entry &entry = m_entries[index];
+    if (entry.sourceIndex >= 0) {
+        entry.frame = m_source->frame(entry.sourceIndex);
+        entry.sourceIndex = -1;
+    }
+    return entry.frame;
+}
+
+///
+/// \brief Returns if this list and another hold the same frame at an index, so it is
+/// known to be unchanged without comparing pixels. Frames not read from the same
+/// source and not written since count as the same.
+/// \param index = Frame to compare, inside both lists
+/// \param other = List to compare with
+///
+bool FrameList::sharesFrame(int index, const FrameList &other) const
+{
+    return sharesEntry(m_entries.at(index), other, other.m_entries.at(index));
+}
+
+std::shared_ptr<const FrameSource> FrameList::source() const
+{
+    return m_source;
+}
+
+int FrameList::sourceIndex(int index) const
+{
+    return m_entries.at(index).sourceIndex;
+}
+
+///
+/// \brief Moves the list onto the source of a project it was just saved to. Frames
+/// that are still the ones that were saved are read from the new source from then
+/// on, and the list holds the rest, so the old source can be released. A frame is
+/// looked for at the same index in the saved list, or counted from the end when
+/// frames were added or removed in front of it since. Nothing changes once the list
+/// reads from another source than the saved frames did.
+/// \param saved = Frames that were written
+/// \param written = Same frames read back from the saved project
+///
+void FrameList::rebase(const FrameList &saved, const FrameList &written)
+{
+    if (!written.m_source || written.size() != saved.size() || m_source != saved.m_source) {
+        return;
+    }
+    const int shift = saved.size() - size();
+    for (int index = 0; index < m_entries.size(); index++) {
+        Entry &entry = m_entries[index];
+        int savedIndex = -1;
+        for (int candidate : {index, index + shift}) {
+            if (candidate >= 0 && candidate < saved.size()
+                && sharesEntry(entry, saved, saved.m_entries.at(candidate))) {
+                savedIndex = candidate;
+                break;
+            }
+        }
+        if (savedIndex >= 0) {
+            entry = Entry{Frame(), savedIndex};
+        } else if (entry.sourceIndex >= 0) {
+            entry.frame = m_source->frame(entry.sourceIndex);
+            entry.sourceIndex = -1;
+        }
+    }
+    m_source = written.m_source;
+}
+
+///
+/// \brief Returns if an entry of this list and an entry of another list hold the
+/// same frame.
+///
+bool FrameList::sharesEntry(const Entry &entry, const FrameList &other, const Entry &otherEntry) const
+{
+    if (entry.sourceIndex >= 0 || otherEntry.sourceIndex >= 0) {
+        return m_source == other.m_source && entry.sourceIndex == otherEntry.sourceIndex;
+    }
+    return entry.frame.isSharedWith(otherEntry.frame);
+}
+
+///
+/// \brief Adds a frame at the end.
+///
+void FrameList::append(const Frame &frame)
+{
+    m_entries.append(Entry{frame, -1});
+}
+
+///
+/// \brief Adds a frame before the given index.
+///
+void FrameList::insert(int index, const Frame &frame)
+{
+    m_entries.insert(index, Entry{frame, -1});
+}
+
+///
+/// \brief Removes a frame.
+///
+void FrameList::removeAt(int index)
+{
+    m_entries.removeAt(index);
+}
+
+///
+/// \brief Removes every frame and releases the source.
+///
+void FrameList::clear()
+{
+    m_entries.clear();
+    m_source.reset();
+}
@@ -0,0 +1,111 @@
+#ifndef FRAMELIST_H
+#define FRAMELIST_H
+
+#include <QVector>
+#include <memory>
+#include "frame.h"
+#include "framesource.h"
+
+///
+/// \brief The FrameList class holds the frames of a sprite in order. Frames of a loaded
+/// binary project stay in their FrameSource until something reads them, so opening a
+/// project only reads its index. A frame is kept in the list itself once it is
+/// written to or added. Copying a list is cheap and shares both the frames and the source.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class FrameList
+{
+public:
+    ///
+    /// \brief Creates an empty list.
+    ///
+    FrameList();
+
+    ///
+    /// \brief Creates a list holding already decoded frames.
+    /// \param frames = Frames in order
+    ///
+    FrameList(const QVector<Frame> &frames);
+
+    ///
+    /// \brief Creates a list of every frame in a source, none of them decoded yet.
+    /// \param source = Loaded binary project
+    ///
+    explicit FrameList(const std::shared_ptr<const FrameSource> &source);
+
+    int size() const; ///Returns the number of frames
+    bool isEmpty() const; ///Returns if the list has no frames
+
+    ///
+    /// \brief Returns a frame, decoding it first if it is still in the source.
+    /// \param index = Frame to read
+    ///
+    Frame at(int index) const;
+
+    ///
+    /// \brief Returns a frame for writing. A frame still in the source is decoded and
+    /// kept in the list from then on.
+    /// \param index = Frame to write
+    ///
+    Frame &operator[](int index);
+
+    ///
+    /// \brief Returns if this list and another hold the same frame at an index, so it is
+    /// known to be unchanged without comparing pixels. Frames not read from the same
+    /// source and not written since count as the same.
+    /// \param index = Frame to compare, inside both lists
+    /// \param other = List to compare with
+    ///
+    bool sharesFrame(int index, const FrameList &other) const;
+
+    ///
+    /// \brief Returns the source the frames that are not held yet are decoded from.
+    ///
+    std::shared_ptr<const FrameSource> source() const;
+
+    ///
+    /// \brief Returns the index of a frame in the source, or -1 if the list holds it.
+    /// \param index = Frame to look up
+    ///
+    int sourceIndex(int index) const;
+
+    ///
+    /// \brief Moves the list onto the source of a project it was just saved to. Frames
+    /// that are still the ones that were saved are read from the new source from then
+    /// on, and the list holds the rest, so the old source can be released. A frame is
+    /// looked for at the same index in the saved list, or counted from the end when
+    /// frames were added or removed in front of it since. Nothing changes once the list
+    /// reads from another source than the saved frames did.
+    /// \param saved = Frames that were written
+    /// \param written = Same frames read back from the saved project
+    ///
+    void rebase(const FrameList &saved, const FrameList &written);
+
+    void append(const Frame &frame); ///Adds a frame at the end
+    void insert(int index, const Frame &frame); ///Adds a frame before the given index
+    void removeAt(int index); ///Removes a frame
+    void clear(); ///Removes every frame and releases the source
+
+private:
+    ///
+    /// \brief One position in the list: either a frame or the index of a frame in the source.
+    ///
+    struct Entry
+    {
+        Frame frame; ///Stores the frame once it is held by the list
+        int sourceIndex; ///Index of the frame in the source, or -1 if the frame is held
+    };
+
+    ///
+    /// \brief Returns if an entry of this list and an entry of another list hold the
+    /// same frame.
+    ///
+    bool sharesEntry(const Entry &entry, const FrameList &other, const Entry &otherEntry) const;
+
+    QVector<Entry> m_entries; ///Stores the frames in order
+    std::shared_ptr<const FrameSource> m_source; ///Decodes the frames that are not held yet
+};
+
+#endif // FRAMELIST_H
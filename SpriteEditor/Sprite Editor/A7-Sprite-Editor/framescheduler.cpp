@@ -0,0 +1,125 @@
+#include "framescheduler.h"
+#include <QScreen>
+
+///
+/// \brief Constructor for FrameScheduler.
+/// \param target = Widget whose repaints are scheduled
+///
+FrameScheduler::FrameScheduler(QWidget *target)
+    : QObject(target), m_target(target)
+{
+    m_frameTimer.setSingleShot(true);
+    m_frameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_frameTimer, &QTimer::timeout, this, &FrameScheduler::deliverFrame);
+    m_sinceLastFrame.start();
+}
+
+///
+/// \brief Adds a rectangle to the region repainted on the next frame.
+/// \param rect = Rectangle in widget coordinates
+///
+void FrameScheduler::requestRepaint(const QRect &rect)
+{
+    if (rect.isEmpty()) {
+        return;
+    }
+    m_requestedRepaints++;
+    if (!m_fullRepaintPending) {
+        m_pendingRegion += rect;
+    }
+    scheduleFrame();
+}
+
+///
+/// \brief Repaints the whole widget on the next frame.
+///
+void FrameScheduler::requestFullRepaint()
+{
+    m_requestedRepaints++;
+    m_fullRepaintPending = true;
+    m_pendingRegion = QRegion();
+    scheduleFrame();
+}
+
+///
+/// \brief Schedules a frame without dirtying anything so work queued for the
+/// next frame still runs.
+///
+void FrameScheduler::requestFrame()
+{
+    scheduleFrame();
+}
+
+///
+/// \brief Returns how many repaints were requested since the counters were reset.
+///
+int FrameScheduler::requestedRepaints() const
+{
+    return m_requestedRepaints;
+}
+
+///
+/// \brief Returns how many repaints were delivered since the counters were reset.
+///
+int FrameScheduler::deliveredRepaints() const
+{
+    return m_deliveredRepaints;
+}
+
+///
+/// \brief Sets the requested and delivered repaint counters back to zero.
+///
+void FrameScheduler::resetCounters()
+{
+    m_requestedRepaints = 0;
+    m_deliveredRepaints = 0;
+}
+
+///
+/// \brief Delivers every request collected since the last frame as one repaint.
+///
+void FrameScheduler::deliverFrame()
+{
+    // Work done here may add more dirty rectangles to this frame, which must not
+    // schedule another one
+    m_isDelivering = true;
+    emit frameStarted();
+    m_isDelivering = false;
+    m_sinceLastFrame.restart();
+    if (m_fullRepaintPending) {
+        m_target->update();
+    } else if (!m_pendingRegion.isEmpty()) {
+        m_target->update(m_pendingRegion);
+    } else {
+        return;
+    }
+    m_deliveredRepaints++;
+    m_fullRepaintPending = false;
+    m_pendingRegion = QRegion();
+}
+
+///
+/// \brief Starts the frame timer so the next frame lands one refresh interval
+/// after the previous one.
+///
+void FrameScheduler::scheduleFrame()
+{
+    if (m_frameTimer.isActive() || m_isDelivering) {
+        return;
+    }
+    qint64 remaining = refreshInterval() - m_sinceLastFrame.elapsed();
+    m_frameTimer.start(remaining > 0 ? int(remaining) : 0);
+}
+
+///
+/// \brief Returns the refresh interval of the target's screen in milliseconds.
+///
+int FrameScheduler::refreshInterval() const
+{
+    QScreen *screen = m_target->screen();
+    qreal refreshRate = screen ? screen->refreshRate() : 60.0;
+    if (refreshRate <= 0) {
+        refreshRate = 60.0;
+    }
+    return qMax(1, qRound(1000.0 / refreshRate));
+}
@@ -0,0 +1,91 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <QObject>
+#include <QWidget>
+#include <QRegion>
+#include <QTimer>
+#include <QElapsedTimer>
+
+///
+/// \brief The FrameScheduler class collects repaint requests for a widget and
+/// coalesces them so that at most one repaint is delivered per display refresh.
+/// Every request between two refreshes is merged into a single dirty region.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class FrameScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    ///
+    /// \brief Constructor for FrameScheduler.
+    /// \param target = Widget whose repaints are scheduled
+    ///
+    explicit FrameScheduler(QWidget *target);
+
+    ///
+    /// \brief Adds a rectangle to the region repainted on the next frame.
+    /// \param rect = Rectangle in widget coordinates
+    ///
+    void requestRepaint(const QRect &rect);
+
+    ///
+    /// \brief Repaints the whole widget on the next frame.
+    ///
+    void requestFullRepaint();
+
+    ///
+    /// \brief Schedules a frame without dirtying anything so work queued for the
+    /// next frame still runs.
+    ///
+    void requestFrame();
+
+    ///
+    /// \brief Returns how many repaints were requested since the counters were reset.
+    ///
+    int requestedRepaints() const;
+
+    ///
+    /// \brief Returns how many repaints were delivered since the counters were reset.
+    ///
+    int deliveredRepaints() const;
+
+    ///
+    /// \brief Sets the requested and delivered repaint counters back to zero.
+    ///
+    void resetCounters();
+
+signals:
+    void frameStarted(); ///Sent right before the coalesced repaint is delivered
+
+private slots:
+    ///
+    /// \brief Delivers every request collected since the last frame as one repaint.
+    ///
+    void deliverFrame();
+
+private:
+    ///
+    /// \brief Starts the frame timer so the next frame lands one refresh interval
+    /// after the previous one.
+    ///
+    void scheduleFrame();
+
+    ///
+    /// \brief Returns the refresh interval of the target's screen in milliseconds.
+    ///
+    int refreshInterval() const;
+
+    QWidget *m_target; ///Widget that receives the repaints
+    QRegion m_pendingRegion; ///Stores the region collected for the next frame
+    bool m_fullRepaintPending = false; ///Stores if the whole widget must be repainted
+    QTimer m_frameTimer; ///Fires once per frame while requests are pending
+    QElapsedTimer m_sinceLastFrame; ///Measures the time since the last delivered frame
+    bool m_isDelivering = false; ///Stores if a frame is being delivered, so requests made meanwhile join it
+    int m_requestedRepaints = 0; ///Stores the number of repaint requests
+    int m_deliveredRepaints = 0; ///Stores the number of repaints actually delivered
+};
+
+#endif // FRAMESCHEDULER_H
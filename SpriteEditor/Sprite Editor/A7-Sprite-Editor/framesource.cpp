@@ -0,0 +1,115 @@
+#include "framesource.h"
+#include "framecodec.h"
+#include <QDebug>
+
+///
+/// \brief Creates a source over the contents of a binary project. The entries must
+/// already be checked to lie inside the data, and the first one must not be a delta.
+/// \param data = First byte of the file
+/// \param owner = Keeps the data alive while the source or any of its frames uses it
+/// \param spriteSize = Size of every frame
+/// \param entries = Frame index in frame order
+/// \param palette = Colors of the palette encoded frames
+/// \param origin = File and frame index the entries were read from
+///
+FrameSource::FrameSource(const uchar *data, const std::shared_ptr<const void> &owner, const QSize &spriteSize,
+                         const QVector<Entry> &entries, const QVector<QRgb> &palette, const Origin &origin)
+    : m_data(data), m_owner(owner), m_spriteSize(spriteSize), m_entries(entries), m_palette(palette)
+    , m_origin(origin), m_cache(CacheLimit)
+{
+}
+
+int FrameSource::frameCount() const
+{
+    return m_entries.size();
+}
+
+QSize FrameSource::spriteSize() const
+{
+    return m_spriteSize;
+}
+
+const FrameSource::Entry &FrameSource::entry(int index) const
+{
+    return m_entries.at(index);
+}
+
+const QVector<QRgb> &FrameSource::palette() const
+{
+    return m_palette;
+}
+
+const FrameSource::Origin &FrameSource::origin() const
+{
+    return m_origin;
+}
+
+///
+/// \brief Returns a frame, decoding it and any deltas it depends on if they are not
+/// cached. A payload that turns out to be corrupt logs a warning and reads as a
+/// transparent frame.
+/// \param index = Frame to read
+///
+Frame FrameSource::frame(int index) const
+{
+    // Walk back to the first frame that is cached or decodes on its own
+    Frame previous;
+    int first = index;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (; first >= 0; first--) {
+            if (first == m_pinnedIndex) {
+                previous = m_pinned;
+                break;
+            }
+            if (const Frame *cached = m_cache.object(first)) {
+                previous = *cached;
+                break;
+            }
+            if (FrameCodec::Encoding(m_entries.at(first).encoding) != FrameCodec::Encoding::Delta) {
+                break;
+            }
+        }
+    }
+    if (first == index && !previous.isNull()) {
+        return previous;
+    }
+    if (!previous.isNull()) {
+        first++;
+    }
+    for (int decoded = first; decoded <= index; decoded++) {
+        previous = decode(decoded, previous);
+        const int tileKilobytes = Frame::TileSize * Frame::TileSize * int(sizeof(QRgb)) / 1024;
+        QMutexLocker locker(&m_mutex);
+        m_cache.insert(decoded, new Frame(previous), qMax(1, previous.allocatedTileCount() * tileKilobytes));
+    }
+    // QCache drops a frame that costs more than its whole limit, so the last one is kept here too
+    QMutexLocker locker(&m_mutex);
+    m_pinnedIndex = index;
+    m_pinned = previous;
+    return previous;
+}
+
+///
+/// \brief Decodes one payload on top of the frame before it.
+///
+Frame FrameSource::decode(int index, const Frame &previous) const
+{
+    const Entry &entry = m_entries.at(index);
+    const auto encoding = FrameCodec::Encoding(entry.encoding);
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    // Raw payloads already hold the pixels, so their tiles read the file in place
+    const quint64 rawSize = quint64(m_spriteSize.width()) * m_spriteSize.height() * sizeof(QRgb);
+    if (encoding == FrameCodec::Encoding::Raw && entry.size == rawSize && entry.offset % sizeof(QRgb) == 0) {
+        return Frame::fromPixels(m_data + entry.offset, m_spriteSize, qsizetype(m_spriteSize.width()) * sizeof(QRgb), m_owner);
+    }
+#endif
+    bool isValid = false;
+    Frame frame = FrameCodec::decode(m_data + entry.offset, qsizetype(entry.size), m_spriteSize, encoding,
+                                     m_palette, previous, &isValid);
+    if (!isValid || frame.isNull()) {
+        qWarning() << "Frame" << index << "is corrupt and was replaced by a transparent frame.";
+        return Frame(m_spriteSize);
+    }
+    return frame;
+}
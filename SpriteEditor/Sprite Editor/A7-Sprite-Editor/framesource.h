@@ -0,0 +1,96 @@
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <QCache>
+#include <QMutex>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include "frame.h"
+
+///
+/// \brief The FrameSource class decodes the frames of a loaded binary project on demand.
+/// It keeps the file contents alive and turns a frame index entry into a Frame the first
+/// time the frame is asked for. Decoded frames are kept in a cache bounded by their tile
+/// memory, so only the frames that are looked at stay decoded. The frame decoded last is
+/// always kept as well, even when it is too large for the cache, so a frame being drawn
+/// or played back is never decoded twice in a row. A delta is rebuilt from the closest
+/// cached frame or keyframe before it. It can be used from several threads;
+/// the cache is locked while it is searched but not while frames are decoded.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class FrameSource
+{
+public:
+    ///
+    /// \brief One entry of a binary project's frame index.
+    ///
+    struct Entry
+    {
+        quint64 offset; ///Position of the payload in the file
+        quint64 size; ///Size of the payload in bytes
+        quint32 encoding; ///FrameCodec encoding of the payload
+    };
+
+    ///
+    /// \brief Where a source was read from, so a later save can tell whether the file
+    /// still holds the same frame index and the payloads can stay where they are.
+    ///
+    struct Origin
+    {
+        QString fileName; ///Absolute path of the project
+        quint64 indexOffset = 0; ///Position of the frame index that was read
+        quint16 indexChecksum = 0; ///Checksum of the index entries that were read
+    };
+
+    static constexpr int CacheLimit = 256 * 1024; ///Largest decoded tile memory kept in the cache, in kilobytes
+
+    ///
+    /// \brief Creates a source over the contents of a binary project. The entries must
+    /// already be checked to lie inside the data, and the first one must not be a delta.
+    /// \param data = First byte of the file
+    /// \param owner = Keeps the data alive while the source or any of its frames uses it
+    /// \param spriteSize = Size of every frame
+    /// \param entries = Frame index in frame order
+    /// \param palette = Colors of the palette encoded frames
+    /// \param origin = File and frame index the entries were read from
+    ///
+    FrameSource(const uchar *data, const std::shared_ptr<const void> &owner, const QSize &spriteSize,
+                const QVector<Entry> &entries, const QVector<QRgb> &palette, const Origin &origin = Origin());
+
+    int frameCount() const; ///Returns the number of frames in the project
+    QSize spriteSize() const; ///Returns the size of every frame
+    const Entry &entry(int index) const; ///Returns the index entry of a frame
+    const QVector<QRgb> &palette() const; ///Returns the colors of the palette encoded frames
+    const Origin &origin() const; ///Returns the file and frame index the source was read from
+
+    ///
+    /// \brief Returns a frame, decoding it and any deltas it depends on if they are not
+    /// cached. A payload that turns out to be corrupt logs a warning and reads as a
+    /// transparent frame.
+    /// \param index = Frame to read
+    ///
+    Frame frame(int index) const;
+
+private:
+    ///
+    /// \brief Decodes one payload on top of the frame before it.
+    ///
+    Frame decode(int index, const Frame &previous) const;
+
+    const uchar *m_data; ///Stores the first byte of the file
+    std::shared_ptr<const void> m_owner; ///Keeps the file contents alive
+    QSize m_spriteSize; ///Stores the size of every frame
+    QVector<Entry> m_entries; ///Stores the frame index
+    QVector<QRgb> m_palette; ///Stores the colors of palette encoded frames
+    Origin m_origin; ///Stores the file and frame index the source was read from
+    mutable QMutex m_mutex; ///Guards the cache
+    mutable QCache<int, Frame> m_cache; ///Stores recently decoded frames, weighted by their tile memory
+    mutable int m_pinnedIndex = -1; ///Stores the index of the frame decoded last, or -1
+    mutable Frame m_pinned; ///Stores the frame decoded last, which the cache may have been too small for
+};
+
+#endif // FRAMESOURCE_H
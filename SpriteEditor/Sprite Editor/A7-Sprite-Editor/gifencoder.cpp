@@ -0,0 +1,369 @@
+#include "gifencoder.h"
+#include <algorithm>
+
+///
+/// \brief Appends a 16 bit little endian number.
+///
+static void appendWord(QByteArray &bytes, int value)
+{
+    bytes.append(char(value & 0xff));
+    bytes.append(char((value >> 8) & 0xff));
+}
+
+///
+/// \brief Compresses palette indices with the variable width LZW used by GIF, split
+/// into the length prefixed sub-blocks that follow an image descriptor.
+/// \param indices = One palette index per pixel
+/// \param minimumCodeSize = Bits per index, at least 2
+///
+static QByteArray compressIndices(const QByteArray &indices, int minimumCodeSize)
+{
+    const int clearCode = 1 << minimumCodeSize;
+    const int endCode = clearCode + 1;
+    const int maximumCodes = 4096;
+    QByteArray blocks;
+    QByteArray block;
+    quint32 bitBuffer = 0;
+    int bitCount = 0;
+    auto emitCode = [&](int code, int codeSize) {
+        bitBuffer |= quint32(code) << bitCount;
+        bitCount += codeSize;
+        while (bitCount >= 8) {
+            block.append(char(bitBuffer & 0xff));
+            bitBuffer >>= 8;
+            bitCount -= 8;
+            if (block.size() == 255) {
+                blocks.append(char(block.size()));
+                blocks.append(block);
+                block.clear();
+            }
+        }
+    };
+
+    // A string is known by the code of its prefix and its last index
+    QHash<quint32, int> codes;
+    int codeSize = minimumCodeSize + 1;
+    int nextCode = endCode + 1;
+    emitCode(clearCode, codeSize);
+    int current = -1;
+    for (char value : indices) {
+        const int index = quint8(value);
+        if (current < 0) {
+            current = index;
+            continue;
+        }
+        const quint32 key = (quint32(current) << 8) | quint32(index);
+        const auto known = codes.constFind(key);
+        if (known != codes.constEnd()) {
+            current = known.value();
+            continue;
+        }
+        emitCode(current, codeSize);
+        if (nextCode < maximumCodes) {
+            if (nextCode == (1 << codeSize)) {
+                codeSize++;
+            }
+            codes.insert(key, nextCode++);
+        } else {
+            // The table is full, so the decoder is told to start over
+            emitCode(clearCode, codeSize);
+            codes.clear();
+            codeSize = minimumCodeSize + 1;
+            nextCode = endCode + 1;
+        }
+        current = index;
+    }
+    if (current >= 0) {
+        emitCode(current, codeSize);
+        // The decoder counts this code as adding an entry, so it may read wider codes next
+        if (nextCode < maximumCodes && nextCode == (1 << codeSize)) {
+            codeSize++;
+        }
+    }
+    emitCode(clearCode, codeSize);
+    emitCode(endCode, minimumCodeSize + 1);
+    if (bitCount > 0) {
+        emitCode(0, 8 - bitCount);
+    }
+    if (!block.isEmpty()) {
+        blocks.append(char(block.size()));
+        blocks.append(block);
+    }
+    blocks.append(char(0));
+    return blocks;
+}
+
+///
+/// \brief Creates an encoder writing to an open device.
+/// \param device = Device to write to
+///
+GifEncoder::GifEncoder(QIODevice &device)
+    : AnimationEncoder(device)
+{
+}
+
+///
+/// \brief Returns the pixels of a frame with every pixel either transparent or opaque.
+///
+QImage GifEncoder::framePixels(const Frame &frame) const
+{
+    QImage image = frame.toImage();
+    for (int y = 0; y < image.height(); y++) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < image.width(); x++) {
+            line[x] = qAlpha(line[x]) < 128 ? 0 : line[x] | 0xff000000;
+        }
+    }
+    return image;
+}
+
+///
+/// \brief Writes the GIF header, the screen size and the loop extension.
+///
+bool GifEncoder::writeHeader()
+{
+    m_shown = QImage(m_size, QImage::Format_ARGB32);
+    m_shown.fill(0);
+    m_elapsedFrames = 0;
+    m_held = QImage();
+    m_heldStart = 0;
+    m_heldEnd = 0;
+
+    QByteArray header("GIF89a");
+    appendWord(header, m_size.width());
+    appendWord(header, m_size.height());
+    // No global color table; every frame brings its own
+    header.append(char(0));
+    header.append(char(0));
+    header.append(char(0));
+    // Loop forever
+    header.append("\x21\xff\x0b" "NETSCAPE2.0" "\x03\x01", 16);
+    appendWord(header, 0);
+    header.append(char(0));
+    return write(header);
+}
+
+///
+/// \brief Holds one frame until the frame after it is known, and writes the frame held
+/// before it. A frame that would be shown for less than MinimumDelay is not written; the
+/// held frame stays on screen for its time instead.
+///
+bool GifEncoder::writeFrame(const QImage &frame, int duration, const QImage &next)
+{
+    Q_UNUSED(next)
+    // GIF delays are in hundredths of a second, so rounding is spread over the animation
+    const qint64 rate = m_framesPerSecond;
+    m_elapsedFrames += duration;
+    const qint64 end = (m_elapsedFrames * 100 + rate / 2) / rate;
+    if (!m_held.isNull() && end - m_heldEnd < MinimumDelay) {
+        m_heldEnd = end;
+        return true;
+    }
+    if (!m_held.isNull() && !encodeFrame(m_held, int(m_heldEnd - m_heldStart), frame)) {
+        return false;
+    }
+    m_held = frame;
+    m_heldStart = m_heldEnd;
+    m_heldEnd = end;
+    return true;
+}
+
+///
+/// \brief Writes one frame as the rectangle that changed, cleared after it is shown if
+/// the frame written after it erases pixels.
+/// \param frame = Pixels to write
+/// \param delay = Time it is shown for, in hundredths of a second
+/// \param next = Pixels of the frame written after it, or a null image for the last frame
+///
+bool GifEncoder::encodeFrame(const QImage &frame, int delay, const QImage &next)
+{
+    QRect area = changedRect(frame, m_shown);
+    int disposal = 1;
+    if (!next.isNull()) {
+        QRect erased;
+        for (int y = 0; y < frame.height(); y++) {
+            const QRgb *line = reinterpret_cast<const QRgb *>(frame.constScanLine(y));
+            const QRgb *nextLine = reinterpret_cast<const QRgb *>(next.constScanLine(y));
+            for (int x = 0; x < frame.width(); x++) {
+                if (line[x] != 0 && nextLine[x] == 0) {
+                    erased |= QRect(x, y, 1, 1);
+                }
+            }
+        }
+        if (!erased.isNull()) {
+            area |= erased;
+            disposal = 2;
+        }
+    }
+    if (area.isNull()) {
+        area = QRect(0, 0, 1, 1);
+    }
+
+    // Pixels the viewer already shows are left transparent
+    QHash<QRgb, int> histogram;
+    for (int y = area.top(); y <= area.bottom(); y++) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(frame.constScanLine(y));
+        const QRgb *shownLine = reinterpret_cast<const QRgb *>(m_shown.constScanLine(y));
+        for (int x = area.left(); x <= area.right(); x++) {
+            if (line[x] != 0 && line[x] != shownLine[x]) {
+                histogram[line[x]]++;
+            }
+        }
+    }
+    QHash<QRgb, int> lookup;
+    const QVector<QRgb> palette = buildPalette(histogram, lookup);
+    const int transparentIndex = palette.size();
+    int bits = 1;
+    while ((1 << bits) < palette.size() + 1) {
+        bits++;
+    }
+    QByteArray indices;
+    indices.reserve(area.width() * area.height());
+    for (int y = area.top(); y <= area.bottom(); y++) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(frame.constScanLine(y));
+        const QRgb *shownLine = reinterpret_cast<const QRgb *>(m_shown.constScanLine(y));
+        for (int x = area.left(); x <= area.right(); x++) {
+            const bool unchanged = line[x] == 0 || line[x] == shownLine[x];
+            indices.append(char(unchanged ? transparentIndex : lookup.value(line[x])));
+        }
+    }
+
+    QByteArray bytes;
+    bytes.append("\x21\xf9\x04", 3);
+    bytes.append(char((disposal << 2) | 1));
+    appendWord(bytes, qBound(MinimumDelay, delay, 65535));
+    bytes.append(char(transparentIndex));
+    bytes.append(char(0));
+    bytes.append(char(0x2c));
+    appendWord(bytes, area.x());
+    appendWord(bytes, area.y());
+    appendWord(bytes, area.width());
+    appendWord(bytes, area.height());
+    bytes.append(char(0x80 | (bits - 1)));
+    for (int index = 0; index < (1 << bits); index++) {
+        const QRgb color = index < palette.size() ? palette.at(index) : 0;
+        bytes.append(char(qRed(color)));
+        bytes.append(char(qGreen(color)));
+        bytes.append(char(qBlue(color)));
+    }
+    const int minimumCodeSize = qMax(2, bits);
+    bytes.append(char(minimumCodeSize));
+    bytes.append(compressIndices(indices, minimumCodeSize));
+    if (!write(bytes)) {
+        return false;
+    }
+
+    m_shown = frame;
+    if (disposal == 2) {
+        for (int y = area.top(); y <= area.bottom(); y++) {
+            QRgb *line = reinterpret_cast<QRgb *>(m_shown.scanLine(y));
+            std::fill(line + area.left(), line + area.right() + 1, QRgb(0));
+        }
+    }
+    return true;
+}
+
+///
+/// \brief Writes the frame still held and the GIF trailer.
+///
+bool GifEncoder::writeTrailer()
+{
+    if (!m_held.isNull() && !encodeFrame(m_held, int(m_heldEnd - m_heldStart), QImage())) {
+        return false;
+    }
+    m_held = QImage();
+    return write(QByteArray(1, char(0x3b)));
+}
+
+///
+/// \brief Picks at most MaximumColors colors for a frame. When the frame has more,
+/// the colors are split into boxes by median cut, weighted by how often they occur,
+/// and each box is replaced by its average color.
+/// \param histogram = Number of pixels of every color
+/// \param lookup = Receives the palette index of every color in the histogram
+///
+QVector<QRgb> GifEncoder::buildPalette(const QHash<QRgb, int> &histogram, QHash<QRgb, int> &lookup)
+{
+    QVector<QRgb> palette;
+    if (histogram.size() <= MaximumColors) {
+        for (auto color = histogram.constBegin(); color != histogram.constEnd(); ++color) {
+            lookup.insert(color.key(), palette.size());
+            palette.append(color.key());
+        }
+        return palette;
+    }
+
+    struct ColorCount {
+        QRgb color;
+        int count;
+    };
+    struct Box {
+        int begin;
+        int end;
+    };
+    QVector<ColorCount> colors;
+    colors.reserve(histogram.size());
+    for (auto color = histogram.constBegin(); color != histogram.constEnd(); ++color) {
+        colors.append(ColorCount{color.key(), color.value()});
+    }
+    QVector<Box> boxes{Box{0, int(colors.size())}};
+    while (boxes.size() < MaximumColors) {
+        // Split the box that spans the widest range of any one channel
+        int widestBox = -1;
+        int widestShift = 0;
+        int widestRange = 0;
+        for (int box = 0; box < boxes.size(); box++) {
+            for (int shift : {16, 8, 0}) {
+                int low = 255;
+                int high = 0;
+                for (int color = boxes.at(box).begin; color < boxes.at(box).end; color++) {
+                    const int channel = (colors.at(color).color >> shift) & 0xff;
+                    low = qMin(low, channel);
+                    high = qMax(high, channel);
+                }
+                if (high - low > widestRange) {
+                    widestBox = box;
+                    widestShift = shift;
+                    widestRange = high - low;
+                }
+            }
+        }
+        if (widestBox < 0) {
+            break;
+        }
+        const Box box = boxes.at(widestBox);
+        std::sort(colors.begin() + box.begin, colors.begin() + box.end, [widestShift](const ColorCount &first, const ColorCount &second) {
+            return ((first.color >> widestShift) & 0xff) < ((second.color >> widestShift) & 0xff);
+        });
+        qint64 total = 0;
+        for (int color = box.begin; color < box.end; color++) {
+            total += colors.at(color).count;
+        }
+        int split = box.begin;
+        qint64 counted = 0;
+        while (split < box.end - 1 && counted + colors.at(split).count <= total / 2) {
+            counted += colors.at(split).count;
+            split++;
+        }
+        split = qMax(split, box.begin + 1);
+        boxes[widestBox] = Box{box.begin, split};
+        boxes.append(Box{split, box.end});
+    }
+
+    for (const Box &box : boxes) {
+        qint64 red = 0;
+        qint64 green = 0;
+        qint64 blue = 0;
+        qint64 weight = 0;
+        for (int color = box.begin; color < box.end; color++) {
+            const ColorCount &entry = colors.at(color);
+            red += qint64(qRed(entry.color)) * entry.count;
+            green += qint64(qGreen(entry.color)) * entry.count;
+            blue += qint64(qBlue(entry.color)) * entry.count;
+            weight += entry.count;
+            lookup.insert(entry.color, palette.size());
+        }
+        palette.append(qRgb(int((red + weight / 2) / weight), int((green + weight / 2) / weight), int((blue + weight / 2) / weight)));
+    }
+    return palette;
+}
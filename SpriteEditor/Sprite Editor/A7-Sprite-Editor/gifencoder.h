@@ -0,0 +1,90 @@
+#ifndef GIFENCODER_H
+#define GIFENCODER_H
+
+#include <QHash>
+#include <QVector>
+#include "animationencoder.h"
+
+///
+/// \brief The GifEncoder class streams frames into a looping animated GIF. Each frame
+/// only stores the rectangle that changed since the frame before it, with unchanged
+/// pixels in that rectangle written as transparent so they compress well, and with a
+/// local color table built from the pixels it stores. Frames with more than 255 colors
+/// are reduced with median cut. Pixels that are less than half opaque are transparent.
+///
+/// A GIF frame can only make a pixel transparent again by clearing its own rectangle
+/// once it has been shown, so the frame before one that erases pixels grows to cover
+/// them and is cleared after it is shown.
+///
+/// Delays are whole hundredths of a second, and most viewers play a delay below
+/// MinimumDelay far slower than asked. A frame whose rounded delay would fall below it is
+/// merged into the frame before it, which stays on screen for both, so the animation
+/// keeps its length but shows fewer frames at rates above 50 frames per second. Each
+/// frame is held until the next one is known, so the frame before one that is merged
+/// is cleared for the frame that actually follows it.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class GifEncoder : public AnimationEncoder
+{
+public:
+    static constexpr int MaximumColors = 255; ///Colors in a frame's table, with one more index for transparency
+    static constexpr int MinimumDelay = 2; ///Shortest frame delay written, in hundredths of a second
+
+    ///
+    /// \brief Creates an encoder writing to an open device.
+    /// \param device = Device to write to
+    ///
+    explicit GifEncoder(QIODevice &device);
+
+protected:
+    ///
+    /// \brief Returns the pixels of a frame with every pixel either transparent or opaque.
+    ///
+    QImage framePixels(const Frame &frame) const override;
+
+    ///
+    /// \brief Writes the GIF header, the screen size and the loop extension.
+    ///
+    bool writeHeader() override;
+
+    ///
+    /// \brief Holds one frame until the frame after it is known, and writes the frame held
+    /// before it. A frame that would be shown for less than MinimumDelay is not written; the
+    /// held frame stays on screen for its time instead.
+    ///
+    bool writeFrame(const QImage &frame, int duration, const QImage &next) override;
+
+    ///
+    /// \brief Writes the frame still held and the GIF trailer.
+    ///
+    bool writeTrailer() override;
+
+private:
+    ///
+    /// \brief Writes one frame as the rectangle that changed, cleared after it is shown if
+    /// the frame written after it erases pixels.
+    /// \param frame = Pixels to write
+    /// \param delay = Time it is shown for, in hundredths of a second
+    /// \param next = Pixels of the frame written after it, or a null image for the last frame
+    ///
+    bool encodeFrame(const QImage &frame, int delay, const QImage &next);
+
+    ///
+    /// \brief Picks at most MaximumColors colors for a frame. When the frame has more,
+    /// the colors are split into boxes by median cut, weighted by how often they occur,
+    /// and each box is replaced by its average color.
+    /// \param histogram = Number of pixels of every color
+    /// \param lookup = Receives the palette index of every color in the histogram
+    ///
+    static QVector<QRgb> buildPalette(const QHash<QRgb, int> &histogram, QHash<QRgb, int> &lookup);
+
+    QImage m_shown; ///Stores what a viewer shows before the next frame is drawn
+    qint64 m_elapsedFrames = 0; ///Stores how many frames were passed in, for the delays
+    QImage m_held; ///Stores the frame waiting for the frame written after it
+    qint64 m_heldStart = 0; ///Stores when the held frame is first shown, in hundredths of a second
+    qint64 m_heldEnd = 0; ///Stores when the held frame stops being shown, in hundredths of a second
+};
+
+#endif // GIFENCODER_H
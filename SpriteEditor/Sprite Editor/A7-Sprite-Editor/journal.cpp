@@ -0,0 +1,423 @@
+#include "journal.h"
+#include <QDebug>
+#include <QSaveFile>
+#include <QtEndian>
+#include "framecodec.h"
+
+///
+/// \brief Appends a little endian number.
+///
+template <typename T>
+static void appendNumber(QByteArray &bytes, T value)
+{
+    uchar buffer[sizeof(T)];
+    qToLittleEndian<T>(value, buffer);
+    bytes.append(reinterpret_cast<const char *>(buffer), sizeof(T));
+}
+
+///
+/// \brief Creates a journal for the given path. Nothing is opened yet.
+/// \param fileName = Path of the journal
+///
+Journal::Journal(const QString &fileName)
+    : m_fileName(fileName), m_file(fileName)
+{
+}
+
+///
+/// \brief Opens the journal left by an earlier session and reads its base. A record
+/// cut short by a crash is dropped. Records are appended to it from then on.
+/// \return If there is a journal with a valid base; errorString() describes the failure otherwise
+///
+bool Journal::open()
+{
+    m_file.close();
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(file.errorString());
+    }
+    const QByteArray contents = file.readAll();
+    file.close();
+    qint64 position = sizeof(Magic);
+    RecordType type;
+    QByteArray payload;
+    if (!contents.startsWith(QByteArray(Magic, sizeof(Magic))) || !readRecord(contents, position, type, payload)
+        || type != RecordType::Base || !readBase(payload, m_base)) {
+        return fail("The journal has no valid base.");
+    }
+    m_recordCount = 0;
+    while (readRecord(contents, position, type, payload)) {
+        m_recordCount++;
+    }
+    m_size = position;
+    m_rewrites++;
+    return reopen();
+}
+
+///
+/// \brief Replaces the journal with an empty one starting from a base.
+/// \param base = State the following records change
+/// \return If the journal was written; errorString() describes the failure otherwise
+///
+bool Journal::start(const Base &base)
+{
+    m_file.close();
+    m_rewrites++;
+    QSaveFile file(m_fileName);
+    const QByteArray contents = QByteArray(Magic, sizeof(Magic)) + baseRecord(base);
+    if (!file.open(QIODevice::WriteOnly) || file.write(contents) != contents.size() || !file.commit()) {
+        return fail(file.errorString());
+    }
+    m_base = base;
+    m_recordCount = 0;
+    m_size = contents.size();
+    return reopen();
+}
+
+///
+/// \brief Rebuilds the frames the journal describes: reads its base and replays every
+/// record on top of it. A record that does not apply to the frames ends the replay,
+/// and it and everything after it are dropped from the journal.
+/// \param spriteSize = Receives the size of every frame
+/// \param frames = Receives the frames
+/// \return If the base could be read; errorString() describes the failure otherwise
+///
+bool Journal::restore(QSize &spriteSize, FrameList &frames)
+{
+    spriteSize = m_base.spriteSize;
+    if (m_base.fileName.isEmpty()) {
+        frames = QVector<Frame>(int(m_base.generation.frameCount), Frame(spriteSize));
+    } else {
+        ProjectFile project(m_base.fileName);
+        if (!project.read(m_base.generation)) {
+            return fail(project.errorString());
+        }
+        if (project.spriteSize() != spriteSize) {
+            return fail("The project no longer has the size the journal was written for.");
+        }
+        frames = project.frames();
+    }
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(file.errorString());
+    }
+    const QByteArray contents = file.read(m_size);
+    file.close();
+    qint64 position = sizeof(Magic);
+    RecordType type;
+    QByteArray payload;
+    readRecord(contents, position, type, payload);
+    int applied = 0;
+    for (qint64 start = position; readRecord(contents, position, type, payload); start = position) {
+        if (!apply(type, payload, spriteSize, frames)) {
+            qWarning() << "Journal record" << applied << "does not fit the frames; the records from it on were dropped.";
+            m_file.resize(start);
+            m_file.seek(start);
+            m_size = start;
+            break;
+        }
+        applied++;
+    }
+    m_recordCount = applied;
+    if (frames.isEmpty()) {
+        return fail("The journal holds no frames.");
+    }
+    return true;
+}
+
+///
+/// \brief Records that a frame was drawn on. Nothing is recorded when the frame did not change.
+/// \param index = Frame that changed
+/// \param before = Frame before the change
+/// \param after = Frame after the change
+///
+void Journal::recordPixels(int index, const Frame &before, const Frame &after)
+{
+    if (!isOpen() || after.isSharedWith(before)) {
+        return;
+    }
+    QByteArray payload;
+    appendNumber<quint32>(payload, quint32(index));
+    payload.append(FrameCodec::encode(after, FrameCodec::Encoding::Delta, FrameCodec::Palette(), before));
+    append(RecordType::Pixels, payload);
+}
+
+///
+/// \brief Records that a frame was added.
+/// \param index = Position of the new frame
+/// \param copyOf = Frame it copies, counted before it was added, or -1 for a blank frame
+///
+void Journal::recordInsert(int index, int copyOf)
+{
+    QByteArray payload;
+    appendNumber<quint32>(payload, quint32(index));
+    appendNumber<qint32>(payload, qint32(copyOf));
+    append(RecordType::InsertFrame, payload);
+}
+
+///
+/// \brief Records that a frame was removed.
+/// \param index = Position of the removed frame
+///
+void Journal::recordRemove(int index)
+{
+    QByteArray payload;
+    appendNumber<quint32>(payload, quint32(index));
+    append(RecordType::RemoveFrame, payload);
+}
+
+///
+/// \brief Compacts the journal to a saved version of the frames: the base becomes the
+/// saved project, followed by the records written after the mark. Nothing happens if
+/// the journal was started or compacted since the mark was taken.
+/// \param mark = Point at which the saved frames were taken
+/// \param base = Saved project
+/// \return If the journal was compacted
+///
+bool Journal::compact(const Mark &mark, const Base &base)
+{
+    if (!isOpen() || mark.rewrites != m_rewrites || mark.position > m_size) {
+        return false;
+    }
+    // Records written while the frames were saved still apply on top of the saved project
+    QByteArray tail;
+    int tailRecords = 0;
+    if (mark.position < m_size) {
+        if (!m_file.seek(mark.position)) {
+            return fail(m_file.errorString());
+        }
+        tail = m_file.read(m_size - mark.position);
+        qint64 position = 0;
+        RecordType type;
+        QByteArray payload;
+        while (readRecord(tail, position, type, payload)) {
+            tailRecords++;
+        }
+        if (position != tail.size()) {
+            m_file.seek(m_size);
+            return fail("The journal could not be read back.");
+        }
+    }
+    // The journal is replaced only once the new one is complete, so a crash keeps the old one
+    m_file.close();
+    QSaveFile file(m_fileName);
+    const QByteArray contents = QByteArray(Magic, sizeof(Magic)) + baseRecord(base) + tail;
+    if (!file.open(QIODevice::WriteOnly) || file.write(contents) != contents.size() || !file.commit()) {
+        fail(file.errorString());
+        reopen();
+        return false;
+    }
+    m_rewrites++;
+    m_base = base;
+    m_recordCount = tailRecords;
+    m_size = contents.size();
+    return reopen();
+}
+
+bool Journal::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+const Journal::Base &Journal::base() const
+{
+    return m_base;
+}
+
+int Journal::recordCount() const
+{
+    return m_recordCount;
+}
+
+qint64 Journal::size() const
+{
+    return m_size;
+}
+
+Journal::Mark Journal::mark() const
+{
+    return Mark{m_rewrites, m_size};
+}
+
+QString Journal::errorString() const
+{
+    return m_errorString;
+}
+
+///
+/// \brief Returns a record with its header.
+///
+QByteArray Journal::record(RecordType type, const QByteArray &payload)
+{
+    QByteArray bytes;
+    bytes.reserve(RecordHeaderSize + payload.size());
+    appendNumber<quint16>(bytes, quint16(type));
+    appendNumber<quint16>(bytes, qChecksum(payload));
+    appendNumber<quint32>(bytes, quint32(payload.size()));
+    bytes.append(payload);
+    return bytes;
+}
+
+///
+/// \brief Returns the record that holds a base.
+///
+QByteArray Journal::baseRecord(const Base &base)
+{
+    QByteArray payload;
+    appendNumber<quint32>(payload, quint32(base.spriteSize.width()));
+    appendNumber<quint32>(payload, quint32(base.spriteSize.height()));
+    appendNumber<quint64>(payload, base.generation.indexOffset);
+    appendNumber<quint32>(payload, base.generation.frameCount);
+    appendNumber<quint32>(payload, base.generation.flags);
+    appendNumber<quint32>(payload, base.generation.indexChecksum);
+    appendNumber<qint64>(payload, base.generation.fileSize);
+    appendNumber<qint64>(payload, base.generation.lastModified);
+    payload.append(base.fileName.toUtf8());
+    return record(RecordType::Base, payload);
+}
+
+///
+/// \brief Reads the base from the payload of a base record.
+///
+bool Journal::readBase(const QByteArray &payload, Base &base)
+{
+    const int fixedSize = 44;
+    if (payload.size() < fixedSize) {
+        return false;
+    }
+    const uchar *bytes = reinterpret_cast<const uchar *>(payload.constData());
+    const quint32 width = qFromLittleEndian<quint32>(bytes);
+    const quint32 height = qFromLittleEndian<quint32>(bytes + 4);
+    if (width < 1 || height < 1 || width > quint32(ProjectFile::MaximumSide) || height > quint32(ProjectFile::MaximumSide)) {
+        return false;
+    }
+    base.spriteSize = QSize(int(width), int(height));
+    base.generation.indexOffset = qFromLittleEndian<quint64>(bytes + 8);
+    base.generation.frameCount = qFromLittleEndian<quint32>(bytes + 16);
+    base.generation.flags = qFromLittleEndian<quint32>(bytes + 20);
+    base.generation.indexChecksum = quint16(qFromLittleEndian<quint32>(bytes + 24));
+    base.generation.fileSize = qFromLittleEndian<qint64>(bytes + 28);
+    base.generation.lastModified = qFromLittleEndian<qint64>(bytes + 36);
+    base.fileName = QString::fromUtf8(payload.mid(fixedSize));
+    return true;
+}
+
+///
+/// \brief Reads the record starting at a position of the journal contents.
+/// \param contents = Whole journal
+/// \param position = Start of the record, moved past it when it is valid
+/// \param type = Receives the record type
+/// \param payload = Receives the record contents
+/// \return If a whole record with a matching checksum is there
+///
+bool Journal::readRecord(const QByteArray &contents, qint64 &position, RecordType &type, QByteArray &payload)
+{
+    if (contents.size() - position < RecordHeaderSize) {
+        return false;
+    }
+    const uchar *header = reinterpret_cast<const uchar *>(contents.constData()) + position;
+    const quint16 checksum = qFromLittleEndian<quint16>(header + 2);
+    const quint32 size = qFromLittleEndian<quint32>(header + 4);
+    if (quint64(size) > quint64(contents.size() - position - RecordHeaderSize)) {
+        return false;
+    }
+    payload = contents.mid(position + RecordHeaderSize, size);
+    if (qChecksum(payload) != checksum) {
+        return false;
+    }
+    type = RecordType(qFromLittleEndian<quint16>(header));
+    position += RecordHeaderSize + size;
+    return true;
+}
+
+///
+/// \brief Applies one record to the frames.
+/// \return If the record fits the frames
+///
+bool Journal::apply(RecordType type, const QByteArray &payload, const QSize &spriteSize, FrameList &frames)
+{
+    const uchar *bytes = reinterpret_cast<const uchar *>(payload.constData());
+    if (payload.size() < 4) {
+        return false;
+    }
+    const quint32 index = qFromLittleEndian<quint32>(bytes);
+    switch (type) {
+    case RecordType::Pixels: {
+        if (index >= quint32(frames.size())) {
+            return false;
+        }
+        bool isValid = false;
+        const Frame frame = FrameCodec::decode(bytes + 4, payload.size() - 4, spriteSize, FrameCodec::Encoding::Delta,
+                                               QVector<QRgb>(), frames.at(int(index)), &isValid);
+        if (!isValid) {
+            return false;
+        }
+        frames[int(index)] = frame;
+        return true;
+    }
+    case RecordType::InsertFrame: {
+        if (payload.size() < 8 || index > quint32(frames.size())) {
+            return false;
+        }
+        const qint32 copyOf = qFromLittleEndian<qint32>(bytes + 4);
+        if (copyOf < -1 || copyOf >= frames.size()) {
+            return false;
+        }
+        frames.insert(int(index), copyOf < 0 ? Frame(spriteSize) : frames.at(copyOf));
+        return true;
+    }
+    case RecordType::RemoveFrame:
+        if (index >= quint32(frames.size())) {
+            return false;
+        }
+        frames.removeAt(int(index));
+        return true;
+    case RecordType::Base:
+        break;
+    }
+    return false;
+}
+
+///
+/// \brief Appends a record and flushes it. Writing stops after the first failure.
+///
+void Journal::append(RecordType type, const QByteArray &payload)
+{
+    if (!isOpen()) {
+        return;
+    }
+    const QByteArray bytes = record(type, payload);
+    if (m_file.write(bytes) != bytes.size() || !m_file.flush()) {
+        qWarning() << "Unable to write the journal:" << m_file.errorString();
+        m_file.close();
+        return;
+    }
+    m_size += bytes.size();
+    m_recordCount++;
+}
+
+///
+/// \brief Opens the file for appending after its valid records.
+///
+bool Journal::reopen()
+{
+    m_file.close();
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        return fail(m_file.errorString());
+    }
+    // A record cut short by a crash is dropped, so new records follow the last whole one
+    if ((m_file.size() != m_size && !m_file.resize(m_size)) || !m_file.seek(m_size)) {
+        m_file.close();
+        return fail(m_file.errorString());
+    }
+    return true;
+}
+
+///
+/// \brief Records an error message and returns false.
+///
+bool Journal::fail(const QString &message)
+{
+    m_errorString = message;
+    return false;
+}
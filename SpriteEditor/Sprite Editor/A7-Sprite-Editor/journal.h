@@ -0,0 +1,192 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <QFile>
+#include <QSize>
+#include <QString>
+#include "frame.h"
+#include "framelist.h"
+#include "projectfile.h"
+
+///
+/// \brief The Journal class records every change made to the frames in an append-only
+/// file as the user works, so the work can be recovered after a crash. The journal starts
+/// from a base: a version of a saved project, or a number of blank frames. It then holds
+/// one record per change:
+///
+/// - Pixels: a frame index and the FrameCodec delta from the frame before the change,
+///   which only covers the tiles the change detached.
+/// - InsertFrame: where a frame was added, and the frame it copies or -1 for a blank one.
+/// - RemoveFrame: which frame was removed.
+///
+/// Every record starts with its type, a CRC-16 checksum and its size, and is flushed as
+/// soon as it is written, so a crash loses at most the record being written. Reading stops
+/// at the first record that is cut short or fails its checksum. Once the frames are saved,
+/// the journal is compacted to the saved project as its base and the records written since
+/// the save started.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class Journal
+{
+public:
+    ///
+    /// \brief The state the records of a journal start from.
+    ///
+    struct Base
+    {
+        QSize spriteSize; ///Size of every frame
+        QString fileName; ///Project the records change, or empty when they start from blank frames
+        ProjectFile::Generation generation; ///Version of the project, or the number of blank frames in its frameCount
+    };
+
+    ///
+    /// \brief A point in the journal, taken when a save starts so the records written
+    /// while it runs are kept when the journal is compacted.
+    ///
+    struct Mark
+    {
+        int rewrites = -1; ///Times the journal had been started or compacted
+        qint64 position = 0; ///Size of the journal
+    };
+
+    static constexpr char Magic[4] = {'S', 'S', 'J', '1'}; ///First four bytes of a journal
+    static constexpr int RecordHeaderSize = 8; ///Size of the type, checksum and size of a record
+    static constexpr qint64 CompactionSize = 16 * 1024 * 1024; ///Journal size at which the frames should be saved to compact it
+
+    ///
+    /// \brief Creates a journal for the given path. Nothing is opened yet.
+    /// \param fileName = Path of the journal
+    ///
+    explicit Journal(const QString &fileName);
+
+    ///
+    /// \brief Opens the journal left by an earlier session and reads its base. A record
+    /// cut short by a crash is dropped. Records are appended to it from then on.
+    /// \return If there is a journal with a valid base; errorString() describes the failure otherwise
+    ///
+    bool open();
+
+    ///
+    /// \brief Replaces the journal with an empty one starting from a base.
+    /// \param base = State the following records change
+    /// \return If the journal was written; errorString() describes the failure otherwise
+    ///
+    bool start(const Base &base);
+
+    ///
+    /// \brief Rebuilds the frames the journal describes: reads its base and replays every
+    /// record on top of it. A record that does not apply to the frames ends the replay,
+    /// and it and everything after it are dropped from the journal.
+    /// \param spriteSize = Receives the size of every frame
+    /// \param frames = Receives the frames
+    /// \return If the base could be read; errorString() describes the failure otherwise
+    ///
+    bool restore(QSize &spriteSize, FrameList &frames);
+
+    ///
+    /// \brief Records that a frame was drawn on. Nothing is recorded when the frame did not change.
+    /// \param index = Frame that changed
+    /// \param before = Frame before the change
+    /// \param after = Frame after the change
+    ///
+    void recordPixels(int index, const Frame &before, const Frame &after);
+
+    ///
+    /// \brief Records that a frame was added.
+    /// \param index = Position of the new frame
+    /// \param copyOf = Frame it copies, counted before it was added, or -1 for a blank frame
+    ///
+    void recordInsert(int index, int copyOf);
+
+    ///
+    /// \brief Records that a frame was removed.
+    /// \param index = Position of the removed frame
+    ///
+    void recordRemove(int index);
+
+    ///
+    /// \brief Compacts the journal to a saved version of the frames: the base becomes the
+    /// saved project, followed by the records written after the mark. Nothing happens if
+    /// the journal was started or compacted since the mark was taken.
+    /// \param mark = Point at which the saved frames were taken
+    /// \param base = Saved project
+    /// \return If the journal was compacted
+    ///
+    bool compact(const Mark &mark, const Base &base);
+
+    bool isOpen() const; ///Returns if records are being written
+    const Base &base() const; ///Returns the state the records start from
+    int recordCount() const; ///Returns the number of records after the base
+    qint64 size() const; ///Returns the size of the journal in bytes
+    Mark mark() const; ///Returns the current end of the journal
+    QString errorString() const; ///Returns a description of the last error
+
+private:
+    ///
+    /// \brief The kinds of journal records.
+    ///
+    enum class RecordType : quint16 {
+        Base = 1, ///Size and project the journal starts from
+        Pixels = 2, ///Delta of a frame that was drawn on
+        InsertFrame = 3, ///Frame that was added
+        RemoveFrame = 4 ///Frame that was removed
+    };
+
+    ///
+    /// \brief Returns a record with its header.
+    ///
+    static QByteArray record(RecordType type, const QByteArray &payload);
+
+    ///
+    /// \brief Returns the record that holds a base.
+    ///
+    static QByteArray baseRecord(const Base &base);
+
+    ///
+    /// \brief Reads the base from the payload of a base record.
+    ///
+    static bool readBase(const QByteArray &payload, Base &base);
+
+    ///
+    /// \brief Reads the record starting at a position of the journal contents.
+    /// \param contents = Whole journal
+    /// \param position = Start of the record, moved past it when it is valid
+    /// \param type = Receives the record type
+    /// \param payload = Receives the record contents
+    /// \return If a whole record with a matching checksum is there
+    ///
+    static bool readRecord(const QByteArray &contents, qint64 &position, RecordType &type, QByteArray &payload);
+
+    ///
+    /// \brief Applies one record to the frames.
+    /// \return If the record fits the frames
+    ///
+    static bool apply(RecordType type, const QByteArray &payload, const QSize &spriteSize, FrameList &frames);
+
+    ///
+    /// \brief Appends a record and flushes it. Writing stops after the first failure.
+    ///
+    void append(RecordType type, const QByteArray &payload);
+
+    ///
+    /// \brief Opens the file for appending after its valid records.
+    ///
+    bool reopen();
+
+    ///
+    /// \brief Records an error message and returns false.
+    ///
+    bool fail(const QString &message);
+
+    QString m_fileName; ///Stores the path of the journal
+    QFile m_file; ///Stores the journal open for appending
+    Base m_base; ///Stores the state the records start from
+    int m_recordCount = 0; ///Stores the number of records after the base
+    qint64 m_size = 0; ///Stores the size of the valid records
+    int m_rewrites = 0; ///Stores the times the journal was started or compacted
+    QString m_errorString; ///Stores the description of the last error
+};
+
+#endif // JOURNAL_H
@@ -0,0 +1,216 @@
+#include "jsontokenizer.h"
+#include <QString>
+
+///
+/// \brief Creates a tokenizer reading from an open device.
+/// \param device = Device positioned at the start of the JSON
+///
+JsonTokenizer::JsonTokenizer(QIODevice &device)
+    : m_device(device), m_buffer(BufferSize, '\0')
+{
+}
+
+///
+/// \brief Reads the next token.
+///
+JsonTokenizer::Token JsonTokenizer::next()
+{
+    for (;;) {
+        int byte = readByte();
+        switch (byte) {
+        case -1:
+            return End;
+        case ' ': case '\t': case '\n': case '\r': case ',': case ':':
+            continue;
+        case '{':
+            return BeginObject;
+        case '}':
+            return EndObject;
+        case '[':
+            return BeginArray;
+        case ']':
+            return EndArray;
+        case '"':
+            return readString();
+        default:
+            return readScalar(byte);
+        }
+    }
+}
+
+///
+/// \brief Skips the value that starts with the next token, including everything nested in it.
+/// \return If a whole value was skipped
+///
+bool JsonTokenizer::skipValue()
+{
+    switch (next()) {
+    case BeginObject:
+    case BeginArray:
+        return skipContainer();
+    case EndObject:
+    case EndArray:
+    case End:
+    case Error:
+        return false;
+    default:
+        return true;
+    }
+}
+
+///
+/// \brief Skips the rest of an object or array whose opening token was just read.
+/// Nested values are matched by their brackets without being turned into tokens.
+/// \return If the closing token was found
+///
+bool JsonTokenizer::skipContainer()
+{
+    int depth = 1;
+    while (depth > 0) {
+        switch (readByte()) {
+        case -1:
+            return false;
+        case '{':
+        case '[':
+            depth++;
+            break;
+        case '}':
+        case ']':
+            depth--;
+            break;
+        case '"':
+            // Brackets inside strings do not count
+            if (readString() != String) {
+                return false;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+const QByteArray &JsonTokenizer::text() const
+{
+    return m_text;
+}
+
+double JsonTokenizer::number() const
+{
+    return m_number;
+}
+
+qint64 JsonTokenizer::position() const
+{
+    return m_consumed + m_bufferPosition;
+}
+
+///
+/// \brief Returns the next byte without consuming it, or -1 at the end of the input.
+///
+int JsonTokenizer::peekByte()
+{
+    if (m_bufferPosition == m_bufferLength) {
+        m_consumed += m_bufferLength;
+        m_bufferPosition = 0;
+        m_bufferLength = qMax<qint64>(0, m_device.read(m_buffer.data(), BufferSize));
+        if (m_bufferLength == 0) {
+            return -1;
+        }
+    }
+    return uchar(m_buffer.at(m_bufferPosition));
+}
+
+///
+/// \brief Consumes and returns the next byte, or -1 at the end of the input.
+///
+int JsonTokenizer::readByte()
+{
+    int byte = peekByte();
+    if (byte != -1) {
+        m_bufferPosition++;
+    }
+    return byte;
+}
+
+///
+/// \brief Reads the rest of a string whose opening quote was consumed.
+///
+JsonTokenizer::Token JsonTokenizer::readString()
+{
+    m_text.clear();
+    for (;;) {
+        int byte = readByte();
+        if (byte == -1) {
+            return Error;
+        }
+        if (byte == '"') {
+            return String;
+        }
+        if (byte != '\\') {
+            m_text.append(char(byte));
+            continue;
+        }
+        byte = readByte();
+        switch (byte) {
+        case '"': case '\\': case '/':
+            m_text.append(char(byte));
+            break;
+        case 'b':
+            m_text.append('\b');
+            break;
+        case 'f':
+            m_text.append('\f');
+            break;
+        case 'n':
+            m_text.append('\n');
+            break;
+        case 'r':
+            m_text.append('\r');
+            break;
+        case 't':
+            m_text.append('\t');
+            break;
+        case 'u': {
+            QByteArray hex;
+            for (int digit = 0; digit < 4; digit++) {
+                hex.append(char(readByte()));
+            }
+            bool isHex = false;
+            char16_t unit = char16_t(hex.toUShort(&isHex, 16));
+            if (!isHex) {
+                return Error;
+            }
+            m_text.append(QString(QChar(unit)).toUtf8());
+            break;
+        }
+        default:
+            return Error;
+        }
+    }
+}
+
+///
+/// \brief Reads a number or literal starting with the given byte.
+///
+JsonTokenizer::Token JsonTokenizer::readScalar(int first)
+{
+    m_text.clear();
+    m_text.append(char(first));
+    for (;;) {
+        int byte = peekByte();
+        bool isScalarByte = (byte >= '0' && byte <= '9') || (byte >= 'a' && byte <= 'z')
+                || byte == '-' || byte == '+' || byte == '.' || byte == 'E';
+        if (!isScalarByte) {
+            break;
+        }
+        m_text.append(char(readByte()));
+    }
+    if (m_text == "true" || m_text == "false" || m_text == "null") {
+        return Literal;
+    }
+    bool isNumber = false;
+    m_number = m_text.toDouble(&isNumber);
+    return isNumber ? Number : Error;
+}
@@ -0,0 +1,94 @@
+#ifndef JSONTOKENIZER_H
+#define JSONTOKENIZER_H
+
+#include <QByteArray>
+#include <QIODevice>
+
+///
+/// \brief The JsonTokenizer class splits JSON read from a device into tokens without
+/// building a document. The device is read through one fixed size buffer, so memory
+/// use does not depend on the size of the input. Commas and colons are treated as
+/// separators; the caller checks the structure it expects.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class JsonTokenizer
+{
+public:
+    ///
+    /// \brief The kinds of token in a JSON text.
+    ///
+    enum Token {
+        BeginObject, ///An opening brace
+        EndObject, ///A closing brace
+        BeginArray, ///An opening bracket
+        EndArray, ///A closing bracket
+        String, ///A string; its decoded UTF-8 bytes are in text()
+        Number, ///A number; its value is in number()
+        Literal, ///true, false or null; its spelling is in text()
+        End, ///The end of the input
+        Error ///Input that is not JSON
+    };
+
+    static constexpr int BufferSize = 64 * 1024; ///Number of bytes read from the device at a time
+
+    ///
+    /// \brief Creates a tokenizer reading from an open device.
+    /// \param device = Device positioned at the start of the JSON
+    ///
+    explicit JsonTokenizer(QIODevice &device);
+
+    ///
+    /// \brief Reads the next token.
+    ///
+    Token next();
+
+    ///
+    /// \brief Skips the value that starts with the next token, including everything nested in it.
+    /// \return If a whole value was skipped
+    ///
+    bool skipValue();
+
+    ///
+    /// \brief Skips the rest of an object or array whose opening token was just read.
+    /// Nested values are matched by their brackets without being turned into tokens.
+    /// \return If the closing token was found
+    ///
+    bool skipContainer();
+
+    const QByteArray &text() const; ///Returns the text of the last string or literal
+    double number() const; ///Returns the value of the last number
+    qint64 position() const; ///Returns the number of bytes consumed so far
+
+private:
+    ///
+    /// \brief Returns the next byte without consuming it, or -1 at the end of the input.
+    ///
+    int peekByte();
+
+    ///
+    /// \brief Consumes and returns the next byte, or -1 at the end of the input.
+    ///
+    int readByte();
+
+    ///
+    /// \brief Reads the rest of a string whose opening quote was consumed.
+    ///
+    Token readString();
+
+    ///
+    /// \brief Reads a number or literal starting with the given byte.
+    ///
+    Token readScalar(int first);
+
+    QIODevice &m_device; ///Device the JSON is read from
+    QByteArray m_buffer; ///Stores the bytes read from the device but not consumed yet
+    int m_bufferPosition = 0; ///Stores the index of the next unconsumed byte in the buffer
+    int m_bufferLength = 0; ///Stores the number of valid bytes in the buffer
+    qint64 m_consumed = 0; ///Stores the number of bytes consumed before the buffer
+    QByteArray m_text; ///Stores the text of the last string or literal
+    double m_number = 0; ///Stores the value of the last number
+};
+
+#endif // JSONTOKENIZER_H
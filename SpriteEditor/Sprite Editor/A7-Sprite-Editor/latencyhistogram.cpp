@@ -0,0 +1,95 @@
+#include "latencyhistogram.h"
+
+///
+/// \brief Adds one latency sample.
+/// \param nanoseconds = Measured latency
+///
+void LatencyHistogram::record(qint64 nanoseconds)
+{
+    qint64 microseconds = nanoseconds / 1000;
+    int bucket = 0;
+    while (bucket < BucketCount - 1 && microseconds >= bucketUpperBound(bucket)) {
+        bucket++;
+    }
+    m_buckets[bucket]++;
+    m_sampleCount++;
+    m_totalNanoseconds += nanoseconds;
+    m_maxNanoseconds = qMax(m_maxNanoseconds, nanoseconds);
+}
+
+///
+/// \brief Removes every sample.
+///
+void LatencyHistogram::reset()
+{
+    m_buckets.fill(0);
+    m_sampleCount = 0;
+    m_totalNanoseconds = 0;
+    m_maxNanoseconds = 0;
+}
+
+///
+/// \brief Returns the number of recorded samples.
+///
+qint64 LatencyHistogram::sampleCount() const
+{
+    return m_sampleCount;
+}
+
+///
+/// \brief Returns the number of samples in a bucket.
+/// \param bucket = Index of the bucket
+///
+qint64 LatencyHistogram::bucketSamples(int bucket) const
+{
+    return m_buckets.at(bucket);
+}
+
+///
+/// \brief Returns the exclusive upper bound of a bucket in microseconds.
+/// \param bucket = Index of the bucket
+///
+qint64 LatencyHistogram::bucketUpperBound(int bucket)
+{
+    return qint64(125) << bucket;
+}
+
+///
+/// \brief Returns a latency in microseconds that no sample up to the given percentile
+/// exceeds: the bound of its bucket, or the largest sample if that is lower. The last
+/// bucket is open ended, so the largest sample is its only bound.
+/// \param percentile = Percentile between 0 and 100
+///
+qint64 LatencyHistogram::percentile(double percentile) const
+{
+    if (m_sampleCount == 0) {
+        return 0;
+    }
+    const qint64 maxMicroseconds = m_maxNanoseconds / 1000;
+    qint64 target = qint64(m_sampleCount * percentile / 100.0);
+    qint64 seen = 0;
+    for (int bucket = 0; bucket < BucketCount - 1; bucket++) {
+        seen += m_buckets[bucket];
+        if (seen > target) {
+            return qMin(bucketUpperBound(bucket), maxMicroseconds);
+        }
+    }
+    return maxMicroseconds;
+}
+
+///
+/// \brief Returns a one line summary with the sample count, mean, percentiles and maximum.
+///
+QString LatencyHistogram::toString() const
+{
+    if (m_sampleCount == 0) {
+        return QString("no samples");
+    }
+    return QString("%1 samples, mean %2 us, p50 <= %3 us, p95 <= %4 us, p99 <= %5 us, max %6 us")
+        .arg(m_sampleCount)
+        .arg(m_totalNanoseconds / m_sampleCount / 1000)
+        .arg(percentile(50))
+        .arg(percentile(95))
+        .arg(percentile(99))
+        .arg(m_maxNanoseconds / 1000);
+}
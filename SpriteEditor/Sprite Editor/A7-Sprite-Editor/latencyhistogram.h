@@ -0,0 +1,68 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QString>
+#include <array>
+
+///
+/// \brief The LatencyHistogram class records latencies into buckets that double in
+/// width, starting at 125 microseconds. It is cheap enough to update for every
+/// input event and is used to tune how input is coalesced.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class LatencyHistogram
+{
+public:
+    static constexpr int BucketCount = 12; ///Number of buckets, the last one is open ended
+
+    ///
+    /// \brief Adds one latency sample.
+    /// \param nanoseconds = Measured latency
+    ///
+    void record(qint64 nanoseconds);
+
+    ///
+    /// \brief Removes every sample.
+    ///
+    void reset();
+
+    ///
+    /// \brief Returns the number of recorded samples.
+    ///
+    qint64 sampleCount() const;
+
+    ///
+    /// \brief Returns the number of samples in a bucket.
+    /// \param bucket = Index of the bucket
+    ///
+    qint64 bucketSamples(int bucket) const;
+
+    ///
+    /// \brief Returns the exclusive upper bound of a bucket in microseconds.
+    /// \param bucket = Index of the bucket
+    ///
+    static qint64 bucketUpperBound(int bucket);
+
+    ///
+    /// \brief Returns a latency in microseconds that no sample up to the given percentile
+/// exceeds: the bound of its bucket, or the largest sample if that is lower. The last
+/// bucket is open ended, so the largest sample is its only bound.
+    /// \param percentile = Percentile between 0 and 100
+    ///
+    qint64 percentile(double percentile) const;
+
+    ///
+    /// \brief Returns a one line summary with the sample count, mean, percentiles and maximum.
+    ///
+    QString toString() const;
+
+private:
+    std::array<qint64, BucketCount> m_buckets{}; ///Stores the number of samples per bucket
+    qint64 m_sampleCount = 0; ///Stores the number of samples
+    qint64 m_totalNanoseconds = 0; ///Stores the sum of every sample
+    qint64 m_maxNanoseconds = 0; ///Stores the largest sample
+};
+
+#endif // LATENCYHISTOGRAM_H
@@ -85,6 +85,7 @@ MainWindow::MainWindow(QWidget *parent)
 
     // Connect fps combo box values
     connect(m_ui->fpsCombo, &QComboBox::currentIndexChanged, m_ui->previewWidget, &Preview::changeFPS);
+    connect(m_ui->previewWidget, &Preview::frameRateChanged, m_ui->canvasWidget, &Canvas::setFrameRate);
 
     // Connections for updating preview
     connect(m_ui->playButton, &QPushButton::clicked, m_ui->previewWidget, &Preview::setPlaybackTrue);
@@ -115,10 +116,15 @@ MainWindow::MainWindow(QWidget *parent)
     //  Connects saving and loading
     connect(m_ui->saveButton, &QPushButton::clicked, m_ui->canvasWidget, &Canvas::on_SaveClicked);
     connect(m_ui->loadButton, &QPushButton::clicked, m_ui->canvasWidget, &Canvas::on_LoadClicked);
+    connect(m_ui->exportAtlasButton, &QPushButton::clicked, m_ui->canvasWidget, &Canvas::on_ExportAtlasClicked);
+    connect(m_ui->exportAnimationButton, &QPushButton::clicked, m_ui->canvasWidget, &Canvas::on_ExportAnimationClicked);
 
     //  Connects changing of the color displayed
     connect(m_ui->colorPickBtn, &QPushButton::clicked, m_ui->canvasWidget, &Canvas::setColor);
     connect(m_ui->canvasWidget, &Canvas::changeColorButton, this, &MainWindow::changeColorButton);
+
+    // Offers to recover the last session once the window is up
+    QTimer::singleShot(0, m_ui->canvasWidget, &Canvas::recoverFromJournal);
 }
 
 
@@ -7,6 +7,7 @@
 #include <QInputDialog>
 #include <QMainWindow>
 #include <QMessageBox>
+#include <QTimer>
 #include <string>
 QT_BEGIN_NAMESPACE
 namespace Ui {
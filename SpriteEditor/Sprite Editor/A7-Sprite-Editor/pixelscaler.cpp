@@ -0,0 +1,97 @@
+#include "pixelscaler.h"
+#include <algorithm>
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PIXELSCALER_SSE2
+#endif
+
+///
+/// \brief Writes a row of pixels, each repeated factor times.
+/// \param source = First source pixel
+/// \param factor = Number of times each pixel is repeated
+/// \param skip = Number of leading output pixels to drop, less than factor
+/// \param target = First output pixel
+/// \param targetCount = Number of output pixels to write
+///
+void PixelScaler::widenRow(const QRgb *source, int factor, int skip, QRgb *target, int targetCount)
+{
+    if (targetCount <= 0) {
+        return;
+    }
+    QRgb *const end = target + targetCount;
+    // The first pixel may be cut by the clip
+    int lead = qMin(factor - skip, targetCount);
+    std::fill(target, target + lead, *source++);
+    target += lead;
+    int fullPixels = int(end - target) / factor;
+    const QRgb *const fullEnd = source + fullPixels;
+#ifdef PIXELSCALER_SSE2
+    if (factor == 2) {
+        // Four source pixels become eight by interleaving them with themselves
+        for (; source + 4 <= fullEnd; source += 4, target += 8) {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(target), _mm_unpacklo_epi32(pixels, pixels));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(target + 4), _mm_unpackhi_epi32(pixels, pixels));
+        }
+    } else if (factor >= 4) {
+        // Every run is covered by four pixel stores; the last one may overlap the one before it
+        for (; source < fullEnd; source++, target += factor) {
+            __m128i pixel = _mm_set1_epi32(int(*source));
+            int x = 0;
+            for (; x + 4 <= factor; x += 4) {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(target + x), pixel);
+            }
+            if (x < factor) {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(target + factor - 4), pixel);
+            }
+        }
+    }
+#endif
+    for (; source < fullEnd; source++, target += factor) {
+        std::fill(target, target + factor, *source);
+    }
+    // The last pixel may be cut by the clip
+    if (target < end) {
+        std::fill(target, end, *source);
+    }
+}
+
+///
+/// \brief Magnifies part of a 32 bit image into another 32 bit image.
+/// \param source = Image to read
+/// \param sourceRect = Pixels of the source to magnify
+/// \param factor = Width and height of each magnified pixel
+/// \param target = Image to write into
+/// \param targetOrigin = Target position of the top left corner of sourceRect
+/// \param clip = Target pixels that may be written
+///
+void PixelScaler::scale(const QImage &source, const QRect &sourceRect, int factor,
+                        QImage &target, const QPoint &targetOrigin, const QRect &clip)
+{
+    QRect targetArea = QRect(targetOrigin, sourceRect.size() * factor) & clip & target.rect();
+    if (targetArea.isEmpty() || factor < 1) {
+        return;
+    }
+    // Offsets of the clipped area inside the magnified rectangle
+    int offsetX = targetArea.left() - targetOrigin.x();
+    int offsetY = targetArea.top() - targetOrigin.y();
+    int sourceX = sourceRect.left() + offsetX / factor;
+    int skip = offsetX % factor;
+    int rowBytes = targetArea.width() * int(sizeof(QRgb));
+    int y = targetArea.top();
+    int sourceY = sourceRect.top() + offsetY / factor;
+    int rowsLeft = factor - offsetY % factor;
+    while (y <= targetArea.bottom()) {
+        const QRgb *sourceLine = reinterpret_cast<const QRgb *>(source.constScanLine(sourceY)) + sourceX;
+        QRgb *firstLine = reinterpret_cast<QRgb *>(target.scanLine(y)) + targetArea.left();
+        widenRow(sourceLine, factor, skip, firstLine, targetArea.width());
+        int lastY = qMin(y + rowsLeft - 1, targetArea.bottom());
+        for (int copyY = y + 1; copyY <= lastY; copyY++) {
+            std::memcpy(reinterpret_cast<QRgb *>(target.scanLine(copyY)) + targetArea.left(), firstLine, rowBytes);
+        }
+        y = lastY + 1;
+        sourceY++;
+        rowsLeft = factor;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef PIXELSCALER_H
+#define PIXELSCALER_H
+
+#include <QImage>
+#include <QRect>
+
+///
+/// \brief The PixelScaler class magnifies pixel art by a whole number with nearest
+/// neighbour sampling, writing straight into an existing 32 bit image. Each source
+/// row is widened once into the first destination row inside the clip, using SSE2
+/// stores where available, and that row is then copied down for the rest of the
+/// pixel's height. Nothing is allocated per call.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class PixelScaler
+{
+public:
+    ///
+    /// \brief Writes a row of pixels, each repeated factor times.
+    /// \param source = First source pixel
+    /// \param factor = Number of times each pixel is repeated
+    /// \param skip = Number of leading output pixels to drop, less than factor
+    /// \param target = First output pixel
+    /// \param targetCount = Number of output pixels to write
+    ///
+    static void widenRow(const QRgb *source, int factor, int skip, QRgb *target, int targetCount);
+
+    ///
+    /// \brief Magnifies part of a 32 bit image into another 32 bit image.
+    /// \param source = Image to read
+    /// \param sourceRect = Pixels of the source to magnify
+    /// \param factor = Width and height of each magnified pixel
+    /// \param target = Image to write into
+    /// \param targetOrigin = Target position of the top left corner of sourceRect
+    /// \param clip = Target pixels that may be written
+    ///
+    static void scale(const QImage &source, const QRect &sourceRect, int factor,
+                      QImage &target, const QPoint &targetOrigin, const QRect &clip);
+};
+
+#endif // PIXELSCALER_H
@@ -17,14 +17,41 @@ void Preview::paintEvent(QPaintEvent *event){
     QPainter painter(this);
     QRect oldRect = event->rect();
     if(m_displayActual){
-            QRect newRect = event->rect();
             QPoint centeredPoint = QPoint(((256 - m_previewImage.width()) / 2),(256 - m_previewImage.height()) / 2);
-            newRect.setTopLeft(centeredPoint);
-            QSize scaledSize = QSize(m_previewImage.width(), m_previewImage.height());
-            painter.drawImage(newRect, m_previewImage.scaled(scaledSize, Qt::KeepAspectRatio, Qt::FastTransformation), oldRect);
+            painter.drawImage(centeredPoint, m_previewImage);
     }
     else{
-        painter.drawImage(oldRect, m_scaledPreview, oldRect);
+        QPoint centeredPoint = QPoint(((256 - m_scaledPreview.width()) / 2),(256 - m_scaledPreview.height()) / 2);
+        painter.drawImage(oldRect, m_scaledPreview, oldRect.translated(-centeredPoint));
+    }
+}
+
+///
+/// \brief Makes the given frame the one being displayed. Only the pixels the preview
+/// can show are copied, so large frames are never converted whole. The preview images
+/// are reused while the frame size stays the same, so playback does not allocate.
+/// \param frame
+///
+void Preview::setPreviewFrame(const Frame &frame){
+    QRect actualArea(QPoint(0, 0), QSize(256, 256));
+    actualArea.moveCenter(frame.rect().center());
+    frame.copyTo(actualArea, m_previewImage);
+    int factor = 256 / qMax(frame.width(), frame.height());
+    if(factor >= 1){
+        // Small frames are magnified by a whole number into the reused preview image
+        QSize scaledSize = frame.size() * factor;
+        if(m_scaledPreview.size() != scaledSize || m_scaledPreview.format() != QImage::Format_ARGB32){
+            m_scaledPreview = QImage(scaledSize, QImage::Format_ARGB32);
+        }
+        PixelScaler::scale(m_previewImage, m_previewImage.rect(), factor, m_scaledPreview, QPoint(0, 0), m_scaledPreview.rect());
+    }
+    else{
+        // Large frames are sampled down into the reused preview image
+        QSize scaledSize = frame.size().scaled(256, 256, Qt::KeepAspectRatio);
+        if(m_scaledPreview.size() != scaledSize || m_scaledPreview.format() != QImage::Format_ARGB32){
+            m_scaledPreview = QImage(scaledSize, QImage::Format_ARGB32);
+        }
+        frame.scaleInto(m_scaledPreview);
     }
 }
 
@@ -33,15 +60,14 @@ void Preview::paintEvent(QPaintEvent *event){
 /// \param newFrames, the updated frames
 /// \param index, which frame is currently displayed on canvas
 ///
-void Preview::updatePreview(QVector<QImage> newFrames, int index){
+void Preview::updatePreview(FrameList newFrames, int index){
     m_previewIndex = index;
     if(m_playback == true){
         m_frames = newFrames;
-        m_previewImage = m_frames.at(m_previewIndex).copy();
-        m_scaledPreview = m_previewImage.copy();
-        m_scale = qMax(m_scaledPreview.width(), m_scaledPreview.height());
-        m_scale = 256 / m_scale;
-        m_scaledPreview = m_scaledPreview.scaled(256, 256, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+        const Frame frame = m_frames.at(m_previewIndex);
+        setPreviewFrame(frame);
+        m_scale = qMax(frame.width(), frame.height());
+        m_scale = qMax(1, 256 / m_scale);
         update();
         swapPreview();
     }
@@ -55,9 +81,7 @@ void Preview::swapPreview(){
     if(m_previewIndex >= m_frames.size()){
         m_previewIndex = 0;
     }
-    m_previewImage = m_frames.at(m_previewIndex).copy();
-    m_scaledPreview = m_previewImage.copy();
-    m_scaledPreview = m_scaledPreview.scaled(256, 256, Qt::KeepAspectRatio, Qt::FastTransformation);
+    setPreviewFrame(m_frames.at(m_previewIndex));
     m_previewIndex++;
     update();
     QTimer::singleShot((1000)/m_frameRate, this, &Preview::swapPreview);
@@ -86,9 +110,11 @@ void Preview::setPlaybackFalse(){
 void Preview::changeFPS(int index){
     if(index == 0){
         m_frameRate = 1;
-        return;
     }
-    m_frameRate = index * 15;
+    else{
+        m_frameRate = index * 15;
+    }
+    emit frameRateChanged(m_frameRate);
 }
 
 ///
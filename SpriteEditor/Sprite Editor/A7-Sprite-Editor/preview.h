@@ -8,6 +8,9 @@
 #include <QPainter>
 #include <QVector>
 #include <QTimer>
+#include "frame.h"
+#include "framelist.h"
+#include "pixelscaler.h"
 
 ///
 /// \brief The preview class
@@ -29,8 +32,16 @@ protected:
     ///
     void paintEvent(QPaintEvent *event) override;
 
+    ///
+    /// \brief Makes the given frame the one being displayed. Only the pixels the preview
+    /// can show are copied, so large frames are never converted whole. The preview images
+    /// are reused while the frame size stays the same, so playback does not allocate.
+    /// \param frame
+    ///
+    void setPreviewFrame(const Frame &frame);
+
 private:
-    QVector<QImage> m_frames; // Vector of QImages to hold sprites
+    FrameList m_frames; // List of frames to hold sprites
     QImage m_previewImage; // Current image being displayed in m_frames
     QImage m_scaledPreview; // Scaled current image displayed in preview window.
     QSize m_spriteSize; // Sprite size of current image.
@@ -44,7 +55,7 @@ public slots:
     /// \brief Paints the preview. The size is either
     /// the larger normal preview or the smaller actual sprite size
     /// \param event
-    void updatePreview(QVector<QImage>, int index);
+    void updatePreview(FrameList, int index);
 
     /// \brief Displays and iterates through the frames
     void swapPreview();
@@ -61,6 +72,11 @@ public slots:
 
     /// \brief Changes display to/from actual size
     void actualSize();
+
+signals:
+    /// \brief Tells listeners the rate the preview plays at, so exports match it
+    /// \param framesPerSecond, new playback rate
+    void frameRateChanged(int framesPerSecond);
 };
 
 #endif // PREVIEW_H
@@ -0,0 +1,758 @@
+#include "projectfile.h"
+#include <QBuffer>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <QtEndian>
+#include <atomic>
+#include <cstring>
+#include <numeric>
+
+///
+/// \brief Rounds an offset up to the next payload boundary.
+///
+static quint64 alignPayload(quint64 offset)
+{
+    return (offset + ProjectFile::PayloadAlignment - 1) / ProjectFile::PayloadAlignment * ProjectFile::PayloadAlignment;
+}
+
+///
+/// \brief Creates a project file for the given path. Nothing is opened yet.
+/// \param fileName = Path of the .ssp file
+///
+ProjectFile::ProjectFile(const QString &fileName)
+    : m_fileName(fileName)
+{
+}
+
+///
+/// \brief Reads the project, detecting binary and legacy JSON files by their first bytes.
+/// \param progress = Told how many frames were decoded, and asked whether to go on
+/// \return If the project was read; errorString() describes the failure otherwise
+///
+bool ProjectFile::read(const ProgressHandler &progress)
+{
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(file.errorString());
+    }
+    if (file.peek(sizeof(Magic)) == QByteArray(Magic, sizeof(Magic))) {
+        file.close();
+        return readBinary();
+    }
+    if (!readLegacyJson(file, progress)) {
+        return false;
+    }
+    const QFileInfo info(m_fileName);
+    m_generation = Generation();
+    m_generation.fileSize = info.size();
+    m_generation.lastModified = info.lastModified().toMSecsSinceEpoch();
+    return true;
+}
+
+///
+/// \brief Reads an earlier version of the project. A binary project must still hold
+/// the frame index of that version; a legacy JSON project must not have changed.
+/// \param generation = Version returned by generation() when it was read or written
+/// \return If that version was read; errorString() describes the failure otherwise
+///
+bool ProjectFile::read(const Generation &generation)
+{
+    if (generation.indexOffset > 0) {
+        return readBinary(&generation);
+    }
+    const QFileInfo info(m_fileName);
+    if (info.size() != generation.fileSize || info.lastModified().toMSecsSinceEpoch() != generation.lastModified) {
+        return fail("The project was changed by something else.");
+    }
+    return read();
+}
+
+///
+/// \brief Writes a project, replacing the file only once everything was written.
+/// Binary frames read from this same file are appended to it instead.
+/// \param spriteSize = Size of every frame
+/// \param frames = Frames to write
+/// \param format = Layout to write
+/// \param encoding = Encoding of every frame payload in a binary project. Asking for
+/// a palette encoding picks the 4 or 8 bit form from the number of colors, and falls
+/// back to run-length coding when the frames use more than 256 colors. Asking for
+/// deltas stores every KeyframeInterval-th frame run-length coded as a keyframe.
+/// \return If the project was written; errorString() describes the failure otherwise
+///
+bool ProjectFile::write(const QSize &spriteSize, const FrameList &frames, Format format,
+                        FrameCodec::Encoding encoding)
+{
+    m_generation = Generation();
+    if (format == Format::Binary) {
+        QFile existing(m_fileName);
+        if (canAppend(existing, spriteSize, frames)) {
+            return appendBinary(existing, spriteSize, frames, encoding);
+        }
+    }
+    // Frames loaded from this file may still be reading it through a mapping, so the new
+    // contents go to a temporary file that replaces the old one when it is complete. On
+    // Windows binary projects are never left open, so the rename can replace the file
+    QSaveFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return fail(file.errorString());
+    }
+    bool written = format == Format::Binary ? writeBinary(file, spriteSize, frames, encoding)
+                                            : writeLegacyJson(file, spriteSize, frames);
+    if (!written) {
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit()) {
+        return fail(file.errorString());
+    }
+    const QFileInfo info(m_fileName);
+    m_generation.fileSize = info.size();
+    m_generation.lastModified = info.lastModified().toMSecsSinceEpoch();
+    return true;
+}
+
+QSize ProjectFile::spriteSize() const
+{
+    return m_spriteSize;
+}
+
+const FrameList &ProjectFile::frames() const
+{
+    return m_frames;
+}
+
+ProjectFile::Generation ProjectFile::generation() const
+{
+    return m_generation;
+}
+
+QString ProjectFile::errorString() const
+{
+    return m_errorString;
+}
+
+///
+/// \brief Reads a binary project's header, index and palette, mapping the file, or on
+/// Windows reading it into memory, so the frames can be decoded from it later. Payloads
+/// are only checked to lie inside the file; a corrupt payload is noticed when its frame
+/// is first read.
+/// \param generation = Earlier version to read, or null for the one the header points at
+///
+bool ProjectFile::readBinary(const Generation *generation)
+{
+    auto file = std::make_shared<QFile>(m_fileName);
+    if (!file->open(QIODevice::ReadOnly)) {
+        return fail(file->errorString());
+    }
+    const quint64 fileSize = quint64(file->size());
+    if (fileSize < quint64(HeaderSize)) {
+        return fail("The project header is truncated.");
+    }
+    // The frames keep the file, and with it the mapping, alive for as long as they use it
+    std::shared_ptr<const void> owner = file;
+#ifdef Q_OS_WIN
+    // Windows refuses to replace or shrink a file that is open or mapped, and projects
+    // are saved over the file their frames came from, so the file is read whole and
+    // closed again instead
+    const uchar *data = nullptr;
+#else
+    const uchar *data = file->map(0, file->size());
+#endif
+    if (!data) {
+        auto contents = std::make_shared<QByteArray>(file->readAll());
+        if (quint64(contents->size()) != fileSize) {
+            return fail(file->errorString());
+        }
+        data = reinterpret_cast<const uchar *>(contents->constData());
+        owner = contents;
+    }
+    const quint32 version = qFromLittleEndian<quint32>(data + 4);
+    const quint32 width = qFromLittleEndian<quint32>(data + 8);
+    const quint32 height = qFromLittleEndian<quint32>(data + 12);
+    // An earlier version keeps its own index; only the header moved on to a newer one
+    const quint32 frameCount = generation ? generation->frameCount : qFromLittleEndian<quint32>(data + 16);
+    const quint32 flags = generation ? generation->flags : qFromLittleEndian<quint32>(data + 20);
+    const quint64 indexOffset = generation ? generation->indexOffset : qFromLittleEndian<quint64>(data + 24);
+    if (version != Version) {
+        return fail(QString("Unsupported project version %1.").arg(version));
+    }
+    if (width < 1 || height < 1 || width > quint32(MaximumSide) || height > quint32(MaximumSide) || frameCount < 1) {
+        return fail("The project header is invalid.");
+    }
+    if (indexOffset > fileSize || quint64(frameCount) * IndexEntrySize > fileSize - indexOffset) {
+        return fail("The frame index is truncated.");
+    }
+    const quint16 indexChecksum = qChecksum(QByteArrayView(data + indexOffset, qsizetype(frameCount) * IndexEntrySize));
+    if (generation && indexChecksum != generation->indexChecksum) {
+        return fail("The project no longer holds that version of its frames.");
+    }
+    const QSize size(int(width), int(height));
+    QVector<FrameSource::Entry> entries(int(frameCount));
+    for (int index = 0; index < entries.size(); index++) {
+        const uchar *entry = data + indexOffset + quint64(index) * IndexEntrySize;
+        FrameSource::Entry &parsed = entries[index];
+        parsed.offset = qFromLittleEndian<quint64>(entry);
+        parsed.size = qFromLittleEndian<quint64>(entry + 8);
+        parsed.encoding = qFromLittleEndian<quint32>(entry + 16);
+        if (parsed.offset > fileSize || parsed.size > fileSize - parsed.offset) {
+            return fail(QString("Frame %1 is truncated.").arg(index));
+        }
+        if (!FrameCodec::isKnownEncoding(parsed.encoding)) {
+            return fail(QString("Frame %1 has an unsupported encoding.").arg(index));
+        }
+    }
+    QVector<QRgb> palette;
+    if (flags & HasPalette) {
+        const quint64 paletteOffset = indexOffset + quint64(frameCount) * IndexEntrySize;
+        const quint32 colorCount = fileSize - paletteOffset >= 4 ? qFromLittleEndian<quint32>(data + paletteOffset) : 0;
+        if (colorCount < 1 || colorCount > quint32(FrameCodec::MaximumPaletteSize)
+            || quint64(colorCount) * sizeof(QRgb) > fileSize - paletteOffset - 4) {
+            return fail("The palette is invalid.");
+        }
+        palette.resize(int(colorCount));
+        qFromLittleEndian<quint32>(data + paletteOffset + 4, colorCount, palette.data());
+    }
+    if (FrameCodec::Encoding(entries.first().encoding) == FrameCodec::Encoding::Delta) {
+        return fail("Frame 0 is a delta with no frame before it.");
+    }
+    m_spriteSize = size;
+    const FrameSource::Origin origin{QFileInfo(m_fileName).absoluteFilePath(), indexOffset, indexChecksum};
+    m_frames = FrameList(std::make_shared<const FrameSource>(data, owner, size, entries, palette, origin));
+    m_generation = Generation{indexOffset, frameCount, flags, indexChecksum, file->size(),
+                              QFileInfo(m_fileName).lastModified().toMSecsSinceEpoch()};
+    return true;
+}
+
+///
+/// \brief Reads a legacy JSON project. The file is mapped and its top level read once,
+/// skipping each frame by its brackets to find where it is, so the size is known
+/// wherever its keys are. The frames are then decoded in parallel, each one written
+/// row by row straight into its tiles. The width is taken from the first frame when
+/// the file does not list it, so that frame is decoded before the others.
+/// \param file = Open file positioned at the start of the JSON
+/// \param progress = Told how many frames were decoded, and asked whether to go on
+///
+bool ProjectFile::readLegacyJson(QFile &file, const ProgressHandler &progress)
+{
+    QByteArray contents;
+    if (const uchar *data = file.map(0, file.size())) {
+        contents = QByteArray::fromRawData(reinterpret_cast<const char *>(data), file.size());
+    } else {
+        contents = file.readAll();
+    }
+    QBuffer buffer(&contents);
+    buffer.open(QIODevice::ReadOnly);
+    JsonTokenizer json(buffer);
+    if (json.next() != JsonTokenizer::BeginObject) {
+        return failAt(json);
+    }
+    int width = 0;
+    int height = 0;
+    QVector<FrameRange> ranges;
+    JsonTokenizer::Token token;
+    while ((token = json.next()) == JsonTokenizer::String) {
+        const QByteArray key = json.text();
+        if (key == "width" || key == "height") {
+            if (json.next() != JsonTokenizer::Number) {
+                return failAt(json);
+            }
+            (key == "width" ? width : height) = int(qBound(0.0, json.number(), double(MaximumSide + 1)));
+        } else if (key == "m_frames") {
+            if (!readLegacyFrameRanges(json, ranges)) {
+                return false;
+            }
+        } else if (!json.skipValue()) {
+            return failAt(json);
+        }
+    }
+    if (token != JsonTokenizer::EndObject) {
+        return failAt(json);
+    }
+    if (width > MaximumSide || height < 1 || height > MaximumSide) {
+        return fail("The project size is invalid.");
+    }
+    if (ranges.isEmpty()) {
+        return fail("The project has no frames.");
+    }
+    const int total = ranges.size();
+    std::atomic<int> decoded(0);
+    std::atomic<bool> isCanceled(progress && !progress(0, total));
+    auto report = [&]() {
+        const int count = ++decoded;
+        if (progress && !progress(count, total)) {
+            isCanceled = true;
+        }
+    };
+    QVector<Frame> frames(total);
+    QVector<QString> errors(total);
+    int first = 0;
+    if (width == 0 && !isCanceled) {
+        errors[0] = readLegacyFrame(contents, ranges.first(), width, height, 0, frames[0]);
+        if (!errors.first().isEmpty()) {
+            return fail(errors.first());
+        }
+        if (width < 1 || width > MaximumSide) {
+            return fail("The project size is invalid.");
+        }
+        report();
+        first = 1;
+    }
+    // Each frame only writes its own slot, so the vectors are not touched while the frames decode
+    Frame *decodedFrames = frames.data();
+    QString *frameErrors = errors.data();
+    QVector<int> indices(total - first);
+    std::iota(indices.begin(), indices.end(), first);
+    QtConcurrent::blockingMap(indices, [&](int index) {
+        if (isCanceled) {
+            return;
+        }
+        int frameWidth = width;
+        frameErrors[index] = readLegacyFrame(contents, ranges.at(index), frameWidth, height, index, decodedFrames[index]);
+        report();
+    });
+    if (isCanceled) {
+        return fail("Loading was canceled.");
+    }
+    for (const QString &error : errors) {
+        if (!error.isEmpty()) {
+            return fail(error);
+        }
+    }
+    m_spriteSize = QSize(width, height);
+    m_frames = frames;
+    return true;
+}
+
+///
+/// \brief Finds the bytes of every frame in the legacy m_frames array.
+/// \param json = Tokenizer positioned before the array
+/// \param ranges = Receives one range per frame, in order
+///
+bool ProjectFile::readLegacyFrameRanges(JsonTokenizer &json, QVector<FrameRange> &ranges)
+{
+    if (json.next() != JsonTokenizer::BeginArray) {
+        return failAt(json);
+    }
+    ranges.clear();
+    for (;;) {
+        const qint64 start = json.position();
+        JsonTokenizer::Token token = json.next();
+        if (token == JsonTokenizer::EndArray) {
+            return true;
+        }
+        if (token != JsonTokenizer::BeginArray || !json.skipContainer()) {
+            return failAt(json);
+        }
+        ranges.append({start, json.position()});
+    }
+}
+
+///
+/// \brief Decodes one frame of a legacy JSON project. Rows shorter than the sprite end
+/// in transparent pixels, as do frames with fewer rows. It only touches its arguments,
+/// so frames can be decoded on several threads at once.
+/// \param contents = Whole JSON text
+/// \param range = Bytes of the frame
+/// \param width = Sprite width, or 0 to take it from the first row
+/// \param height = Sprite height
+/// \param frameIndex = Position of the frame, for error messages
+/// \param frame = Receives the decoded frame
+/// \return An empty string, or a description of what is wrong with the frame
+///
+QString ProjectFile::readLegacyFrame(const QByteArray &contents, const FrameRange &range, int &width, int height,
+                                     int frameIndex, Frame &frame)
+{
+    QByteArray bytes = QByteArray::fromRawData(contents.constData() + range.start, range.end - range.start);
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+    JsonTokenizer json(buffer);
+    auto invalid = [&json, &range]() {
+        return QString("The project is not valid JSON near byte %1.").arg(range.start + json.position());
+    };
+    if (json.next() != JsonTokenizer::BeginArray) {
+        return invalid();
+    }
+    QVector<QRgb> row;
+    int rowIndex = 0;
+    JsonTokenizer::Token token;
+    while ((token = json.next()) == JsonTokenizer::BeginArray) {
+        row.clear();
+        while ((token = json.next()) == JsonTokenizer::BeginObject) {
+            int red = 0;
+            int green = 0;
+            int blue = 0;
+            int alpha = 255;
+            while ((token = json.next()) == JsonTokenizer::String) {
+                const QByteArray channel = json.text();
+                if (json.next() != JsonTokenizer::Number) {
+                    return invalid();
+                }
+                int value = int(qBound(0.0, json.number(), 255.0));
+                if (channel == "r") {
+                    red = value;
+                } else if (channel == "g") {
+                    green = value;
+                } else if (channel == "b") {
+                    blue = value;
+                } else if (channel == "a") {
+                    alpha = value;
+                }
+            }
+            if (token != JsonTokenizer::EndObject) {
+                return invalid();
+            }
+            row.append(qRgba(red, green, blue, alpha));
+            if (width > 0 && row.size() > width) {
+                return QString("Row %1 of frame %2 is wider than the sprite.").arg(rowIndex).arg(frameIndex);
+            }
+        }
+        if (token != JsonTokenizer::EndArray) {
+            return invalid();
+        }
+        if (width == 0) {
+            width = row.size();
+            if (width < 1 || width > MaximumSide) {
+                return "The project size is invalid.";
+            }
+        }
+        if (rowIndex >= height) {
+            return QString("Frame %1 has too many rows.").arg(frameIndex);
+        }
+        // Short rows end in transparent pixels
+        row.resize(width);
+        if (frame.isNull()) {
+            frame = Frame(QSize(width, height));
+        }
+        frame.setLine(rowIndex, row.constData());
+        rowIndex++;
+    }
+    if (token != JsonTokenizer::EndArray) {
+        return invalid();
+    }
+    if (frame.isNull() && width > 0) {
+        frame = Frame(QSize(width, height));
+    }
+    return QString();
+}
+
+///
+/// \brief Writes a binary project. Frames are encoded in parallel batches and their
+/// payloads written in frame order. The index, and the palette when one is used, are
+/// written after the payloads, once their sizes are known, and the header is then
+/// updated to point at them.
+/// \param device = Open random access device to write to
+///
+bool ProjectFile::writeBinary(QIODevice &device, const QSize &spriteSize, const FrameList &frames,
+                              FrameCodec::Encoding encoding)
+{
+    FrameCodec::Palette palette;
+    if (FrameCodec::isPaletteEncoding(encoding)) {
+        if (!FrameCodec::buildPalette(frames, palette)) {
+            encoding = FrameCodec::Encoding::RunLength;
+        } else {
+            encoding = palette.colors.size() <= 16 ? FrameCodec::Encoding::Palette4 : FrameCodec::Encoding::Palette8;
+        }
+    }
+    // The header is filled in once the index is written
+    if (device.write(QByteArray(HeaderSize, '\0')) != HeaderSize) {
+        return fail(device.errorString());
+    }
+    quint64 position = HeaderSize;
+    auto frameEncoding = [encoding](int frameIndex) {
+        if (encoding == FrameCodec::Encoding::Delta && frameIndex % KeyframeInterval == 0) {
+            return FrameCodec::Encoding::RunLength;
+        }
+        return encoding;
+    };
+    QVector<int> frameIndices(frames.size());
+    std::iota(frameIndices.begin(), frameIndices.end(), 0);
+    QVector<FrameSource::Entry> entries(frames.size());
+    if (!writePayloads(device, position, frames, frameIndices, frameEncoding, palette, entries)) {
+        return false;
+    }
+    return writeIndex(device, position, spriteSize, entries, palette.colors);
+}
+
+///
+/// \brief Returns if a binary save can append to the file: the frames must come from
+/// the index the header still points at, and at least half the file must stay in use.
+/// \param file = Project file, opened for reading and writing when true is returned
+///
+bool ProjectFile::canAppend(QFile &file, const QSize &spriteSize, const FrameList &frames)
+{
+    const std::shared_ptr<const FrameSource> source = frames.source();
+    if (!source || source->spriteSize() != spriteSize
+        || source->origin().fileName != QFileInfo(m_fileName).absoluteFilePath()) {
+        return false;
+    }
+    if (!file.open(QIODevice::ReadWrite | QIODevice::ExistingOnly)) {
+        return false;
+    }
+    // Anything else that wrote the file since it was read moved or changed the index
+    const QByteArray header = file.read(HeaderSize);
+    const uchar *bytes = reinterpret_cast<const uchar *>(header.constData());
+    const quint64 indexSize = quint64(source->frameCount()) * IndexEntrySize;
+    bool isCurrent = header.size() == HeaderSize && header.startsWith(QByteArray(Magic, sizeof(Magic)))
+                     && qFromLittleEndian<quint32>(bytes + 4) == Version
+                     && qFromLittleEndian<quint32>(bytes + 16) == quint32(source->frameCount())
+                     && qFromLittleEndian<quint64>(bytes + 24) == source->origin().indexOffset;
+    if (isCurrent && file.seek(qint64(source->origin().indexOffset))) {
+        const QByteArray index = file.read(qint64(indexSize));
+        isCurrent = quint64(index.size()) == indexSize && qChecksum(index) == source->origin().indexChecksum;
+    }
+    quint64 usedSize = 0;
+    for (int index = 0; isCurrent && index < frames.size(); index++) {
+        if (frames.sourceIndex(index) >= 0) {
+            usedSize += source->entry(frames.sourceIndex(index)).size;
+        }
+    }
+    if (!isCurrent || quint64(file.size()) - usedSize > usedSize) {
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+///
+/// \brief Appends the frames that changed since the file was read, and a new index
+/// listing them along with the payloads that are still in use. Unchanged deltas are
+/// kept only while the frame before them is too. Changed frames are run-length coded
+/// when a palette is asked for, as they may hold colors the stored palette lacks.
+/// The file is cut back to its old size if anything fails.
+/// \param file = Project file opened by canAppend()
+///
+bool ProjectFile::appendBinary(QFile &file, const QSize &spriteSize, const FrameList &frames,
+                               FrameCodec::Encoding encoding)
+{
+    const std::shared_ptr<const FrameSource> source = frames.source();
+    QVector<FrameSource::Entry> entries(frames.size());
+    QVector<int> changed;
+    bool usesPalette = false;
+    for (int index = 0; index < frames.size(); index++) {
+        const int sourceIndex = frames.sourceIndex(index);
+        if (sourceIndex >= 0) {
+            const FrameSource::Entry &entry = source->entry(sourceIndex);
+            const bool isDelta = FrameCodec::Encoding(entry.encoding) == FrameCodec::Encoding::Delta;
+            if (!isDelta || (index > 0 && frames.sourceIndex(index - 1) == sourceIndex - 1)) {
+                entries[index] = entry;
+                usesPalette = usesPalette || FrameCodec::isPaletteEncoding(FrameCodec::Encoding(entry.encoding));
+                continue;
+            }
+        }
+        changed.append(index);
+    }
+    if (FrameCodec::isPaletteEncoding(encoding)) {
+        encoding = FrameCodec::Encoding::RunLength;
+    }
+    auto frameEncoding = [encoding](int frameIndex) {
+        if (encoding == FrameCodec::Encoding::Delta && frameIndex % KeyframeInterval == 0) {
+            return FrameCodec::Encoding::RunLength;
+        }
+        return encoding;
+    };
+    const qint64 oldSize = file.size();
+    quint64 position = quint64(oldSize);
+    bool isWritten = file.seek(oldSize);
+    if (!isWritten) {
+        fail(file.errorString());
+    } else {
+        isWritten = writePayloads(file, position, frames, changed, frameEncoding, FrameCodec::Palette(), entries)
+                    && writeIndex(file, position, spriteSize, entries, usesPalette ? source->palette() : QVector<QRgb>());
+    }
+    if (!isWritten) {
+        // The header still points at the old index, so cutting the file back restores it
+        file.resize(oldSize);
+        return false;
+    }
+    file.close();
+    const QFileInfo info(m_fileName);
+    m_generation.fileSize = info.size();
+    m_generation.lastModified = info.lastModified().toMSecsSinceEpoch();
+    return true;
+}
+
+///
+/// \brief Encodes frames in parallel batches and writes their payloads in order,
+/// each on a payload boundary.
+/// \param device = Open device positioned at the end of what was written so far
+/// \param position = Position of the device, moved past the last payload
+/// \param frames = Frames of the project
+/// \param frameIndices = Frames to write, in increasing order
+/// \param frameEncoding = Returns the encoding of a frame
+/// \param palette = Palette of the palette encoded frames
+/// \param entries = Receives the index entry of every written frame
+///
+bool ProjectFile::writePayloads(QIODevice &device, quint64 &position, const FrameList &frames, const QVector<int> &frameIndices,
+                                const std::function<FrameCodec::Encoding(int)> &frameEncoding,
+                                const FrameCodec::Palette &palette, QVector<FrameSource::Entry> &entries)
+{
+    // Frames are encoded in parallel a batch at a time, so only one batch of payloads is
+    // held in memory, and the payloads are then written in frame order
+    const int batchSize = qMax(1, QThreadPool::globalInstance()->maxThreadCount()) * 4;
+    for (int batchStart = 0; batchStart < frameIndices.size(); batchStart += batchSize) {
+        const QVector<int> batch = frameIndices.mid(batchStart, batchSize);
+        const QVector<QByteArray> payloads = QtConcurrent::blockingMapped<QVector<QByteArray>>(batch, [&](int frameIndex) {
+            const FrameCodec::Encoding payloadEncoding = frameEncoding(frameIndex);
+            const Frame previous = payloadEncoding == FrameCodec::Encoding::Delta ? frames.at(frameIndex - 1) : Frame();
+            return FrameCodec::encode(frames.at(frameIndex), payloadEncoding, palette, previous);
+        });
+        for (int batchIndex = 0; batchIndex < payloads.size(); batchIndex++) {
+            const QByteArray &payload = payloads.at(batchIndex);
+            const quint64 offset = alignPayload(position);
+            QByteArray padding(int(offset - position), '\0');
+            if (device.write(padding) != padding.size() || device.write(payload) != payload.size()) {
+                return fail(device.errorString());
+            }
+            const int frameIndex = batch.at(batchIndex);
+            entries[frameIndex] = FrameSource::Entry{offset, quint64(payload.size()), quint32(frameEncoding(frameIndex))};
+            position = offset + payload.size();
+        }
+    }
+    return true;
+}
+
+///
+/// \brief Writes the frame index and the palette, if there is one, then points the
+/// header at them and remembers the new generation.
+/// \param device = Open random access device positioned at the end of the payloads
+/// \param position = Position of the device
+///
+bool ProjectFile::writeIndex(QIODevice &device, quint64 position, const QSize &spriteSize,
+                             const QVector<FrameSource::Entry> &entries, const QVector<QRgb> &palette)
+{
+    QByteArray index(entries.size() * IndexEntrySize, '\0');
+    for (int frameIndex = 0; frameIndex < entries.size(); frameIndex++) {
+        uchar *entry = reinterpret_cast<uchar *>(index.data()) + frameIndex * IndexEntrySize;
+        qToLittleEndian<quint64>(entries.at(frameIndex).offset, entry);
+        qToLittleEndian<quint64>(entries.at(frameIndex).size, entry + 8);
+        qToLittleEndian<quint32>(entries.at(frameIndex).encoding, entry + 16);
+    }
+    const quint16 indexChecksum = qChecksum(index);
+    if (!palette.isEmpty()) {
+        index.resize(index.size() + 4 + palette.size() * int(sizeof(QRgb)));
+        uchar *paletteBytes = reinterpret_cast<uchar *>(index.data()) + entries.size() * IndexEntrySize;
+        qToLittleEndian<quint32>(palette.size(), paletteBytes);
+        qToLittleEndian<quint32>(palette.constData(), palette.size(), paletteBytes + 4);
+    }
+    if (device.write(index) != index.size()) {
+        return fail(device.errorString());
+    }
+    // The index must be on disk before the header points at it
+    auto *file = qobject_cast<QFileDevice *>(&device);
+    if (file && !file->flush()) {
+        return fail(file->errorString());
+    }
+    const quint32 flags = palette.isEmpty() ? 0 : HasPalette;
+    QByteArray header(HeaderSize, '\0');
+    uchar *bytes = reinterpret_cast<uchar *>(header.data());
+    std::memcpy(bytes, Magic, sizeof(Magic));
+    qToLittleEndian<quint32>(Version, bytes + 4);
+    qToLittleEndian<quint32>(spriteSize.width(), bytes + 8);
+    qToLittleEndian<quint32>(spriteSize.height(), bytes + 12);
+    qToLittleEndian<quint32>(entries.size(), bytes + 16);
+    qToLittleEndian<quint32>(flags, bytes + 20);
+    qToLittleEndian<quint64>(position, bytes + 24);
+    if (!device.seek(0) || device.write(header) != header.size() || (file && !file->flush())) {
+        return fail(device.errorString());
+    }
+    m_generation.indexOffset = position;
+    m_generation.frameCount = quint32(entries.size());
+    m_generation.flags = flags;
+    m_generation.indexChecksum = indexChecksum;
+    return true;
+}
+
+///
+/// \brief Appends a number from 0 to 255 in decimal.
+///
+static void appendChannel(QByteArray &json, int value)
+{
+    if (value >= 100) {
+        json.append(char('0' + value / 100));
+    }
+    if (value >= 10) {
+        json.append(char('0' + value / 10 % 10));
+    }
+    json.append(char('0' + value % 10));
+}
+
+///
+/// \brief Writes a legacy JSON project frame by frame, byte for byte the same as the
+/// indented QJsonDocument output it replaces. Each row is copied out of the frame once
+/// and encoded into a reused buffer that is written whenever it grows past a megabyte.
+/// \param device = Open device to write to
+///
+bool ProjectFile::writeLegacyJson(QIODevice &device, const QSize &spriteSize, const FrameList &frames)
+{
+    const int flushSize = 1024 * 1024;
+    QByteArray json;
+    json.reserve(flushSize + 4096);
+    auto flush = [&json, &device]() {
+        bool written = device.write(json) == json.size();
+        json.clear();
+        return written;
+    };
+    // Keys are written in the sorted order QJsonDocument uses
+    json.append("{\n    \"height\": ");
+    json.append(QByteArray::number(spriteSize.height()));
+    json.append(",\n    \"m_frames\": [\n");
+    QVector<QRgb> line(spriteSize.width());
+    for (int frameIndex = 0; frameIndex < frames.size(); frameIndex++) {
+        const Frame frame = frames.at(frameIndex);
+        json.append("        [\n");
+        for (int y = 0; y < spriteSize.height(); y++) {
+            frame.copyLine(y, line.data());
+            json.append("            [\n");
+            for (int x = 0; x < line.size(); x++) {
+                const QRgb pixel = line[x];
+                json.append("                {\n");
+                // The alpha value is left out for opaque pixels
+                if (qAlpha(pixel) != 255) {
+                    json.append("                    \"a\": ");
+                    appendChannel(json, qAlpha(pixel));
+                    json.append(",\n");
+                }
+                json.append("                    \"b\": ");
+                appendChannel(json, qBlue(pixel));
+                json.append(",\n                    \"g\": ");
+                appendChannel(json, qGreen(pixel));
+                json.append(",\n                    \"r\": ");
+                appendChannel(json, qRed(pixel));
+                json.append(x + 1 < line.size() ? "\n                },\n" : "\n                }\n");
+            }
+            json.append(y + 1 < spriteSize.height() ? "            ],\n" : "            ]\n");
+            if (json.size() >= flushSize && !flush()) {
+                return fail(device.errorString());
+            }
+        }
+        json.append(frameIndex + 1 < frames.size() ? "        ],\n" : "        ]\n");
+    }
+    json.append("    ],\n    \"numOfm_frames\": ");
+    json.append(QByteArray::number(frames.size()));
+    json.append(",\n    \"width\": ");
+    json.append(QByteArray::number(spriteSize.width()));
+    json.append("\n}\n");
+    if (!flush()) {
+        return fail(device.errorString());
+    }
+    return true;
+}
+
+///
+/// \brief Records that the JSON is malformed at the tokenizer's position and returns false.
+///
+bool ProjectFile::failAt(const JsonTokenizer &json)
+{
+    return fail(QString("The project is not valid JSON near byte %1.").arg(json.position()));
+}
+
+///
+/// \brief Records an error message and returns false.
+///
+bool ProjectFile::fail(const QString &message)
+{
+    m_errorString = message;
+    return false;
+}
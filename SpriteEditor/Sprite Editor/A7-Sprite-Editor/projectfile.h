@@ -0,0 +1,258 @@
+#ifndef PROJECTFILE_H
+#define PROJECTFILE_H
+
+#include <QFile>
+#include <QIODevice>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include <functional>
+#include "frame.h"
+#include "framecodec.h"
+#include "framelist.h"
+#include "framesource.h"
+#include "jsontokenizer.h"
+
+///
+/// \brief The ProjectFile class reads and writes .ssp sprite projects. Projects are
+/// saved in the binary version 2 container by default:
+///
+/// - A 32 byte header: the magic "SSP2", the version, the sprite width, height and
+///   frame count, a flags word, and the offset of the frame index. All numbers are
+///   little endian.
+/// - One payload per frame, each starting on a 64 byte boundary and stored in one of
+///   the FrameCodec encodings.
+/// - A frame index after the payloads with one 24 byte entry per frame: payload
+///   offset, payload size and encoding.
+/// - When the HasPalette flag is set, the palette shared by the palette encoded frames
+///   follows the index: a color count and that many ARGB32 colors.
+///
+/// Saving frames that were read from the same file only appends: the payloads of
+/// unchanged frames stay where they are, the changed frames and a new index are
+/// written after the end of the file, and the header is switched to the new index
+/// last, so the file holds either version whenever it is read. The whole file is
+/// rewritten once less than half of it would still be in use.
+///
+/// Binary projects are opened with QFile::map and only their index is read up front. The
+/// frames are handed out through a FrameSource that decodes each one the first time it
+/// is read, and raw frames read the mapped pixels in place. On Windows, which cannot
+/// replace a file that is open or mapped, the file is read into memory and closed
+/// instead, so it can always be saved over. The legacy JSON format, with one object per
+/// pixel, can still be read and written without building a document tree. It is written
+/// as a stream, and read by finding each frame's brackets in the mapped file and
+/// decoding the frames in parallel.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class ProjectFile
+{
+public:
+    ///
+    /// \brief The layouts a project can be written in.
+    ///
+    enum class Format {
+        Binary, ///Version 2 binary container
+        LegacyJson ///Original JSON with one object per pixel
+    };
+
+    static constexpr char Magic[4] = {'S', 'S', 'P', '2'}; ///First four bytes of a binary project
+    static constexpr quint32 Version = 2; ///Binary container version written by this class
+    static constexpr int HeaderSize = 32; ///Size of the binary header in bytes
+    static constexpr int IndexEntrySize = 24; ///Size of one frame index entry in bytes
+    static constexpr int PayloadAlignment = 64; ///Alignment of every frame payload in bytes
+    static constexpr int MaximumSide = 16384; ///Largest sprite width or height accepted
+    static constexpr quint32 HasPalette = 0x1; ///Header flag set when a palette follows the index
+    static constexpr int KeyframeInterval = 8; ///Distance between keyframes when saving deltas
+
+    ///
+    /// \brief Identifies the version of a project that was read or written. An appended
+    /// save leaves the frame index of the version before it intact, so that version can
+    /// still be read by its index position.
+    ///
+    struct Generation
+    {
+        quint64 indexOffset = 0; ///Position of the frame index, or 0 for a legacy JSON project
+        quint32 frameCount = 0; ///Number of frames in the index
+        quint32 flags = 0; ///Header flags that go with the index
+        quint16 indexChecksum = 0; ///Checksum of the index entries
+        qint64 fileSize = 0; ///Size of the file right after it was read or written
+        qint64 lastModified = 0; ///Modification time of the file then, in milliseconds since the epoch
+    };
+
+    ///
+    /// \brief Called while frames are decoded with the number decoded so far and the total.
+    /// Returning false cancels the read. It can be called from several threads at once.
+    ///
+    using ProgressHandler = std::function<bool(int decoded, int total)>;
+
+    ///
+    /// \brief Creates a project file for the given path. Nothing is opened yet.
+    /// \param fileName = Path of the .ssp file
+    ///
+    explicit ProjectFile(const QString &fileName);
+
+    ///
+    /// \brief Reads the project, detecting binary and legacy JSON files by their first bytes.
+    /// \param progress = Told how many frames were decoded, and asked whether to go on
+    /// \return If the project was read; errorString() describes the failure otherwise
+    ///
+    bool read(const ProgressHandler &progress = ProgressHandler());
+
+    ///
+    /// \brief Reads an earlier version of the project. A binary project must still hold
+    /// the frame index of that version; a legacy JSON project must not have changed.
+    /// \param generation = Version returned by generation() when it was read or written
+    /// \return If that version was read; errorString() describes the failure otherwise
+    ///
+    bool read(const Generation &generation);
+
+    ///
+    /// \brief Writes a project, replacing the file only once everything was written.
+    /// Binary frames read from this same file are appended to it instead.
+    /// \param spriteSize = Size of every frame
+    /// \param frames = Frames to write
+    /// \param format = Layout to write
+    /// \param encoding = Encoding of every frame payload in a binary project. Asking for
+    /// a palette encoding picks the 4 or 8 bit form from the number of colors, and falls
+    /// back to run-length coding when the frames use more than 256 colors. Asking for
+    /// deltas stores every KeyframeInterval-th frame run-length coded as a keyframe.
+    /// \return If the project was written; errorString() describes the failure otherwise
+    ///
+    bool write(const QSize &spriteSize, const FrameList &frames, Format format,
+               FrameCodec::Encoding encoding = FrameCodec::Encoding::Raw);
+
+    QSize spriteSize() const; ///Returns the sprite size read by read()
+    Generation generation() const; ///Returns the version read or written last
+    const FrameList &frames() const; ///Returns the frames read by read()
+    QString errorString() const; ///Returns a description of the last error
+
+private:
+    ///
+    /// \brief Reads a binary project's header, index and palette, mapping the file, or on
+    /// Windows reading it into memory, so the frames can be decoded from it later. Payloads
+    /// are only checked to lie inside the file; a corrupt payload is noticed when its frame
+    /// is first read.
+    /// \param generation = Earlier version to read, or null for the one the header points at
+    ///
+    bool readBinary(const Generation *generation = nullptr);
+
+    ///
+    /// \brief The bytes of one frame in a legacy JSON project.
+    ///
+    struct FrameRange {
+        qint64 start; ///Position of the first byte
+        qint64 end; ///Position just past the closing bracket
+    };
+
+    ///
+    /// \brief Reads a legacy JSON project. The file is mapped and its top level read once,
+    /// skipping each frame by its brackets to find where it is, so the size is known
+    /// wherever its keys are. The frames are then decoded in parallel, each one written
+    /// row by row straight into its tiles. The width is taken from the first frame when
+    /// the file does not list it, so that frame is decoded before the others.
+    /// \param file = Open file positioned at the start of the JSON
+    /// \param progress = Told how many frames were decoded, and asked whether to go on
+    ///
+    bool readLegacyJson(QFile &file, const ProgressHandler &progress);
+
+    ///
+    /// \brief Finds the bytes of every frame in the legacy m_frames array.
+    /// \param json = Tokenizer positioned before the array
+    /// \param ranges = Receives one range per frame, in order
+    ///
+    bool readLegacyFrameRanges(JsonTokenizer &json, QVector<FrameRange> &ranges);
+
+    ///
+    /// \brief Decodes one frame of a legacy JSON project. Rows shorter than the sprite end
+    /// in transparent pixels, as do frames with fewer rows. It only touches its arguments,
+    /// so frames can be decoded on several threads at once.
+    /// \param contents = Whole JSON text
+    /// \param range = Bytes of the frame
+    /// \param width = Sprite width, or 0 to take it from the first row
+    /// \param height = Sprite height
+    /// \param frameIndex = Position of the frame, for error messages
+    /// \param frame = Receives the decoded frame
+    /// \return An empty string, or a description of what is wrong with the frame
+    ///
+    static QString readLegacyFrame(const QByteArray &contents, const FrameRange &range, int &width, int height,
+                                   int frameIndex, Frame &frame);
+
+    ///
+    /// \brief Writes a binary project. Frames are encoded in parallel batches and their
+    /// payloads written in frame order. The index, and the palette when one is used, are
+    /// written after the payloads, once their sizes are known, and the header is then
+    /// updated to point at them.
+    /// \param device = Open random access device to write to
+    ///
+    bool writeBinary(QIODevice &device, const QSize &spriteSize, const FrameList &frames,
+                     FrameCodec::Encoding encoding);
+
+    ///
+    /// \brief Returns if a binary save can append to the file: the frames must come from
+    /// the index the header still points at, and at least half the file must stay in use.
+    /// \param file = Project file, opened for reading and writing when true is returned
+    ///
+    bool canAppend(QFile &file, const QSize &spriteSize, const FrameList &frames);
+
+    ///
+    /// \brief Appends the frames that changed since the file was read, and a new index
+    /// listing them along with the payloads that are still in use. Unchanged deltas are
+    /// kept only while the frame before them is too. Changed frames are run-length coded
+    /// when a palette is asked for, as they may hold colors the stored palette lacks.
+    /// The file is cut back to its old size if anything fails.
+    /// \param file = Project file opened by canAppend()
+    ///
+    bool appendBinary(QFile &file, const QSize &spriteSize, const FrameList &frames,
+                      FrameCodec::Encoding encoding);
+
+    ///
+    /// \brief Encodes frames in parallel batches and writes their payloads in order,
+    /// each on a payload boundary.
+    /// \param device = Open device positioned at the end of what was written so far
+    /// \param position = Position of the device, moved past the last payload
+    /// \param frames = Frames of the project
+    /// \param frameIndices = Frames to write, in increasing order
+    /// \param frameEncoding = Returns the encoding of a frame
+    /// \param palette = Palette of the palette encoded frames
+    /// \param entries = Receives the index entry of every written frame
+    ///
+    bool writePayloads(QIODevice &device, quint64 &position, const FrameList &frames, const QVector<int> &frameIndices,
+                       const std::function<FrameCodec::Encoding(int)> &frameEncoding,
+                       const FrameCodec::Palette &palette, QVector<FrameSource::Entry> &entries);
+
+    ///
+    /// \brief Writes the frame index and the palette, if there is one, then points the
+    /// header at them and remembers the new generation.
+    /// \param device = Open random access device positioned at the end of the payloads
+    /// \param position = Position of the device
+    ///
+    bool writeIndex(QIODevice &device, quint64 position, const QSize &spriteSize,
+                    const QVector<FrameSource::Entry> &entries, const QVector<QRgb> &palette);
+
+    ///
+    /// \brief Writes a legacy JSON project frame by frame, byte for byte the same as the
+    /// indented QJsonDocument output it replaces. Each row is copied out of the frame once
+    /// and encoded into a reused buffer that is written whenever it grows past a megabyte.
+    /// \param device = Open device to write to
+    ///
+    bool writeLegacyJson(QIODevice &device, const QSize &spriteSize, const FrameList &frames);
+
+    ///
+    /// \brief Records that the JSON is malformed at the tokenizer's position and returns false.
+    ///
+    bool failAt(const JsonTokenizer &json);
+
+    ///
+    /// \brief Records an error message and returns false.
+    ///
+    bool fail(const QString &message);
+
+    QString m_fileName; ///Stores the path of the project
+    QSize m_spriteSize; ///Stores the sprite size that was read
+    FrameList m_frames; ///Stores the frames that were read
+    Generation m_generation; ///Stores the version read or written last
+    QString m_errorString; ///Stores the description of the last error
+};
+
+#endif // PROJECTFILE_H
@@ -0,0 +1,34 @@
+# Frame storage and file formats shared by the editor and the spritetool console
+# build. Nothing listed here may depend on Qt Widgets.
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/animationencoder.cpp \
+    $$PWD/apngencoder.cpp \
+    $$PWD/atlasexporter.cpp \
+    $$PWD/atlaspacker.cpp \
+    $$PWD/frame.cpp \
+    $$PWD/framecodec.cpp \
+    $$PWD/frameimporter.cpp \
+    $$PWD/framelist.cpp \
+    $$PWD/framesource.cpp \
+    $$PWD/gifencoder.cpp \
+    $$PWD/journal.cpp \
+    $$PWD/jsontokenizer.cpp \
+    $$PWD/projectfile.cpp
+
+HEADERS += \
+    $$PWD/animationencoder.h \
+    $$PWD/apngencoder.h \
+    $$PWD/atlasexporter.h \
+    $$PWD/atlaspacker.h \
+    $$PWD/frame.h \
+    $$PWD/framecodec.h \
+    $$PWD/frameimporter.h \
+    $$PWD/framelist.h \
+    $$PWD/framesource.h \
+    $$PWD/gifencoder.h \
+    $$PWD/journal.h \
+    $$PWD/jsontokenizer.h \
+    $$PWD/projectfile.h
@@ -0,0 +1,71 @@
+#include "stampengine.h"
+
+///
+/// \brief Resets the per-stroke timing and pixel counters.
+///
+void StampEngine::beginStroke()
+{
+    m_strokeSegments = 0;
+    m_strokePixels = 0;
+    m_strokeNanoseconds = 0;
+}
+
+///
+/// \brief Starts writing a segment into the given frame.
+/// \param frame = Frame the stamps are written into
+///
+void StampEngine::beginSegment(Frame &frame)
+{
+    m_segmentTimer.start();
+    m_frame = &frame;
+}
+
+///
+/// \brief Fills a rectangle of the frame with one packed color.
+/// \param rect = Rectangle in sprite pixel coordinates
+/// \param pixel = Packed non premultiplied ARGB value to write
+/// \return The part of the rectangle that was inside the frame
+///
+QRect StampEngine::fillRect(const QRect &rect, QRgb pixel)
+{
+    if (!m_frame) {
+        return QRect();
+    }
+    QRect span = m_frame->fillRect(rect, pixel);
+    m_strokePixels += qint64(span.width()) * span.height();
+    return span;
+}
+
+///
+/// \brief Finishes the current segment and adds its time to the stroke.
+///
+void StampEngine::endSegment()
+{
+    m_strokeNanoseconds += m_segmentTimer.nsecsElapsed();
+    m_strokeSegments++;
+    m_frame = nullptr;
+}
+
+///
+/// \brief Returns the number of segments written since the stroke began.
+///
+int StampEngine::strokeSegments() const
+{
+    return m_strokeSegments;
+}
+
+///
+/// \brief Returns the number of pixels written since the stroke began.
+///
+qint64 StampEngine::strokePixels() const
+{
+    return m_strokePixels;
+}
+
+///
+/// \brief Returns the time spent writing segments since the stroke began, in nanoseconds.
+///
+qint64 StampEngine::strokeNanoseconds() const
+{
+    return m_strokeNanoseconds;
+}
@@ -0,0 +1,67 @@
+#ifndef STAMPENGINE_H
+#define STAMPENGINE_H
+
+#include <QRect>
+#include <QElapsedTimer>
+#include "frame.h"
+
+///
+/// \brief The StampEngine class writes brush stamps straight into the tile scanlines
+/// of a frame. Each stamp is clipped to the frame once and written as packed pixel
+/// spans, so no per-pixel color conversion, bounds check or detach check is done.
+/// The engine also times every segment and totals them per stroke.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class StampEngine
+{
+public:
+    ///
+    /// \brief Resets the per-stroke timing and pixel counters.
+    ///
+    void beginStroke();
+
+    ///
+    /// \brief Starts writing a segment into the given frame.
+    /// \param frame = Frame the stamps are written into
+    ///
+    void beginSegment(Frame &frame);
+
+    ///
+    /// \brief Fills a rectangle of the frame with one packed color.
+    /// \param rect = Rectangle in sprite pixel coordinates
+    /// \param pixel = Packed non premultiplied ARGB value to write
+    /// \return The part of the rectangle that was inside the frame
+    ///
+    QRect fillRect(const QRect &rect, QRgb pixel);
+
+    ///
+    /// \brief Finishes the current segment and adds its time to the stroke.
+    ///
+    void endSegment();
+
+    ///
+    /// \brief Returns the number of segments written since the stroke began.
+    ///
+    int strokeSegments() const;
+
+    ///
+    /// \brief Returns the number of pixels written since the stroke began.
+    ///
+    qint64 strokePixels() const;
+
+    ///
+    /// \brief Returns the time spent writing segments since the stroke began, in nanoseconds.
+    ///
+    qint64 strokeNanoseconds() const;
+
+private:
+    Frame *m_frame = nullptr; ///Points to the frame being written
+    QElapsedTimer m_segmentTimer; ///Times the current segment
+    int m_strokeSegments = 0; ///Stores the number of segments in this stroke
+    qint64 m_strokePixels = 0; ///Stores the number of pixels written in this stroke
+    qint64 m_strokeNanoseconds = 0; ///Stores the time spent writing this stroke
+};
+
+#endif // STAMPENGINE_H
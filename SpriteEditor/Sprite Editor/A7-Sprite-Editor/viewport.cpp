@@ -0,0 +1,141 @@
+#include "viewport.h"
+#include <QtMath>
+
+///
+/// \brief Sets the size of the widget showing the sprite. The view keeps its center,
+/// except for the first size, which fits the sprite to the widget.
+/// \param widgetSize = Widget size in pixels
+///
+void Viewport::setWidgetSize(const QSize &widgetSize)
+{
+    if (m_widgetSize.isEmpty()) {
+        m_widgetSize = widgetSize;
+        fitToWidget();
+        return;
+    }
+    m_offset += QPointF(widgetSize.width() - m_widgetSize.width(), widgetSize.height() - m_widgetSize.height()) / 2;
+    m_widgetSize = widgetSize;
+    updateTransform();
+}
+
+///
+/// \brief Sets the size of the sprite being shown.
+/// \param spriteSize = Sprite size in pixels
+///
+void Viewport::setSpriteSize(const QSize &spriteSize)
+{
+    m_spriteSize = spriteSize;
+}
+
+///
+/// \brief Zooms so the whole sprite fits the widget and centers it. Small sprites
+/// are zoomed by a whole number so every sprite pixel is the same size.
+///
+void Viewport::fitToWidget()
+{
+    if (m_spriteSize.isEmpty() || m_widgetSize.isEmpty()) {
+        return;
+    }
+    qreal fit = qMin(qreal(m_widgetSize.width()) / m_spriteSize.width(), qreal(m_widgetSize.height()) / m_spriteSize.height());
+    m_zoom = qBound(MinimumZoom, fit >= 1 ? qFloor(fit) : fit, MaximumZoom);
+    m_offset = QPointF(m_widgetSize.width() - m_spriteSize.width() * m_zoom, m_widgetSize.height() - m_spriteSize.height() * m_zoom) / 2;
+    updateTransform();
+}
+
+///
+/// \brief Multiplies the zoom, keeping the sprite point under the anchor in place. A zoom
+/// within rounding error of a whole number is snapped to it.
+/// \param factor = Amount to multiply the zoom by
+/// \param anchor = Point in widget coordinates that stays fixed
+///
+void Viewport::zoomBy(qreal factor, const QPointF &anchor)
+{
+    qreal newZoom = qBound(MinimumZoom, m_zoom * factor, MaximumZoom);
+    // Repeated wheel steps land a little off whole zooms, such as 2.0000000000000004
+    if (qFuzzyCompare(newZoom, qreal(qRound(newZoom)))) {
+        newZoom = qRound(newZoom);
+    }
+    QPointF spriteAnchor = m_inverse.map(anchor);
+    m_zoom = newZoom;
+    m_offset = anchor - spriteAnchor * m_zoom;
+    updateTransform();
+}
+
+///
+/// \brief Moves the sprite on the widget.
+/// \param delta = Distance in widget pixels
+///
+void Viewport::panBy(const QPointF &delta)
+{
+    m_offset += delta;
+    updateTransform();
+}
+
+///
+/// \brief Returns the number of widget pixels per sprite pixel.
+///
+qreal Viewport::zoom() const
+{
+    return m_zoom;
+}
+
+///
+/// \brief Returns whether every sprite pixel is a whole number of widget pixels wide.
+///
+bool Viewport::isWholeZoom() const
+{
+    return m_zoom >= 1 && m_zoom == qFloor(m_zoom);
+}
+
+///
+/// \brief Returns the cached transform from sprite to widget coordinates.
+///
+const QTransform &Viewport::transform() const
+{
+    return m_transform;
+}
+
+///
+/// \brief Returns the smallest widget rectangle covering the given sprite pixels.
+/// \param spriteRect = Rectangle in sprite pixel coordinates
+///
+QRect Viewport::spriteToScreen(const QRect &spriteRect) const
+{
+    return m_transform.mapRect(QRectF(spriteRect)).toAlignedRect();
+}
+
+///
+/// \brief Returns the sprite pixel under a widget point. The point may be outside the sprite.
+/// \param screenPoint = Point in widget coordinates
+///
+QPoint Viewport::screenToSprite(const QPointF &screenPoint) const
+{
+    QPointF spritePoint = m_inverse.map(screenPoint);
+    return QPoint(qFloor(spritePoint.x()), qFloor(spritePoint.y()));
+}
+
+///
+/// \brief Returns the sprite pixels a widget rectangle overlaps, clipped to the sprite.
+/// \param screenRect = Rectangle in widget coordinates
+///
+QRect Viewport::screenToSprite(const QRect &screenRect) const
+{
+    QRectF spriteArea = m_inverse.mapRect(QRectF(screenRect));
+    QRect covered(QPoint(qFloor(spriteArea.left()), qFloor(spriteArea.top())),
+                  QPoint(qCeil(spriteArea.right()) - 1, qCeil(spriteArea.bottom()) - 1));
+    return covered & QRect(QPoint(0, 0), m_spriteSize);
+}
+
+///
+/// \brief Rebuilds the cached transform and its inverse from the zoom and offset. At
+/// whole number zooms the offset is rounded to whole widget pixels.
+///
+void Viewport::updateTransform()
+{
+    // Whole number zooms keep the sprite on whole pixels so it can be magnified without resampling
+    if (isWholeZoom()) {
+        m_offset = QPointF(qRound(m_offset.x()), qRound(m_offset.y()));
+    }
+    m_transform = QTransform(m_zoom, 0, 0, m_zoom, m_offset.x(), m_offset.y());
+    m_inverse = QTransform(1 / m_zoom, 0, 0, 1 / m_zoom, -m_offset.x() / m_zoom, -m_offset.y() / m_zoom);
+}
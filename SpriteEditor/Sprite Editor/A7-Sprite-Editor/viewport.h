@@ -0,0 +1,105 @@
+#ifndef VIEWPORT_H
+#define VIEWPORT_H
+
+#include <QRect>
+#include <QSize>
+#include <QPointF>
+#include <QTransform>
+
+///
+/// \brief The Viewport class maps sprite pixels to widget pixels for a view of any
+/// size that can be panned and zoomed by any factor. The mapping is kept as one
+/// cached transform and its inverse, which are rebuilt only when the view changes,
+/// so painting and hit testing always agree.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class Viewport
+{
+public:
+    static constexpr qreal MinimumZoom = 1.0 / 64; ///Smallest number of widget pixels per sprite pixel
+    static constexpr qreal MaximumZoom = 256; ///Largest number of widget pixels per sprite pixel
+
+    ///
+    /// \brief Sets the size of the widget showing the sprite. The view keeps its center,
+    /// except for the first size, which fits the sprite to the widget.
+    /// \param widgetSize = Widget size in pixels
+    ///
+    void setWidgetSize(const QSize &widgetSize);
+
+    ///
+    /// \brief Sets the size of the sprite being shown.
+    /// \param spriteSize = Sprite size in pixels
+    ///
+    void setSpriteSize(const QSize &spriteSize);
+
+    ///
+    /// \brief Zooms so the whole sprite fits the widget and centers it. Small sprites
+    /// are zoomed by a whole number so every sprite pixel is the same size.
+    ///
+    void fitToWidget();
+
+    ///
+    /// \brief Multiplies the zoom, keeping the sprite point under the anchor in place. A zoom
+    /// within rounding error of a whole number is snapped to it.
+    /// \param factor = Amount to multiply the zoom by
+    /// \param anchor = Point in widget coordinates that stays fixed
+    ///
+    void zoomBy(qreal factor, const QPointF &anchor);
+
+    ///
+    /// \brief Moves the sprite on the widget.
+    /// \param delta = Distance in widget pixels
+    ///
+    void panBy(const QPointF &delta);
+
+    ///
+    /// \brief Returns the number of widget pixels per sprite pixel.
+    ///
+    qreal zoom() const;
+
+    ///
+    /// \brief Returns whether every sprite pixel is a whole number of widget pixels wide.
+    ///
+    bool isWholeZoom() const;
+
+    ///
+    /// \brief Returns the cached transform from sprite to widget coordinates.
+    ///
+    const QTransform &transform() const;
+
+    ///
+    /// \brief Returns the smallest widget rectangle covering the given sprite pixels.
+    /// \param spriteRect = Rectangle in sprite pixel coordinates
+    ///
+    QRect spriteToScreen(const QRect &spriteRect) const;
+
+    ///
+    /// \brief Returns the sprite pixel under a widget point. The point may be outside the sprite.
+    /// \param screenPoint = Point in widget coordinates
+    ///
+    QPoint screenToSprite(const QPointF &screenPoint) const;
+
+    ///
+    /// \brief Returns the sprite pixels a widget rectangle overlaps, clipped to the sprite.
+    /// \param screenRect = Rectangle in widget coordinates
+    ///
+    QRect screenToSprite(const QRect &screenRect) const;
+
+private:
+    ///
+    /// \brief Rebuilds the cached transform and its inverse from the zoom and offset. At
+    /// whole number zooms the offset is rounded to whole widget pixels.
+    ///
+    void updateTransform();
+
+    QSize m_widgetSize; ///Stores the widget size
+    QSize m_spriteSize; ///Stores the sprite size
+    qreal m_zoom = 1; ///Stores the widget pixels per sprite pixel
+    QPointF m_offset; ///Stores the widget position of the sprite's top left corner
+    QTransform m_transform; ///Maps sprite coordinates to widget coordinates
+    QTransform m_inverse; ///Maps widget coordinates to sprite coordinates
+};
+
+#endif // VIEWPORT_H
@@ -0,0 +1,82 @@
+#include "pixelscaler.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <functional>
+
+///
+/// \brief Returns the average time of one call in microseconds, calling it until at
+/// least the given time has passed. One untimed call warms the caches first.
+///
+static double timeCall(const std::function<void()> &call, qint64 minimumNanoseconds)
+{
+    call();
+    QElapsedTimer timer;
+    timer.start();
+    qint64 calls = 0;
+    do {
+        call();
+        calls++;
+    } while (timer.nsecsElapsed() < minimumNanoseconds);
+    return timer.nsecsElapsed() / 1000.0 / calls;
+}
+
+///
+/// \brief Micro-benchmark of PixelScaler against QImage::scaled. Magnifies a sprite of
+/// random pixels by every power of two from 2 to 64, first the whole sprite and then
+/// only the part a window of the given size shows, as the canvas does when zoomed in.
+/// QImage::scaled always builds the whole magnified image; the kernel writes into a
+/// preallocated image and only inside the clip. Exits with 1 if the kernel's pixels
+/// differ from QImage::scaled.
+///
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QTextStream out(stdout);
+    const QStringList arguments = a.arguments();
+    const int side = arguments.size() > 1 ? qMax(1, arguments.at(1).toInt()) : 64;
+    const QRect window(0, 0, 1280, 800);
+    const qint64 minimumNanoseconds = 200 * 1000 * 1000;
+
+    QImage sprite(side, side, QImage::Format_ARGB32);
+    for (int y = 0; y < side; y++) {
+        QRandomGenerator::global()->fillRange(reinterpret_cast<quint32 *>(sprite.scanLine(y)), side);
+    }
+    out << "Magnifying a " << side << "x" << side << " sprite; times are microseconds per call" << Qt::endl;
+    out << qSetFieldWidth(8) << "factor" << "scaled" << "kernel" << "speedup"
+        << qSetFieldWidth(0) << " |" << qSetFieldWidth(8) << "window" << "speedup" << qSetFieldWidth(0)
+        << Qt::endl;
+
+    bool matches = true;
+    for (int factor = 2; factor <= 64; factor *= 2) {
+        const QSize magnified = sprite.size() * factor;
+        QImage target(magnified, QImage::Format_ARGB32);
+        PixelScaler::scale(sprite, sprite.rect(), factor, target, QPoint(0, 0), target.rect());
+        matches = matches && target == sprite.scaled(magnified, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+
+        const double scaled = timeCall([&]() {
+            const QImage result = sprite.scaled(magnified, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+            Q_UNUSED(result)
+        }, minimumNanoseconds);
+        const double kernel = timeCall([&]() {
+            PixelScaler::scale(sprite, sprite.rect(), factor, target, QPoint(0, 0), target.rect());
+        }, minimumNanoseconds);
+        // Centered like a zoomed in canvas, so the clip cuts through magnified pixels
+        const QPoint origin = window.center() - QRect(QPoint(0, 0), magnified).center();
+        QImage windowTarget(window.size(), QImage::Format_ARGB32);
+        const double clipped = timeCall([&]() {
+            PixelScaler::scale(sprite, sprite.rect(), factor, windowTarget, origin, window);
+        }, minimumNanoseconds);
+
+        out << qSetFieldWidth(8) << factor << QString::number(scaled, 'f', 1) << QString::number(kernel, 'f', 1)
+            << QString::number(scaled / kernel, 'f', 1) + "x" << qSetFieldWidth(0) << " |" << qSetFieldWidth(8)
+            << QString::number(clipped, 'f', 1) << QString::number(scaled / clipped, 'f', 1) + "x"
+            << qSetFieldWidth(0) << Qt::endl;
+    }
+    if (!matches) {
+        out << "The kernel's pixels differ from QImage::scaled." << Qt::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,15 @@
+QT       = core gui
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+# Times the editor's magnification kernel against QImage::scaled. The kernel is
+# built from the editor's own source file.
+INCLUDEPATH += ../A7-Sprite-Editor
+
+SOURCES += \
+    ../A7-Sprite-Editor/pixelscaler.cpp \
+    main.cpp
+
+HEADERS += \
+    ../A7-Sprite-Editor/pixelscaler.h
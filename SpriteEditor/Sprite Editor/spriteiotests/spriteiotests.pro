@@ -0,0 +1,11 @@
+QT       = core gui concurrent testlib
+
+CONFIG += console testcase c++17
+CONFIG -= app_bundle
+
+# Tests the project, journal, codec and animation sources shared through spriteio.pri.
+# Run with `make check`; nothing here needs a display.
+include(../A7-Sprite-Editor/spriteio.pri)
+
+SOURCES += \
+    tst_spriteio.cpp
@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <memory>
+#include "apngencoder.h"
+#include "framecodec.h"
+#include "frameimporter.h"
+#include "gifencoder.h"
+#include "journal.h"
+#include "projectfile.h"
+
+///
+/// \brief The TestSpriteIo class checks that frames come back unchanged from every way
+/// they are written: the frame codecs, the crash journal, project saves and animations.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class TestSpriteIo : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void codecRoundTrip_data();
+    void codecRoundTrip();
+    void journalRestoresAfterCrash();
+    void projectAppendReadsBack();
+    void animationReadsBack_data();
+    void animationReadsBack();
+
+private:
+    static Frame testFrame(const QSize &size, int seed, bool isOpaque);
+    static bool isSame(const Frame &frame, const Frame &other);
+
+    QTemporaryDir m_folder; ///Holds the files the tests write
+};
+
+///
+/// \brief Lists every encoding a frame can be stored with.
+///
+void TestSpriteIo::codecRoundTrip_data()
+{
+    QTest::addColumn<int>("encoding");
+    QTest::newRow("raw") << int(FrameCodec::Encoding::Raw);
+    QTest::newRow("zlib") << int(FrameCodec::Encoding::Zlib);
+    QTest::newRow("run length") << int(FrameCodec::Encoding::RunLength);
+    QTest::newRow("palette 8") << int(FrameCodec::Encoding::Palette8);
+    QTest::newRow("palette 4") << int(FrameCodec::Encoding::Palette4);
+    QTest::newRow("delta") << int(FrameCodec::Encoding::Delta);
+}
+
+///
+/// \brief Encodes a frame and checks that decoding gives back the same pixels.
+///
+void TestSpriteIo::codecRoundTrip()
+{
+    QFETCH(int, encoding);
+    const FrameCodec::Encoding codec = FrameCodec::Encoding(encoding);
+    const QSize size(100, 70);
+    const Frame previous = testFrame(size, 1, false);
+    const Frame frame = testFrame(size, 2, false);
+    FrameCodec::Palette palette;
+    QVERIFY(FrameCodec::buildPalette(QVector<Frame>{previous, frame}, palette));
+    const Frame reference = codec == FrameCodec::Encoding::Delta ? previous : Frame();
+    const QByteArray payload = FrameCodec::encode(frame, codec, palette, reference);
+    bool ok = false;
+    const Frame decoded = FrameCodec::decode(reinterpret_cast<const uchar *>(payload.constData()), payload.size(),
+                                             size, codec, palette.colors, reference, &ok);
+    QVERIFY(ok);
+    QVERIFY(isSame(decoded, frame));
+}
+
+///
+/// \brief Writes a journal whose last record is cut short, as a crash would leave it,
+/// and checks that it restores the frames as they were after the last whole record.
+///
+void TestSpriteIo::journalRestoresAfterCrash()
+{
+    const QSize size(100, 70);
+    const QString fileName = m_folder.filePath("crash.ssj");
+    FrameList frames = QVector<Frame>(2, Frame(size));
+    {
+        Journal journal(fileName);
+        Journal::Base base;
+        base.spriteSize = size;
+        base.generation.frameCount = 2;
+        QVERIFY2(journal.start(base), qPrintable(journal.errorString()));
+        const Frame drawn = testFrame(size, 3, false);
+        journal.recordPixels(0, frames.at(0), drawn);
+        frames[0] = drawn;
+        journal.recordInsert(2, 0);
+        frames.insert(2, frames.at(0));
+        journal.recordRemove(1);
+        frames.removeAt(1);
+        journal.recordPixels(1, frames.at(1), testFrame(size, 4, false));
+        QCOMPARE(journal.recordCount(), 4);
+    }
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.resize(file.size() - 3));
+    file.close();
+
+    Journal journal(fileName);
+    QVERIFY2(journal.open(), qPrintable(journal.errorString()));
+    QCOMPARE(journal.recordCount(), 3);
+    QSize restoredSize;
+    FrameList restored;
+    QVERIFY2(journal.restore(restoredSize, restored), qPrintable(journal.errorString()));
+    QCOMPARE(restoredSize, size);
+    QCOMPARE(restored.size(), frames.size());
+    for (int index = 0; index < frames.size(); index++) {
+        QVERIFY(isSame(restored.at(index), frames.at(index)));
+    }
+}
+
+///
+/// \brief Saves a project, saves it again with some frames changed so the changes are
+/// appended, and checks that reading it gives back the changed frames.
+///
+void TestSpriteIo::projectAppendReadsBack()
+{
+    const QSize size(100, 70);
+    const QString fileName = m_folder.filePath("append.ssp");
+    const FrameList frames = QVector<Frame>{testFrame(size, 1, false), testFrame(size, 2, false),
+                                            testFrame(size, 3, false)};
+    ProjectFile created(fileName);
+    QVERIFY2(created.write(size, frames, ProjectFile::Format::Binary), qPrintable(created.errorString()));
+    const qint64 createdSize = QFileInfo(fileName).size();
+
+    ProjectFile project(fileName);
+    QVERIFY2(project.read(), qPrintable(project.errorString()));
+    FrameList edited = project.frames();
+    edited[1] = testFrame(size, 5, false);
+    edited.append(testFrame(size, 6, false));
+    QVERIFY2(project.write(size, edited, ProjectFile::Format::Binary), qPrintable(project.errorString()));
+    // An appended save leaves the old contents in place and writes its index after them
+    QVERIFY(project.generation().indexOffset >= quint64(createdSize));
+
+    ProjectFile reread(fileName);
+    QVERIFY2(reread.read(), qPrintable(reread.errorString()));
+    QCOMPARE(reread.spriteSize(), size);
+    QCOMPARE(reread.frames().size(), edited.size());
+    for (int index = 0; index < edited.size(); index++) {
+        QVERIFY(isSame(reread.frames().at(index), edited.at(index)));
+    }
+}
+
+///
+/// \brief Lists the animation formats. GIF frames are opaque, as GIF has no partial
+/// transparency and cannot clear a pixel a previous frame drew.
+///
+void TestSpriteIo::animationReadsBack_data()
+{
+    QTest::addColumn<QString>("suffix");
+    QTest::addColumn<bool>("isOpaque");
+    QTest::newRow("gif") << QString("gif") << true;
+    QTest::newRow("apng") << QString("png") << false;
+}
+
+///
+/// \brief Exports an animation and checks that importing it gives back the same frames.
+///
+void TestSpriteIo::animationReadsBack()
+{
+    QFETCH(QString, suffix);
+    QFETCH(bool, isOpaque);
+    const QSize size(100, 70);
+    const FrameList frames = QVector<Frame>{testFrame(size, 1, isOpaque), testFrame(size, 2, isOpaque),
+                                            testFrame(size, 3, isOpaque)};
+    const QString fileName = m_folder.filePath("animation." + suffix);
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    std::unique_ptr<AnimationEncoder> encoder;
+    if (suffix == "gif") {
+        encoder = std::make_unique<GifEncoder>(file);
+    } else {
+        encoder = std::make_unique<ApngEncoder>(file);
+    }
+    QVERIFY2(encoder->begin(size, 10), qPrintable(encoder->errorString()));
+    for (int index = 0; index < frames.size(); index++) {
+        QVERIFY2(encoder->addFrame(frames.at(index)), qPrintable(encoder->errorString()));
+    }
+    QVERIFY2(encoder->finish(), qPrintable(encoder->errorString()));
+    file.close();
+
+    FrameImporter importer(fileName);
+    QVERIFY2(importer.readAnimation(), qPrintable(importer.errorString()));
+    QCOMPARE(importer.spriteSize(), size);
+    QCOMPARE(importer.frames().size(), frames.size());
+    for (int index = 0; index < frames.size(); index++) {
+        QVERIFY(isSame(importer.frames().at(index), frames.at(index)));
+    }
+}
+
+///
+/// \brief Returns a frame with runs, single pixels and a rectangle crossing tile edges,
+/// using at most eight colors so every palette encoding can hold it.
+/// \param size = Size of the frame
+/// \param seed = Picks the colors and where the rectangle is
+/// \param isOpaque = If the background is filled instead of left transparent
+///
+Frame TestSpriteIo::testFrame(const QSize &size, int seed, bool isOpaque)
+{
+    static const QRgb colors[] = {0xff000000, 0xffffffff, 0xffff0000, 0xff00ff00,
+                                  0xff0000ff, 0xffffff00, 0x80ff00ff, 0xff00ffff};
+    Frame frame(size);
+    if (isOpaque) {
+        frame.fill(colors[seed % 6]);
+    }
+    frame.fillRect(QRect(seed * 13 % size.width(), 20, 50, 30), colors[(seed + 1) % 6]);
+    QVector<QRgb> line(size.width());
+    for (int x = 0; x < size.width(); x++) {
+        line[x] = isOpaque || x % 5 != 0 ? colors[(x * 3 + seed) % 8] : 0;
+    }
+    if (isOpaque) {
+        std::replace(line.begin(), line.end(), colors[6], colors[0]);
+    }
+    frame.setLine(size.height() - 3, line.constData());
+    return frame;
+}
+
+///
+/// \brief Returns if two frames have the same size and pixels.
+///
+bool TestSpriteIo::isSame(const Frame &frame, const Frame &other)
+{
+    return frame.size() == other.size() && frame.toImage() == other.toImage();
+}
+
+QTEST_GUILESS_MAIN(TestSpriteIo)
+
+#include "tst_spriteio.moc"
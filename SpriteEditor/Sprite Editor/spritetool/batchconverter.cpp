@@ -0,0 +1,194 @@
+#include "batchconverter.h"
+#include "frameexporter.h"
+#include "frameimporter.h"
+#include "projectfile.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+///
+/// \brief Returns a path in the form used to tell whether two paths name the same file.
+///
+static QString pathKey(const QString &path)
+{
+    const QString absolute = QFileInfo(QDir::cleanPath(path)).absoluteFilePath();
+#ifdef Q_OS_WIN
+    return absolute.toLower();
+#else
+    return absolute;
+#endif
+}
+
+///
+/// \brief Creates a converter.
+/// \param options = How every input is read and written
+///
+BatchConverter::BatchConverter(const Options &options)
+    : m_options(options)
+{
+}
+
+///
+/// \brief Converts one input on the calling thread.
+/// \param inputName = Project, image or folder to convert
+///
+BatchConverter::Result BatchConverter::convert(const QString &inputName) const
+{
+    QElapsedTimer timer;
+    timer.start();
+    Result result;
+    result.inputName = inputName;
+    result.outputName = outputName(inputName);
+    const QFileInfo input(QDir::cleanPath(inputName));
+    if (!input.exists()) {
+        result.errorString = "No such file or folder.";
+        return result;
+    }
+    // A project written over the project it was read from is appended to, not converted
+    if (QFileInfo(result.outputName).absoluteFilePath() == input.absoluteFilePath()) {
+        result.errorString = "The output would replace the input; choose another output folder.";
+        return result;
+    }
+    result.bytesRead = inputSize(inputName);
+
+    QSize spriteSize;
+    FrameList frames;
+    if (input.suffix().compare("ssp", Qt::CaseInsensitive) == 0) {
+        ProjectFile project(inputName);
+        if (!project.read()) {
+            result.errorString = project.errorString();
+            return result;
+        }
+        spriteSize = project.spriteSize();
+        frames = project.frames();
+    } else {
+        FrameImporter importer(inputName);
+        bool isImported;
+        if (input.isDir()) {
+            isImported = importer.readSequence();
+        } else if (m_options.readsAnimations || input.suffix().compare("gif", Qt::CaseInsensitive) == 0) {
+            isImported = importer.readAnimation();
+        } else {
+            isImported = importer.readSheet(m_options.cellSize);
+        }
+        if (!isImported) {
+            result.errorString = importer.errorString();
+            return result;
+        }
+        spriteSize = importer.spriteSize();
+        frames = importer.frames();
+    }
+    result.frameCount = frames.size();
+
+    if (m_options.target == Target::Project) {
+        ProjectFile project(result.outputName);
+        if (!project.write(spriteSize, frames, ProjectFile::Format::Binary, m_options.encoding)) {
+            result.errorString = project.errorString();
+            return result;
+        }
+        result.bytesWritten = QFileInfo(result.outputName).size();
+    } else {
+        FrameExporter exporter(result.outputName);
+        const bool isWritten = m_options.target == Target::Sequence ? exporter.writeSequence(frames)
+                                                                    : exporter.writeSheet(spriteSize, frames, m_options.columns);
+        if (!isWritten) {
+            result.errorString = exporter.errorString();
+            return result;
+        }
+        result.bytesWritten = exporter.bytesWritten();
+    }
+    result.milliseconds = timer.elapsed();
+    return result;
+}
+
+///
+/// \brief Converts many inputs, several at once. Inputs that would be written to the same
+/// output, or over another input, are refused rather than converted.
+/// \param inputNames = Projects, images or folders to convert
+/// \param jobs = Number of inputs converted at once
+/// \param handler = Told about each input as soon as it and those before it are done
+/// \return The result of every input, in input order
+///
+QVector<BatchConverter::Result> BatchConverter::convert(const QStringList &inputNames, int jobs,
+                                                        const ResultHandler &handler) const
+{
+    // Inputs written to the same path, or over another input, would race on the file
+    QHash<QString, int> outputCounts;
+    QSet<QString> inputKeys;
+    for (const QString &inputName : inputNames) {
+        outputCounts[pathKey(outputName(inputName))]++;
+        inputKeys.insert(pathKey(inputName));
+    }
+    QVector<Result> results(inputNames.size());
+    QStringList accepted;
+    for (int index = 0; index < inputNames.size(); index++) {
+        Result &result = results[index];
+        result.inputName = inputNames.at(index);
+        result.outputName = outputName(result.inputName);
+        const QString outputKey = pathKey(result.outputName);
+        if (outputCounts.value(outputKey) > 1) {
+            result.errorString = "Another input is written to " + result.outputName
+                                 + " as well; convert them into different output folders.";
+        } else if (inputKeys.contains(outputKey) && outputKey != pathKey(result.inputName)) {
+            result.errorString = "The output would replace another input; choose another output folder.";
+        } else {
+            accepted.append(result.inputName);
+        }
+    }
+
+    // A pool of its own, so files waiting on their frames never hold the threads that
+    // decode and encode those frames
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(jobs, 1));
+    QFuture<Result> future = QtConcurrent::mapped(&pool, accepted, [this](const QString &inputName) {
+        return convert(inputName);
+    });
+    int acceptedIndex = 0;
+    for (Result &result : results) {
+        if (result.errorString.isEmpty()) {
+            result = future.resultAt(acceptedIndex++);
+        }
+        if (handler) {
+            handler(result);
+        }
+    }
+    return results;
+}
+
+///
+/// \brief Returns the path an input is written to.
+/// \param inputName = Project, image or folder to convert
+///
+QString BatchConverter::outputName(const QString &inputName) const
+{
+    const QFileInfo input(QDir::cleanPath(inputName));
+    const QString folder = m_options.outputFolder.isEmpty() ? input.path() : m_options.outputFolder;
+    const QString baseName = input.isDir() ? input.fileName() : input.completeBaseName();
+    if (m_options.target == Target::Project) {
+        return folder + "/" + baseName + ".ssp";
+    }
+    if (m_options.target == Target::Sequence) {
+        return folder + "/" + baseName;
+    }
+    return folder + "/" + baseName + ".png";
+}
+
+///
+/// \brief Returns the size of a file, or of the PNG images in a folder.
+///
+qint64 BatchConverter::inputSize(const QString &inputName)
+{
+    const QFileInfo input(inputName);
+    if (!input.isDir()) {
+        return input.size();
+    }
+    qint64 size = 0;
+    for (const QFileInfo &image : QDir(inputName).entryInfoList({"*.png"}, QDir::Files)) {
+        size += image.size();
+    }
+    return size;
+}
@@ -0,0 +1,105 @@
+#ifndef BATCHCONVERTER_H
+#define BATCHCONVERTER_H
+
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include "framecodec.h"
+
+///
+/// \brief The BatchConverter class converts sprite files between .ssp projects, PNG
+/// sequences and PNG sprite sheets without a window, using the same ProjectFile,
+/// FrameImporter and codecs as the editor. An input can be a project, a sheet or an
+/// animated image, or a folder of PNG images read as a sequence.
+///
+/// Files are converted on a thread pool of their own, one file per task, so several
+/// files are read and written at once while the per-frame work inside each of them
+/// still spreads over the global pool.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class BatchConverter
+{
+public:
+    ///
+    /// \brief What the inputs are converted to.
+    ///
+    enum class Target {
+        Project, ///Binary .ssp project
+        Sequence, ///Folder with one PNG image per frame
+        Sheet ///One PNG sprite sheet
+    };
+
+    ///
+    /// \brief How every input is read and written.
+    ///
+    struct Options
+    {
+        Target target = Target::Project; ///Format to write
+        QString outputFolder; ///Folder to write to, or empty to write next to each input
+        FrameCodec::Encoding encoding = FrameCodec::Encoding::RunLength; ///Frame encoding of written projects
+        QSize cellSize; ///Cell size of input sheets, or an empty size to slice along transparent gutters
+        int columns = 0; ///Cells per row of written sheets, or 0 for about square
+        bool readsAnimations = false; ///If PNG inputs are read as animations rather than sheets
+    };
+
+    ///
+    /// \brief The outcome of converting one input.
+    ///
+    struct Result
+    {
+        QString inputName; ///Path that was read
+        QString outputName; ///Path that was written
+        int frameCount = 0; ///Number of frames converted
+        qint64 bytesRead = 0; ///Size of the input
+        qint64 bytesWritten = 0; ///Size of the output
+        qint64 milliseconds = 0; ///Time taken to read and write
+        QString errorString; ///Description of the failure, or empty when it worked
+    };
+
+    ///
+    /// \brief Called on the calling thread with every result, in input order.
+    ///
+    using ResultHandler = std::function<void(const Result &result)>;
+
+    ///
+    /// \brief Creates a converter.
+    /// \param options = How every input is read and written
+    ///
+    explicit BatchConverter(const Options &options);
+
+    ///
+    /// \brief Converts one input on the calling thread.
+    /// \param inputName = Project, image or folder to convert
+    ///
+    Result convert(const QString &inputName) const;
+
+    ///
+    /// \brief Converts many inputs, several at once. Inputs that would be written to the same
+    /// output, or over another input, are refused rather than converted.
+    /// \param inputNames = Projects, images or folders to convert
+    /// \param jobs = Number of inputs converted at once
+    /// \param handler = Told about each input as soon as it and those before it are done
+    /// \return The result of every input, in input order
+    ///
+    QVector<Result> convert(const QStringList &inputNames, int jobs, const ResultHandler &handler = ResultHandler()) const;
+
+    ///
+    /// \brief Returns the path an input is written to.
+    /// \param inputName = Project, image or folder to convert
+    ///
+    QString outputName(const QString &inputName) const;
+
+private:
+    ///
+    /// \brief Returns the size of a file, or of the PNG images in a folder.
+    ///
+    static qint64 inputSize(const QString &inputName);
+
+    Options m_options; ///Stores how every input is read and written
+};
+
+#endif // BATCHCONVERTER_H
@@ -0,0 +1,123 @@
+#include "frameexporter.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QImageWriter>
+#include <QtConcurrent>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+///
+/// \brief Creates an exporter writing to the given path.
+/// \param fileName = Folder of a sequence, which is created if needed, or path of a sheet
+///
+FrameExporter::FrameExporter(const QString &fileName)
+    : m_fileName(fileName)
+{
+}
+
+///
+/// \brief Writes every frame to its own PNG file in the folder, named after the
+/// folder with the frame number appended.
+/// \param frames = Frames to export
+/// \return If every frame was written; errorString() describes the failure otherwise
+///
+bool FrameExporter::writeSequence(const FrameList &frames)
+{
+    m_bytesWritten = 0;
+    if (!QDir().mkpath(m_fileName)) {
+        return fail("Unable to create the folder " + m_fileName + ".");
+    }
+    const int frameCount = frames.size();
+    QVector<int> indices(frameCount);
+    std::iota(indices.begin(), indices.end(), 0);
+    const QVector<QString> errors = QtConcurrent::blockingMapped<QVector<QString>>(indices, [&](int index) {
+        QImageWriter writer(sequenceFileName(index, frameCount), "png");
+        return writer.write(frames.at(index).toImage()) ? QString() : writer.errorString();
+    });
+    for (const QString &error : errors) {
+        if (!error.isEmpty()) {
+            return fail(error);
+        }
+    }
+    for (int index = 0; index < frameCount; index++) {
+        m_bytesWritten += QFileInfo(sequenceFileName(index, frameCount)).size();
+    }
+    return true;
+}
+
+///
+/// \brief Writes the frames to one PNG sprite sheet, one frame per grid cell.
+/// \param spriteSize = Size of every frame, and so of every cell
+/// \param frames = Frames to export
+/// \param columns = Cells per row, or 0 for as many as makes the grid about square
+/// \return If the sheet was written; errorString() describes the failure otherwise
+///
+bool FrameExporter::writeSheet(const QSize &spriteSize, const FrameList &frames, int columns)
+{
+    m_bytesWritten = 0;
+    if (frames.isEmpty()) {
+        return fail("There are no frames to write.");
+    }
+    if (columns <= 0) {
+        columns = int(std::ceil(std::sqrt(double(frames.size()))));
+    }
+    columns = qMin(columns, frames.size());
+    const int rows = (frames.size() + columns - 1) / columns;
+    QImage sheet(spriteSize.width() * columns, spriteSize.height() * rows, QImage::Format_ARGB32);
+    if (sheet.isNull()) {
+        return fail("The sheet is too large to hold in memory; write a sequence instead.");
+    }
+    sheet.fill(0);
+    // Taken once up front: scanLine() on a shared image from several tasks would race
+    uchar *const bits = sheet.bits();
+    const qsizetype bytesPerLine = sheet.bytesPerLine();
+    QVector<int> indices(frames.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    QtConcurrent::blockingMap(indices, [&](int index) {
+        const QImage frame = frames.at(index).toImage();
+        const int left = (index % columns) * spriteSize.width();
+        const int top = (index / columns) * spriteSize.height();
+        for (int y = 0; y < frame.height(); y++) {
+            std::memcpy(bits + (top + y) * bytesPerLine + left * sizeof(QRgb), frame.constScanLine(y),
+                        frame.width() * sizeof(QRgb));
+        }
+    });
+    QImageWriter writer(m_fileName, "png");
+    if (!writer.write(sheet)) {
+        return fail(writer.errorString());
+    }
+    m_bytesWritten = QFileInfo(m_fileName).size();
+    return true;
+}
+
+///
+/// \brief Returns the path of one frame of a sequence.
+/// \param index = Frame number
+/// \param frameCount = Number of frames in the sequence
+///
+QString FrameExporter::sequenceFileName(int index, int frameCount) const
+{
+    const int digits = qMax(MinimumDigits, int(QString::number(qMax(frameCount - 1, 0)).size()));
+    return m_fileName + "/" + QFileInfo(m_fileName).fileName() + "_"
+           + QString("%1").arg(index, digits, 10, QChar('0')) + ".png";
+}
+
+qint64 FrameExporter::bytesWritten() const
+{
+    return m_bytesWritten;
+}
+
+QString FrameExporter::errorString() const
+{
+    return m_errorString;
+}
+
+///
+/// \brief Records an error message and returns false.
+///
+bool FrameExporter::fail(const QString &message)
+{
+    m_errorString = message;
+    return false;
+}
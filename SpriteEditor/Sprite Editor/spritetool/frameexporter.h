@@ -0,0 +1,69 @@
+#ifndef FRAMEEXPORTER_H
+#define FRAMEEXPORTER_H
+
+#include <QSize>
+#include <QString>
+#include "framelist.h"
+
+///
+/// \brief The FrameExporter class writes the frames of a sprite as plain PNG images:
+/// either one image per frame in a folder, numbered so they sort in frame order, or
+/// one sprite sheet with the frames laid out on a grid left to right and top to bottom.
+/// Both are read back by FrameImporter.
+///
+/// Frames are encoded one per task on the thread pool. A sheet is assembled the same
+/// way, each task copying one frame into its own cell, and encoded once at the end.
+///
+/// \authors Miguel Mendoza, Matt Rogers, Logan Hunter,
+/// Amelia Smith, Yohan Kwak, Yamin Zhuang
+///
+class FrameExporter
+{
+public:
+    static constexpr int MinimumDigits = 4; ///Fewest digits of the frame number in a sequence file name
+
+    ///
+    /// \brief Creates an exporter writing to the given path.
+    /// \param fileName = Folder of a sequence, which is created if needed, or path of a sheet
+    ///
+    explicit FrameExporter(const QString &fileName);
+
+    ///
+    /// \brief Writes every frame to its own PNG file in the folder, named after the
+    /// folder with the frame number appended.
+    /// \param frames = Frames to export
+    /// \return If every frame was written; errorString() describes the failure otherwise
+    ///
+    bool writeSequence(const FrameList &frames);
+
+    ///
+    /// \brief Writes the frames to one PNG sprite sheet, one frame per grid cell.
+    /// \param spriteSize = Size of every frame, and so of every cell
+    /// \param frames = Frames to export
+    /// \param columns = Cells per row, or 0 for as many as makes the grid about square
+    /// \return If the sheet was written; errorString() describes the failure otherwise
+    ///
+    bool writeSheet(const QSize &spriteSize, const FrameList &frames, int columns = 0);
+
+    ///
+    /// \brief Returns the path of one frame of a sequence.
+    /// \param index = Frame number
+    /// \param frameCount = Number of frames in the sequence
+    ///
+    QString sequenceFileName(int index, int frameCount) const;
+
+    qint64 bytesWritten() const; ///Returns the size of the files written last
+    QString errorString() const; ///Returns a description of the last error
+
+private:
+    ///
+    /// \brief Records an error message and returns false.
+    ///
+    bool fail(const QString &message);
+
+    QString m_fileName; ///Stores the folder or sheet path
+    qint64 m_bytesWritten = 0; ///Stores the size of the files written last
+    QString m_errorString; ///Stores the description of the last error
+};
+
+#endif // FRAMEEXPORTER_H
@@ -0,0 +1,131 @@
+#include "batchconverter.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QThread>
+
+///
+/// \brief Returns a byte count in megabytes, to one decimal.
+///
+static QString megabytes(double bytes)
+{
+    return QString::number(bytes / (1024 * 1024), 'f', 1) + " MB";
+}
+
+///
+/// \brief Main function of the console converter. Converts every project, image or
+/// folder named on the command line, prints a line per input and the overall
+/// throughput, and exits with 1 if any input failed.
+///
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("spritetool");
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Converts sprite projects to and from PNG sequences and sprite sheets.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("inputs", "Projects (.ssp), sheets or animations (.png, .gif), or folders of PNG frames.",
+                                 "<inputs...>");
+    const QCommandLineOption toOption({"t", "to"}, "Format to write: ssp, png (one image per frame) or sheet.",
+                                      "format", "ssp");
+    const QCommandLineOption outputOption({"o", "output"}, "Folder to write to instead of next to each input.", "folder");
+    const QCommandLineOption encodingOption({"e", "encoding"}, "Frame encoding of projects: raw, zlib, rle, palette or delta.",
+                                            "encoding", "rle");
+    const QCommandLineOption columnsOption("columns", "Frames per row of written sheets; about square by default.", "count");
+    const QCommandLineOption cellOption("cell", "Cell size of input sheets, such as 32x32; sheets are sliced along "
+                                                "transparent gutters by default.", "WxH");
+    const QCommandLineOption animatedOption("animated", "Read PNG inputs as animated PNGs rather than sheets.");
+    const QCommandLineOption jobsOption({"j", "jobs"}, "Number of inputs converted at once.", "count",
+                                        QString::number(QThread::idealThreadCount()));
+    parser.addOptions({toOption, outputOption, encodingOption, columnsOption, cellOption, animatedOption, jobsOption});
+    parser.process(a);
+
+    const QStringList inputNames = parser.positionalArguments();
+    if (inputNames.isEmpty()) {
+        parser.showHelp(1);
+    }
+    BatchConverter::Options options;
+    const QStringList targets = {"ssp", "png", "sheet"};
+    const int target = targets.indexOf(parser.value(toOption));
+    if (target < 0) {
+        err << "Unknown output format: " << parser.value(toOption) << Qt::endl;
+        return 1;
+    }
+    options.target = QVector<BatchConverter::Target>{BatchConverter::Target::Project, BatchConverter::Target::Sequence,
+                                                     BatchConverter::Target::Sheet}.at(target);
+    const QStringList encodingNames = {"raw", "zlib", "rle", "palette", "delta"};
+    const int encoding = encodingNames.indexOf(parser.value(encodingOption));
+    if (encoding < 0) {
+        err << "Unknown encoding: " << parser.value(encodingOption) << Qt::endl;
+        return 1;
+    }
+    options.encoding = QVector<FrameCodec::Encoding>{FrameCodec::Encoding::Raw, FrameCodec::Encoding::Zlib,
+                                                     FrameCodec::Encoding::RunLength, FrameCodec::Encoding::Palette8,
+                                                     FrameCodec::Encoding::Delta}.at(encoding);
+    if (parser.isSet(outputOption)) {
+        options.outputFolder = parser.value(outputOption);
+        if (!QDir().mkpath(options.outputFolder)) {
+            err << "Unable to create the folder " << options.outputFolder << Qt::endl;
+            return 1;
+        }
+    }
+    if (parser.isSet(columnsOption)) {
+        options.columns = parser.value(columnsOption).toInt();
+        if (options.columns <= 0) {
+            err << "The number of columns must be a positive number." << Qt::endl;
+            return 1;
+        }
+    }
+    if (parser.isSet(cellOption)) {
+        const QStringList sides = parser.value(cellOption).toLower().split('x');
+        options.cellSize = sides.size() == 2 ? QSize(sides.at(0).toInt(), sides.at(1).toInt()) : QSize();
+        if (options.cellSize.isEmpty()) {
+            err << "The cell size must be given as WxH, such as 32x32." << Qt::endl;
+            return 1;
+        }
+    }
+    options.readsAnimations = parser.isSet(animatedOption);
+    const int jobs = parser.value(jobsOption).toInt();
+    if (jobs <= 0) {
+        err << "The number of jobs must be a positive number." << Qt::endl;
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const BatchConverter converter(options);
+    const QVector<BatchConverter::Result> results = converter.convert(inputNames, jobs, [&](const BatchConverter::Result &result) {
+        if (!result.errorString.isEmpty()) {
+            err << result.inputName << ": " << result.errorString << Qt::endl;
+            return;
+        }
+        out << result.inputName << " -> " << result.outputName << ": " << result.frameCount << " frames, "
+            << megabytes(result.bytesRead) << " -> " << megabytes(result.bytesWritten) << " in "
+            << result.milliseconds << " ms" << Qt::endl;
+    });
+    const double seconds = qMax(timer.nsecsElapsed(), qint64(1)) / 1e9;
+
+    int converted = 0;
+    qint64 frames = 0;
+    qint64 bytesRead = 0;
+    qint64 bytesWritten = 0;
+    for (const BatchConverter::Result &result : results) {
+        if (result.errorString.isEmpty()) {
+            converted++;
+            frames += result.frameCount;
+            bytesRead += result.bytesRead;
+            bytesWritten += result.bytesWritten;
+        }
+    }
+    out << "Converted " << converted << " of " << results.size() << " inputs, " << frames << " frames, in "
+        << QString::number(seconds, 'f', 2) << " s with " << jobs << " jobs: "
+        << QString::number(converted / seconds, 'f', 1) << " inputs/s, "
+        << QString::number(frames / seconds, 'f', 1) << " frames/s, read " << megabytes(bytesRead / seconds)
+        << "/s, wrote " << megabytes(bytesWritten / seconds) << "/s" << Qt::endl;
+    return converted == results.size() ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+QT       = core gui concurrent
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+# Shares the project, import and codec sources with the editor; nothing in this
+# target links Qt Widgets, so it runs on machines without a display.
+include(../A7-Sprite-Editor/spriteio.pri)
+
+SOURCES += \
+    batchconverter.cpp \
+    frameexporter.cpp \
+    main.cpp
+
+HEADERS += \
+    batchconverter.h \
+    frameexporter.h
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target